@@ -40,7 +40,7 @@ private:
 typedef struct {
   nlohmann::json msg;
   std::shared_ptr<std::vector<char>> samples;
-  std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding=nullptr;
+  FUNASR_HW_EMB hotwords_embedding=nullptr;
  
   FUNASR_DEC_HANDLE decoder_handle=nullptr;
   std::atomic<int> status;
@@ -130,11 +130,8 @@ namespace http
                                    merged_hws_map);
 
           // nn
-          std::vector<std::vector<float>> new_hotwords_embedding =
-              CompileHotwordEmbedding(model_decoder->get_asr_handle(), nn_hotwords);
           data_msg->hotwords_embedding =
-              std::make_shared<std::vector<std::vector<float>>>(
-                  new_hotwords_embedding);
+              CompileSharedHotwordEmbedding(model_decoder->get_asr_handle(), nn_hotwords);
         }
 
         
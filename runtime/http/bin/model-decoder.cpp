@@ -31,19 +31,15 @@ void ModelDecoder::do_decoder(std::shared_ptr<FUNASR_MESSAGE> session_msg) {
 
  
 
-    if (num_samples > 0 && session_msg->hotwords_embedding->size() > 0) {
+    if (num_samples > 0 && session_msg->hotwords_embedding->num_hotwords > 0) {
       std::string asr_result = "";
       std::string stamp_res = "";
       std::string stamp_sents = "";
 
       try {
-        std::vector<std::vector<float>> hotwords_embedding_(
-            *(session_msg->hotwords_embedding));
-   
-
         FUNASR_RESULT Result = FunOfflineInferBuffer(
             asr_handle, buffer->data(), buffer->size(), RASR_NONE, nullptr,
-            std::move(hotwords_embedding_), audio_fs, wav_format, itn,
+            session_msg->hotwords_embedding, audio_fs, wav_format, itn,
             session_msg->decoder_handle);
 
         if (Result != nullptr) {
@@ -0,0 +1,114 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+// Converts TLG.fst or an itn fst into an arc sorted, aligned ConstFst that the
+// runtime maps read only instead of reading it into the heap of every process.
+// The written file is read back through the mapped path and checked to hold
+// the same fst, and with --text every line is decoded with both fsts the way
+// the itn processor does and the outputs are compared.
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <glog/logging.h>
+#include "fst/fstlib.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+static string Decode(const string &input, const fst::StdFst &model)
+{
+    fst::StringCompiler<fst::StdArc> compiler(fst::StringTokenType::BYTE);
+    fst::StringPrinter<fst::StdArc> printer(fst::StringTokenType::BYTE);
+    fst::StdVectorFst input_fst;
+    compiler(input, &input_fst);
+    fst::StdVectorFst lattice, shortest_path;
+    fst::Compose(input_fst, model, &lattice);
+    fst::ShortestPath(lattice, &shortest_path, 1, true);
+    string output;
+    printer(shortest_path, &output);
+    return output;
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    TCLAP::CmdLine cmd("funasr-fst-convert", ' ', "1.0");
+    TCLAP::ValueArg<std::string>    input("", "in", "the fst to convert, e.g. TLG.fst or zh_itn_tagger.fst", true, "", "string");
+    TCLAP::ValueArg<std::string>    output("", "out", "the ConstFst to write, may replace the input", true, "", "string");
+    TCLAP::ValueArg<std::string>    text("", "text", "optional text file, one sentence per line, decoded with both fsts to check the outputs are unchanged (itn fsts)", false, "", "string");
+
+    cmd.add(input);
+    cmd.add(output);
+    cmd.add(text);
+    cmd.parse(argc, argv);
+
+    std::unique_ptr<fst::StdFst> source(fst::StdFst::Read(input.getValue()));
+    if (!source) {
+        LOG(ERROR) << "Failed to read " << input.getValue();
+        return -1;
+    }
+    fst::StdVectorFst sorted(*source);
+    if (!sorted.Properties(fst::kILabelSorted, true)) {
+        fst::ArcSort(&sorted, fst::StdILabelCompare());
+    }
+    fst::StdConstFst converted(sorted);
+
+    // the arrays of the ConstFst must be aligned to be mapped
+    string temp_file = output.getValue() + ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary);
+        fst::FstWriteOptions opts(temp_file);
+        opts.align = true;
+        if (!out.is_open() || !converted.Write(out, opts) || !out.good()) {
+            LOG(ERROR) << "Failed to write " << temp_file;
+            remove(temp_file.c_str());
+            return -1;
+        }
+    }
+    if (rename(temp_file.c_str(), output.getValue().c_str()) != 0) {
+        LOG(ERROR) << "Failed to write " << output.getValue();
+        remove(temp_file.c_str());
+        return -1;
+    }
+
+    std::ifstream in(output.getValue(), std::ios::binary);
+    fst::FstReadOptions opts(output.getValue());
+    opts.mode = fst::FstReadOptions::MAP;
+    std::unique_ptr<fst::StdFst> mapped(fst::StdFst::Read(in, opts));
+    if (!mapped || mapped->Type() != "const" || !fst::Equal(sorted, *mapped)) {
+        LOG(ERROR) << output.getValue() << " does not read back as the converted fst";
+        return -1;
+    }
+    LOG(INFO) << "Converted " << input.getValue() << " into " << output.getValue() << ", "
+              << converted.NumStates() << " states";
+
+    if (text.isSet()) {
+        std::ifstream lines(text.getValue());
+        if (!lines.is_open()) {
+            LOG(ERROR) << "Failed to open file: " << text.getValue();
+            return -1;
+        }
+        int num_lines = 0, num_diffs = 0;
+        string line;
+        while (getline(lines, line)) {
+            string expected = Decode(line, *source);
+            string actual = Decode(line, *mapped);
+            if (expected != actual) {
+                LOG(ERROR) << "Output changed for \"" << line << "\": \"" << expected << "\" -> \"" << actual << "\"";
+                num_diffs++;
+            }
+            num_lines++;
+        }
+        LOG(INFO) << num_lines - num_diffs << " of " << num_lines << " lines decode unchanged";
+        if (num_diffs > 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
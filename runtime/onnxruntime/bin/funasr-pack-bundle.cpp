@@ -0,0 +1,35 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include <iostream>
+#include <string>
+#include <glog/logging.h>
+#include "funasrruntime.h"
+#include "tclap/CmdLine.h"
+#include "com-define.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    TCLAP::CmdLine cmd("funasr-pack-bundle", ' ', "1.0");
+    TCLAP::ValueArg<std::string>    model_dir("", MODEL_DIR, "the model path, whose onnx, yaml, cmvn, token, seg_dict, fst and lexicon files are packed", true, "", "string");
+    TCLAP::ValueArg<std::string>    bundle("", "bundle", "the bundle file to write, pass it as model-dir to load the models from it", true, "", "string");
+
+    cmd.add(model_dir);
+    cmd.add(bundle);
+    cmd.parse(argc, argv);
+
+    if (!FunPackModelBundle(model_dir.getValue(), bundle.getValue()))
+    {
+        LOG(ERROR) << "Failed to pack " << model_dir.getValue();
+        return -1;
+    }
+    LOG(INFO) << "Packed " << model_dir.getValue() << " into " << bundle.getValue();
+    return 0;
+}
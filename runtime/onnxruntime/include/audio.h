@@ -1,7 +1,9 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include <memory>
 #include <queue>
+#include <vector>
 #include <stdint.h>
 #include "vad-model.h"
 #include "offline-stream.h"
@@ -11,8 +13,14 @@
 #define WAV_HEADER_SIZE 44
 #endif
 
+// initial capacity of the 2pass sample ring, in seconds
+#ifndef AUDIO_RING_SECONDS
+#define AUDIO_RING_SECONDS 10
+#endif
+
 using namespace std;
 namespace funasr {
+class FbankCache;
 
 class AudioFrame {
   private:
@@ -34,12 +42,40 @@ class AudioFrame {
     int Disp();
     // 2pass
     bool is_final = false;
+    // not owned, points into the sample ring of Audio or into buf
     float* data = nullptr;
+    std::vector<float> buf;
     int len;
     int global_start = 0; // the start of a frame in the global time axis. in ms
     int global_end = 0;   // the end of a frame in the global time axis. in ms
 };
 
+// Fixed-capacity ring of stream samples addressed by absolute sample index.
+// Erasing history only moves the head, the capacity grows (doubling) only when
+// the live range does not fit.
+class AudioRingBuffer {
+  public:
+    explicit AudioRingBuffer(int capacity=0);
+    // keeps the samples, no-op if the capacity is already large enough
+    void Reserve(int capacity);
+    void Append(const float *samples, int n);
+    // drops the samples before absolute index pos
+    void EraseFront(int pos);
+    void Clear();
+    // samples [start, start+n) if they are contiguous in the ring, nullptr otherwise
+    const float *View(int start, int n) const;
+    void CopyTo(int start, int n, float *out) const;
+    int Begin() const { return begin_; }
+    int End() const { return begin_ + size_; }
+    int Size() const { return size_; }
+
+  private:
+    std::vector<float> buf_;
+    int head_ = 0;
+    int size_ = 0;
+    int begin_ = 0;
+};
+
 #ifdef _WIN32
 #ifdef _FUNASR_API_EXPORT
 #define DLLAPI __declspec(dllexport)
@@ -62,6 +98,12 @@ class DLLAPI Audio {
     queue<AudioFrame *> asr_online_queue;
     queue<AudioFrame *> asr_offline_queue;
     int dest_sample_rate;
+    // 2pass
+    vector<AudioFrame *> frame_pool;
+    vector<float> online_samples;
+    void SetFrameData(AudioFrame *frame, int start, int len);
+    // offline, fbank of speech_data computed by the vad in CutSplit
+    std::unique_ptr<FbankCache> fbank_cache;
   public:
     Audio(int data_type);
     Audio(int model_sample_rate,int data_type);
@@ -94,21 +136,25 @@ class DLLAPI Audio {
     int GetQueueSize() { return (int)frame_queue.size(); }
     char* GetSpeechChar(){return speech_char;}
     int GetSpeechLen(){return speech_len;}
+    // for the asr Forward of the frames from FetchDynamic, nullptr if CutSplit did not fill it
+    const FbankCache* GetFbankCache(){return fbank_cache.get();}
 
     // 2pass
-    vector<float> all_samples;
-    int offset = 0;
+    // frames of the online/offline queues point into all_samples, they stay
+    // valid until the next LoadPcmwavOnline() and are given back by ReleaseFrame()
+    AudioRingBuffer all_samples;
     int speech_start=-1, speech_end=0;
     int speech_offline_start=-1;
 
     int seg_sample = MODEL_SAMPLE_RATE/1000;
     bool LoadPcmwavOnline(const char* buf, int n_file_len, int32_t* sampling_rate);
+    AudioFrame* AcquireFrame(int len);
+    void ReleaseFrame(AudioFrame* frame);
     void ResetIndex(){
       speech_start=-1;
       speech_end=0;
       speech_offline_start=-1;
-      offset = 0;
-      all_samples.clear();
+      all_samples.Clear();
     }
 };
 
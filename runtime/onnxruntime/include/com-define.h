@@ -59,6 +59,17 @@ namespace funasr {
 // gpu models
 #define INFER_GPU "gpu"
 #define BATCHSIZE "batch-size"
+#define VAD_BATCHSIZE "vad-batch-size"
+#define ONLINE_BATCHSIZE "online-batch-size"
+#define ONLINE_BATCH_WAIT "online-batch-wait-us"
+#define OFFLINE_BATCHSIZE "offline-batch-size"
+#define OFFLINE_BATCH_WAIT "offline-batch-wait-us"
+#define CPU_BUDGET "cpu-budget"
+#define CPU_AFFINITY "cpu-affinity"
+#define MODEL_CACHE_DIR "model-cache-dir"
+#define MAX_CONNECTIONS "max-connections"
+#define MAX_DECODE_QUEUE "max-decode-queue"
+#define MAX_SESSION_QUEUE "max-session-queue"
 #define TORCH_MODEL_NAME "model.torchscript"
 #define TORCH_QUANT_MODEL_NAME "model_quant.torchscript"
 #define BLADE_MODEL_NAME "model_blade.torchscript"
@@ -71,6 +82,8 @@ namespace funasr {
 #define MODEL_SEG_DICT "seg_dict"
 #define TOKEN_PATH "tokens.json"
 #define HOTWORD "hotword"
+// hotword sets whose compiled embedding and bias lm are kept per model
+#define HOTWORD_CACHE_SIZE 64
 // #define NN_HOTWORD "nn-hotword"
 
 #define ITN_DIR "itn-dir"
@@ -106,6 +119,21 @@ namespace funasr {
 #define VAD_LFR_N 1
 #endif
 
+// how long the first online vad chunk of a batch waits for chunks of other sessions
+#ifndef VAD_BATCH_WAIT_US
+#define VAD_BATCH_WAIT_US 2000
+#endif
+
+// how long the first online asr chunk of a batch waits for chunks of other streams
+#ifndef ONLINE_BATCH_WAIT_US
+#define ONLINE_BATCH_WAIT_US 5000
+#endif
+
+// how long the first vad segment of an offline batch waits for segments of other requests
+#ifndef OFFLINE_BATCH_WAIT_US
+#define OFFLINE_BATCH_WAIT_US 10000
+#endif
+
 // asr
 #ifndef PARA_LFR_M
 #define PARA_LFR_M 7
@@ -119,6 +147,11 @@ namespace funasr {
 #define ONLINE_STEP 9600
 #endif
 
+// frames kept by the streaming knf::OnlineFbank, knf requires more than 200
+#ifndef ONLINE_FBANK_MAX_FRAMES
+#define ONLINE_FBANK_MAX_FRAMES 512
+#endif
+
 // punc
 #define UNK_CHAR "<unk>"
 #define TOKEN_LEN     20
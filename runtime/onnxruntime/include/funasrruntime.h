@@ -1,7 +1,11 @@
 #pragma once
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
+#include <stdint.h>
+#include "com-define.h"
 #ifdef WIN32
 #ifdef _FUNASR_API_EXPORT
 #define  _FUNASRAPI __declspec(dllexport)
@@ -24,6 +28,35 @@ typedef void* FUNASR_RESULT;
 typedef void* FUNASR_DEC_HANDLE;
 typedef unsigned char FUNASR_BOOL;
 
+// Hotword embedding of num_hotwords rows of dim floats, flattened row major.
+// Compiled once per hotword set and shared read only by the decode calls of
+// every connection using the set, so the streaming paths pass a pointer
+// instead of copying the rows with every message.
+struct FunHotwordEmbedding {
+    std::vector<float> data;
+    int64_t num_hotwords = 0;
+    int64_t dim = 0;
+
+    static FunHotwordEmbedding FromRows(const std::vector<std::vector<float>> &rows) {
+        FunHotwordEmbedding emb;
+        emb.num_hotwords = rows.size();
+        emb.dim = rows.empty() ? 0 : rows[0].size();
+        emb.data.reserve(emb.num_hotwords * emb.dim);
+        for (auto &row : rows) {
+            emb.data.insert(emb.data.end(), row.begin(), row.end());
+        }
+        return emb;
+    }
+    std::vector<std::vector<float>> Rows() const {
+        std::vector<std::vector<float>> rows;
+        for (int64_t i = 0; i < num_hotwords; i++) {
+            rows.emplace_back(data.begin() + i * dim, data.begin() + (i + 1) * dim);
+        }
+        return rows;
+    }
+};
+typedef std::shared_ptr<const FunHotwordEmbedding> FUNASR_HW_EMB;
+
 #define FUNASR_TRUE 1
 #define FUNASR_FALSE 0
 #define QM_DEFAULT_THREAD_NUM  4
@@ -57,6 +90,15 @@ typedef enum {
 typedef void (* QM_CALLBACK)(int cur_step, int n_total); // n_total: total steps; cur_step: Current Step.
 
 // ASR
+// Call before the first model is loaded. cpu_budget > 0 runs all onnx sessions on one shared pool
+// of cpu_budget intra-op threads and the thread_num of the Init calls is ignored, cpu_affinity pins
+// the process to a cpu list such as "0-7,16". With a model_cache_dir the optimized onnx graphs and
+// binary copies of the cmvn and token files are saved there on the first start and loaded by later ones.
+_FUNASRAPI bool				FunRuntimeInit(int cpu_budget, std::string cpu_affinity="", std::string model_cache_dir="");
+// Packs the model files of model_dir into one bundle file, which can then be passed everywhere
+// a model dir is expected. The jieba dicts of the punc models can not be bundled, a punc bundle
+// loads them from the dir holding the bundle file.
+_FUNASRAPI bool				FunPackModelBundle(std::string model_dir, std::string bundle_file);
 _FUNASRAPI FUNASR_HANDLE  	FunASRInit(std::map<std::string, std::string>& model_path, int thread_num, ASR_TYPE type=ASR_OFFLINE);
 _FUNASRAPI FUNASR_HANDLE  	FunASROnlineInit(FUNASR_HANDLE asr_handle, std::vector<int> chunk_size={5,10,5});
 _FUNASRAPI void         	FunASRReset(FUNASR_HANDLE handle, FUNASR_DEC_HANDLE dec_handle=nullptr);
@@ -76,7 +118,7 @@ _FUNASRAPI void			FunASRUninit(FUNASR_HANDLE handle);
 _FUNASRAPI const float	FunASRGetRetSnippetTime(FUNASR_RESULT result);
 
 // VAD
-_FUNASRAPI FUNASR_HANDLE  	FsmnVadInit(std::map<std::string, std::string>& model_path, int thread_num);
+_FUNASRAPI FUNASR_HANDLE  	FsmnVadInit(std::map<std::string, std::string>& model_path, int thread_num, int batch_size=1);
 _FUNASRAPI FUNASR_HANDLE  	FsmnVadOnlineInit(FUNASR_HANDLE fsmnvad_handle);
 // buffer
 _FUNASRAPI FUNASR_RESULT	FsmnVadInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, QM_CALLBACK fn_callback, bool input_finished=true, int sampling_rate=16000, std::string wav_format="pcm");
@@ -96,7 +138,9 @@ _FUNASRAPI void					CTTransformerFreeResult(FUNASR_RESULT result);
 _FUNASRAPI void					CTTransformerUninit(FUNASR_HANDLE handle);
 
 //OfflineStream
-_FUNASRAPI FUNASR_HANDLE  	FunOfflineInit(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
+// offline_batch_size > 1 decodes the vad segments of concurrent requests in shared batches
+_FUNASRAPI FUNASR_HANDLE  	FunOfflineInit(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1,
+                                         int offline_batch_size=1, int offline_batch_wait_us=OFFLINE_BATCH_WAIT_US);
 _FUNASRAPI void         	FunOfflineReset(FUNASR_HANDLE handle, FUNASR_DEC_HANDLE dec_handle=nullptr);
 // buffer
 _FUNASRAPI FUNASR_RESULT	FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
@@ -107,14 +151,23 @@ _FUNASRAPI FUNASR_RESULT	FunOfflineInferBuffer(FUNASR_HANDLE handle, const char*
 _FUNASRAPI FUNASR_RESULT	FunOfflineInfer(FUNASR_HANDLE handle, const char* sz_filename, FUNASR_MODE mode, 
 											QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
 											int sampling_rate=16000, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr);
+// buffer, with a hotword embedding of CompileSharedHotwordEmbedding
+_FUNASRAPI FUNASR_RESULT	FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
+												  FUNASR_MODE mode, QM_CALLBACK fn_callback, const FUNASR_HW_EMB &hw_emb, 
+												  int sampling_rate=16000, std::string wav_format="pcm", bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
+												  std::string svs_lang="auto", bool svs_itn=true);
 //#if !defined(__APPLE__)
 _FUNASRAPI const std::vector<std::vector<float>> CompileHotwordEmbedding(FUNASR_HANDLE handle, std::string &hotwords, ASR_TYPE mode=ASR_OFFLINE);
+// The hotword embedding as a shared handle, cached by the model for the next
+// connection with the same hotwords. Never null, empty if compiling failed.
+_FUNASRAPI FUNASR_HW_EMB	CompileSharedHotwordEmbedding(FUNASR_HANDLE handle, std::string &hotwords, ASR_TYPE mode=ASR_OFFLINE);
 //#endif
 
 _FUNASRAPI void				FunOfflineUninit(FUNASR_HANDLE handle);
 
 //2passStream
-_FUNASRAPI FUNASR_HANDLE  	FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num);
+_FUNASRAPI FUNASR_HANDLE  	FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num, int vad_batch_size=1,
+                                        int online_batch_size=1, int online_batch_wait_us=ONLINE_BATCH_WAIT_US);
 _FUNASRAPI FUNASR_HANDLE    FunTpassOnlineInit(FUNASR_HANDLE tpass_handle, std::vector<int> chunk_size={5,10,5});
 // buffer
 _FUNASRAPI FUNASR_RESULT	FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
@@ -122,6 +175,12 @@ _FUNASRAPI FUNASR_RESULT	FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE
 												int sampling_rate=16000, std::string wav_format="pcm", ASR_TYPE mode=ASR_TWO_PASS, 
 												const std::vector<std::vector<float>> &hw_emb={{0.0}}, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
 												std::string svs_lang="auto", bool svs_itn=true);
+// buffer, with a hotword embedding of CompileSharedHotwordEmbedding
+_FUNASRAPI FUNASR_RESULT	FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
+												int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
+												int sampling_rate, std::string wav_format, ASR_TYPE mode, 
+												const FUNASR_HW_EMB &hw_emb, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
+												std::string svs_lang="auto", bool svs_itn=true);
 _FUNASRAPI void				FunTpassUninit(FUNASR_HANDLE handle);
 _FUNASRAPI void				FunTpassOnlineUninit(FUNASR_HANDLE handle);
 
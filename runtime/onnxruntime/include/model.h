@@ -2,6 +2,7 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <algorithm>
 #include <string>
 #include <map>
 #include "funasrruntime.h"
@@ -10,6 +11,7 @@
 #include "fst/fstlib.h"
 #include "fst/symbol-table.h"
 namespace funasr {
+class FbankCache;
 class Model {
   public:
     virtual ~Model(){};
@@ -24,18 +26,45 @@ class Model {
     virtual void InitLm(const std::string &lm_file, const std::string &lm_config, const std::string &lex_file){};
     virtual void InitFstDecoder(){};
     virtual std::string Forward(float *din, int len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr){return "";};
-    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1)
+    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1,
+      const FbankCache *fbank_cache=nullptr)
       {return std::vector<string>();};
-    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, std::string svs_lang="auto", bool svs_itn=false, int batch_in=1)
+    // with a flattened hotword embedding, models without their own take the rows
+    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb, void* wfst_decoder, int batch_in=1,
+      const FbankCache *fbank_cache=nullptr)
+      {return Forward(din, len, input_finished, hw_emb.Rows(), wfst_decoder, batch_in, fbank_cache);};
+    // items of different requests, item i searched with its own wfst_decoders[i] from a fresh
+    // utterance, or greedily where it is nullptr. Models without their own run one item at a time
+    // unless no item has a decoder
+    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb,
+      const std::vector<void*> &wfst_decoders, const FbankCache *fbank_cache=nullptr)
+      {
+        int batch_in = wfst_decoders.size();
+        if (std::count(wfst_decoders.begin(), wfst_decoders.end(), nullptr) == batch_in) {
+          return Forward(din, len, input_finished, hw_emb, nullptr, batch_in, fbank_cache);
+        }
+        std::vector<std::string> results;
+        for (int index = 0; index < batch_in; index++) {
+          std::vector<std::string> result = Forward(din + index, len + index, input_finished, hw_emb, wfst_decoders[index], 1, fbank_cache);
+          results.emplace_back(result.empty() ? "" : result[0]);
+        }
+        return results;
+      };
+    virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, std::string svs_lang="auto", bool svs_itn=false, int batch_in=1,
+      const FbankCache *fbank_cache=nullptr)
       {return std::vector<string>();};
     virtual std::string Rescoring() = 0;
     virtual void InitHwCompiler(const std::string &hw_model, int thread_num){};
     virtual void InitSegDict(const std::string &seg_dict_model){};
     virtual std::vector<std::vector<float>> CompileHotwordEmbedding(std::string &hotwords){return std::vector<std::vector<float>>();};
+    virtual FUNASR_HW_EMB CompileSharedHotwordEmbedding(std::string &hotwords){
+      return std::make_shared<const FunHotwordEmbedding>(FunHotwordEmbedding::FromRows(CompileHotwordEmbedding(hotwords)));};
     virtual std::string GetLang(){return "";};
     virtual int GetAsrSampleRate() = 0;
     virtual void SetBatchSize(int batch_size) {};
     virtual int GetBatchSize() {return 0;};
+    // batch the online encoder/decoder runs of up to batch_size streams sharing this model
+    virtual void SetOnlineBatch(int batch_size, int max_wait_us) {};
     virtual Vocab* GetVocab() {return nullptr;};
     virtual Vocab* GetLmVocab() {return nullptr;};
     virtual PhoneSet* GetPhoneSet() {return nullptr;};
@@ -13,10 +13,11 @@
 #endif
 
 namespace funasr {
+class OfflineBatcher;
 class OfflineStream {
   public:
     OfflineStream(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
-    ~OfflineStream(){};
+    ~OfflineStream();
 
     std::unique_ptr<VadModel> vad_handle= nullptr;
     std::unique_ptr<Model> asr_handle= nullptr;
@@ -28,12 +29,17 @@ class OfflineStream {
     bool UsePunc(){return use_punc;}; 
     bool UseITN(){return use_itn;};
     std::string GetModelType(){return model_type;};
+    // decode the vad segments of concurrent requests in shared batches of up
+    // to max_batch, max_batch <= 1 decodes every request by itself
+    void SetRequestBatch(int max_batch, int max_wait_us);
+    OfflineBatcher *GetRequestBatcher(){return request_batcher.get();};
     
   private:
     bool use_vad=false;
     bool use_punc=false;
     bool use_itn=false;
     std::string model_type = MODEL_PARA;
+    std::unique_ptr<OfflineBatcher> request_batcher;
 };
 
 OfflineStream *CreateOfflineStream(std::map<std::string, std::string>& model_path, int thread_num=1, bool use_gpu=false, int batch_size=1);
@@ -161,10 +161,6 @@ AudioFrame::AudioFrame(int start, int end, bool is_final):start(start),end(end),
     len = end - start;
 }
 AudioFrame::~AudioFrame(){
-    if(data != nullptr){
-        free(data);
-        data = nullptr;
-    }
 }
 int AudioFrame::SetStart(int val)
 {
@@ -195,6 +191,80 @@ int AudioFrame::Disp()
     return 0;
 }
 
+AudioRingBuffer::AudioRingBuffer(int capacity)
+{
+    Reserve(capacity);
+}
+
+void AudioRingBuffer::Reserve(int capacity)
+{
+    if (capacity <= (int)buf_.size()) {
+        return;
+    }
+    std::vector<float> new_buf(capacity);
+    CopyTo(begin_, size_, new_buf.data());
+    buf_.swap(new_buf);
+    head_ = 0;
+}
+
+void AudioRingBuffer::Append(const float *samples, int n)
+{
+    if (n <= 0) {
+        return;
+    }
+    if (size_ + n > (int)buf_.size()) {
+        Reserve(std::max(2 * (int)buf_.size(), size_ + n));
+    }
+    int capacity = buf_.size();
+    int tail = (head_ + size_) % capacity;
+    int first = std::min(n, capacity - tail);
+    memcpy(buf_.data() + tail, samples, first * sizeof(float));
+    memcpy(buf_.data(), samples + first, (n - first) * sizeof(float));
+    size_ += n;
+}
+
+void AudioRingBuffer::EraseFront(int pos)
+{
+    int n = std::min(pos - begin_, size_);
+    if (n <= 0) {
+        return;
+    }
+    head_ = (head_ + n) % buf_.size();
+    size_ -= n;
+    begin_ += n;
+}
+
+void AudioRingBuffer::Clear()
+{
+    head_ = 0;
+    size_ = 0;
+    begin_ = 0;
+}
+
+const float *AudioRingBuffer::View(int start, int n) const
+{
+    if (start < begin_ || start + n > begin_ + size_ || buf_.empty()) {
+        return nullptr;
+    }
+    int idx = (head_ + start - begin_) % buf_.size();
+    if (idx + n > (int)buf_.size()) {
+        return nullptr;
+    }
+    return buf_.data() + idx;
+}
+
+void AudioRingBuffer::CopyTo(int start, int n, float *out) const
+{
+    if (n <= 0) {
+        return;
+    }
+    int capacity = buf_.size();
+    int idx = (head_ + start - begin_) % capacity;
+    int first = std::min(n, capacity - idx);
+    memcpy(out, buf_.data() + idx, first * sizeof(float));
+    memcpy(out + first, buf_.data(), (n - first) * sizeof(float));
+}
+
 Audio::Audio(int data_type) : dest_sample_rate(MODEL_SAMPLE_RATE), data_type(data_type)
 {
     speech_buff = nullptr;
@@ -236,6 +306,55 @@ Audio::~Audio()
     ClearQueue(frame_queue);
     ClearQueue(asr_online_queue);
     ClearQueue(asr_offline_queue);
+    for (auto frame : frame_pool) {
+        delete frame;
+    }
+    frame_pool.clear();
+}
+
+AudioFrame* Audio::AcquireFrame(int len)
+{
+    AudioFrame* frame = nullptr;
+    if (frame_pool.empty()) {
+        frame = new AudioFrame(len);
+    } else {
+        frame = frame_pool.back();
+        frame_pool.pop_back();
+        frame->SetStart(0);
+        frame->SetEnd(len);
+    }
+    frame->is_final = false;
+    frame->data = nullptr;
+    frame->global_start = 0;
+    frame->global_end = 0;
+    return frame;
+}
+
+void Audio::ReleaseFrame(AudioFrame* frame)
+{
+    if (frame != nullptr) {
+        frame_pool.push_back(frame);
+    }
+}
+
+// Points frame at samples [start, start+len) of all_samples, they are only
+// copied into frame->buf when the range wraps around the ring
+void Audio::SetFrameData(AudioFrame *frame, int start, int len)
+{
+    const float *view = all_samples.View(start, len);
+    if (view != nullptr) {
+        frame->data = const_cast<float*>(view);
+        return;
+    }
+    frame->buf.resize(len);
+    if (start < all_samples.Begin() || start + len > all_samples.End()) {
+        LOG(ERROR) << "Samples [" << start << ", " << start + len << ") are not in the buffer ["
+                   << all_samples.Begin() << ", " << all_samples.End() << ")";
+        std::fill(frame->buf.begin(), frame->buf.end(), 0.0f);
+    } else {
+        all_samples.CopyTo(start, len, frame->buf.data());
+    }
+    frame->data = frame->buf.data();
 }
 
 void Audio::ClearQueue(std::queue<AudioFrame*>& q) {
@@ -277,6 +396,7 @@ void Audio::WavResample(int32_t sampling_rate, const float *waveform,
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
     speech_data = (float*)malloc(sizeof(float) * speech_len);
     memset(speech_data, 0, sizeof(float) * speech_len);
@@ -409,12 +529,13 @@ bool Audio::FfmpegLoad(const char *filename, bool copy2char){
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
     if (speech_char != nullptr) {
         free(speech_char);
         speech_char = nullptr;
     }
-    offset = 0;
+    all_samples.Clear();
     
     if(copy2char){
         speech_char = (char *)malloc(resampled_buffers.size());
@@ -593,6 +714,7 @@ bool Audio::FfmpegLoad(const char* buf, int n_file_len){
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
 
     speech_len = (resampled_buffers.size()) / 2;
@@ -625,13 +747,14 @@ bool Audio::LoadWav(const char *filename, int32_t* sampling_rate, bool resample)
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
     if (speech_buff != nullptr) {
         free(speech_buff);
         speech_buff = nullptr;
     }
     
-    offset = 0;
+    all_samples.Clear();
     std::ifstream is(filename, std::ifstream::binary);
     if(!is){
         LOG(ERROR) << "Failed to read " << filename;
@@ -768,7 +891,7 @@ bool Audio::LoadWav2Char(const char *filename, int32_t* sampling_rate)
         free(speech_char);
         speech_char = nullptr;
     }
-    offset = 0;
+    all_samples.Clear();
     std::ifstream is(filename, std::ifstream::binary);
     if(!is){
         LOG(ERROR) << "Failed to read " << filename;
@@ -836,6 +959,7 @@ bool Audio::LoadWav(const char* buf, int n_file_len, int32_t* sampling_rate)
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
     if (speech_buff != nullptr) {
         free(speech_buff);
@@ -948,6 +1072,7 @@ bool Audio::LoadPcmwav(const char* buf, int n_buf_len, int32_t* sampling_rate)
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
 
     speech_len = n_buf_len / 2;
@@ -979,40 +1104,32 @@ bool Audio::LoadPcmwav(const char* buf, int n_buf_len, int32_t* sampling_rate)
 
 bool Audio::LoadPcmwavOnline(const char* buf, int n_buf_len, int32_t* sampling_rate)
 {
-    if (speech_data != nullptr) {
-        free(speech_data);
-        speech_data = nullptr;
-    }
-
     speech_len = n_buf_len / 2;
-    speech_data = (float*)malloc(sizeof(float) * speech_len);
-    if(speech_data){
-        float scale = 1;
-        if (data_type == 1) {
-            scale = 32768.0f;
-        }
-        const uint8_t* byte_buf = reinterpret_cast<const uint8_t*>(buf);
-        for (int32_t i = 0; i < speech_len; ++i) {
-            int16_t val = (int16_t)((byte_buf[2 * i + 1] << 8) | byte_buf[2 * i]);
-            speech_data[i] = (float)val / scale;
-        }
-
-        //resample
-        if(*sampling_rate != dest_sample_rate){
-            WavResample(*sampling_rate, speech_data, speech_len);
-        }
+    online_samples.resize(speech_len);
+    float scale = 1;
+    if (data_type == 1) {
+        scale = 32768.0f;
+    }
+    const uint8_t* byte_buf = reinterpret_cast<const uint8_t*>(buf);
+    for (int32_t i = 0; i < speech_len; ++i) {
+        int16_t val = (int16_t)((byte_buf[2 * i + 1] << 8) | byte_buf[2 * i]);
+        online_samples[i] = (float)val / scale;
+    }
 
-        for (int32_t i = 0; i != speech_len; ++i) {
-            all_samples.emplace_back(speech_data[i]);
-        }
+    //resample
+    if(*sampling_rate != dest_sample_rate){
+        WavResample(*sampling_rate, online_samples.data(), speech_len);
+        online_samples.assign(speech_data, speech_data + speech_len);
+    }
 
-        AudioFrame* frame = new AudioFrame(speech_len);
-        frame_queue.push(frame);
-    
-        return true;
-    }else{
-        return false;
+    if (all_samples.Size() == 0) {
+        all_samples.Reserve(dest_sample_rate * AUDIO_RING_SECONDS);
     }
+    all_samples.Append(online_samples.data(), speech_len);
+
+    AudioFrame* frame = AcquireFrame(speech_len);
+    frame_queue.push(frame);
+    return true;
 }
 
 bool Audio::LoadPcmwav(const char* filename, int32_t* sampling_rate, bool resample)
@@ -1020,12 +1137,13 @@ bool Audio::LoadPcmwav(const char* filename, int32_t* sampling_rate, bool resamp
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
+        fbank_cache.reset();
     }
     if (speech_buff != nullptr) {
         free(speech_buff);
         speech_buff = nullptr;
     }
-    offset = 0;
+    all_samples.Clear();
 
     FILE* fp;
     fp = fopen(filename, "rb");
@@ -1078,7 +1196,7 @@ bool Audio::LoadPcmwav2Char(const char* filename, int32_t* sampling_rate)
         free(speech_char);
         speech_char = nullptr;
     }
-    offset = 0;
+    all_samples.Clear();
 
     FILE* fp;
     fp = fopen(filename, "rb");
@@ -1216,10 +1334,7 @@ int Audio::FetchDynamic(float**& dout, int*& len, int*& flag, float*& start_time
     int max_sent = 60*1000*seg_sample;
     int bs_acc = 0;
     int max_len = 0;
-    int max_batch = 1;
-    #ifdef USE_GPU
-        max_batch = batch_size;
-    #endif
+    int max_batch = std::max(batch_size, 1);
     max_batch = std::min(max_batch, (int)frame_queue.size());
 
     for(int idx=0; idx < max_batch; idx++){
@@ -1294,6 +1409,7 @@ void Audio::Padding()
     }
     free(speech_data);
     speech_data = nullptr;
+    fbank_cache.reset();
     speech_data = new_data;
     speech_len = num_new_samples;
 
@@ -1330,9 +1446,17 @@ void Audio::Split(OfflineStream* offline_stream)
 
 void Audio::CutSplit(OfflineStream* offline_stream, std::vector<int> &index_vector)
 {
-    std::unique_ptr<VadModel> vad_online_handle = make_unique<FsmnVadOnline>((FsmnVad*)(offline_stream->vad_handle).get());
+    std::unique_ptr<FsmnVadOnline> vad_online_handle = make_unique<FsmnVadOnline>((FsmnVad*)(offline_stream->vad_handle).get());
     AudioFrame *frame;
 
+    // keep the fbank the vad computes over speech_data, FetchDynamic's frames are slices of it
+    if (!fbank_cache) {
+        fbank_cache = std::make_unique<FbankCache>();
+    }
+    if (fbank_cache->Reset(vad_online_handle->GetFbankOptions(), speech_data, speech_len)) {
+        vad_online_handle->SetFbankSink(&fbank_cache->Feats());
+    }
+
     frame = frame_queue.front();
     frame_queue.pop();
     int sp_len = frame->GetLen();
@@ -1420,11 +1544,11 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
     frame = frame_queue.front();
     frame_queue.pop();
     int sp_len = frame->GetLen();
-    delete frame;
+    ReleaseFrame(frame);
     frame = nullptr;
 
-    std::vector<float> pcm_data(speech_data, speech_data+sp_len);
-    vector<std::vector<int>> vad_segments = vad_obj->Infer(pcm_data, input_finished);
+    // online_samples holds the samples of the last LoadPcmwavOnline() and is not needed after vad
+    vector<std::vector<int>> vad_segments = vad_obj->Infer(online_samples, input_finished);
 
     speech_end += sp_len/seg_sample;
     if(vad_segments.size() == 0){
@@ -1436,11 +1560,10 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
 
             if(asr_mode != ASR_OFFLINE){
                 if(buff_len >= step){
-                    frame = new AudioFrame(step);
+                    frame = AcquireFrame(step);
                     frame->global_start = speech_start;
                     frame->global_end = speech_start + step/seg_sample;
-                    frame->data = (float*)malloc(sizeof(float) * step);
-                    memcpy(frame->data, all_samples.data()+start-offset, step*sizeof(float));
+                    SetFrameData(frame, start, step);
                     asr_online_queue.push(frame);
                     frame = nullptr;
                     speech_start += step/seg_sample;
@@ -1463,23 +1586,21 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                 int end = speech_end_i*seg_sample;
 
                 if(asr_mode != ASR_OFFLINE){
-                    frame = new AudioFrame(end-start);
+                    frame = AcquireFrame(end-start);
                     frame->is_final = true;
                     frame->global_start = speech_start_i;
                     frame->global_end = speech_end_i;
-                    frame->data = (float*)malloc(sizeof(float) * (end-start));
-                    memcpy(frame->data, all_samples.data()+start-offset, (end-start)*sizeof(float));
+                    SetFrameData(frame, start, end-start);
                     asr_online_queue.push(frame);
                     frame = nullptr;
                 }
 
                 if(asr_mode != ASR_ONLINE){
-                    frame = new AudioFrame(end-start);
+                    frame = AcquireFrame(end-start);
                     frame->is_final = true;
                     frame->global_start = speech_start_i;
                     frame->global_end = speech_end_i;
-                    frame->data = (float*)malloc(sizeof(float) * (end-start));
-                    memcpy(frame->data, all_samples.data()+start-offset, (end-start)*sizeof(float));
+                    SetFrameData(frame, start, end-start);
                     asr_offline_queue.push(frame);
                     frame = nullptr;
                 }
@@ -1498,11 +1619,10 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
 
                 if(asr_mode != ASR_OFFLINE){
                     if(buff_len >= step){
-                        frame = new AudioFrame(step);
+                        frame = AcquireFrame(step);
                         frame->global_start = speech_start;
                         frame->global_end = speech_start + step/seg_sample;
-                        frame->data = (float*)malloc(sizeof(float) * step);
-                        memcpy(frame->data, all_samples.data()+start-offset, step*sizeof(float));
+                        SetFrameData(frame, start, step);
                         asr_online_queue.push(frame);
                         frame = nullptr;
                         speech_start += step/seg_sample;
@@ -1522,12 +1642,11 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                 int step = chunk_len;
 
                 if(asr_mode != ASR_ONLINE){
-                    frame = new AudioFrame(end-offline_start);
+                    frame = AcquireFrame(end-offline_start);
                     frame->is_final = true;
                     frame->global_start = speech_offline_start;
                     frame->global_end = speech_end_i;
-                    frame->data = (float*)malloc(sizeof(float) * (end-offline_start));
-                    memcpy(frame->data, all_samples.data()+offline_start-offset, (end-offline_start)*sizeof(float));
+                    SetFrameData(frame, offline_start, end-offline_start);
                     asr_offline_queue.push(frame);
                     frame = nullptr;
                 }
@@ -1540,17 +1659,16 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                                 step = buff_len - sample_offset;
                                 is_final = true;
                             }
-                            frame = new AudioFrame(step);
+                            frame = AcquireFrame(step);
                             frame->is_final = is_final;
                             frame->global_start = (int)((start+sample_offset)/seg_sample);
                             frame->global_end = frame->global_start + step/seg_sample;
-                            frame->data = (float*)malloc(sizeof(float) * step);
-                            memcpy(frame->data, all_samples.data()+start-offset+sample_offset, step*sizeof(float));
+                            SetFrameData(frame, start+sample_offset, step);
                             asr_online_queue.push(frame);
                             frame = nullptr;
                         }
                     }else{
-                        frame = new AudioFrame(0);
+                        frame = AcquireFrame(0);
                         frame->is_final = true;
                         frame->global_start = speech_start;   // in this case start >= end
                         frame->global_end = speech_end_i;
@@ -1567,20 +1685,12 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
     // erase all_samples
     int vector_cache = dest_sample_rate*2;
     if(speech_offline_start == -1){
-        if(all_samples.size() > vector_cache){
-            int erase_num = all_samples.size() - vector_cache;
-            all_samples.erase(all_samples.begin(), all_samples.begin()+erase_num);
-            offset += erase_num;
-        }
+        all_samples.EraseFront(all_samples.End() - vector_cache);
     }else{
         int offline_start = speech_offline_start*seg_sample;
-         if(offline_start-offset > vector_cache){
-            int erase_num = offline_start-offset - vector_cache;
-            all_samples.erase(all_samples.begin(), all_samples.begin()+erase_num);
-            offset += erase_num;
-        }       
+        all_samples.EraseFront(offline_start - vector_cache);
     }
-    
+
 }
 
 } // namespace funasr
@@ -0,0 +1,161 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef BATCH_QUEUE_H
+#define BATCH_QUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace funasr {
+
+// The leader/follower queue of the batchers, which have no threads of their
+// own: the callers queue their items under a key, items of equal keys can run
+// as one batch, and block until their items have run. A caller whose items are
+// still queued and finds no batch of its key being collected becomes the
+// leader: it waits up to max_wait_us for max_batch items of the key, takes a
+// batch out and runs it outside the lock, then leads again or waits for the
+// rest of its items. Item needs a bool done, false when it is submitted.
+template <typename Item, typename Key>
+class BatchQueue {
+  public:
+    BatchQueue(int max_batch, int max_wait_us);
+
+    int MaxBatch() const { return max_batch_; }
+
+    // Returns when every one of items has run. select(queued) gets the queued
+    // items of key in arrival order and returns the next batch out of them, at
+    // least one item. run(batch) runs it without the lock, it must not throw.
+    template <typename Select, typename Run>
+    void Submit(const std::vector<Item*> &items, const Key &key, Select select, Run run);
+    // batches of the oldest max_batch queued items
+    template <typename Run>
+    void Submit(const std::vector<Item*> &items, const Key &key, Run run);
+
+    std::vector<Item*> Oldest(const std::vector<Item*> &queued) const;
+
+  private:
+    // called with mutex_ held, returns the items of the batch the caller leads
+    template <typename Select>
+    std::vector<Item*> TakeBatch(const Key &key, Select &select, std::unique_lock<std::mutex> &lock);
+    int CountPending(const Key &key) const;
+    bool AnyPending(const std::vector<Item*> &items) const;
+
+    int max_batch_;
+    std::chrono::microseconds max_wait_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::list<std::pair<Key, Item*>> pending_;
+    // keys that already have a caller collecting their batch
+    std::set<Key> leaders_;
+};
+
+template <typename Item, typename Key>
+BatchQueue<Item, Key>::BatchQueue(int max_batch, int max_wait_us)
+    : max_batch_(std::max(max_batch, 1)), max_wait_(max_wait_us)
+{
+}
+
+template <typename Item, typename Key>
+std::vector<Item*> BatchQueue<Item, Key>::Oldest(const std::vector<Item*> &queued) const
+{
+    return std::vector<Item*>(queued.begin(), queued.begin() + std::min((int)queued.size(), max_batch_));
+}
+
+template <typename Item, typename Key>
+int BatchQueue<Item, Key>::CountPending(const Key &key) const
+{
+    int count = 0;
+    for (auto &entry : pending_) {
+        if (entry.first == key) {
+            count++;
+        }
+    }
+    return count;
+}
+
+template <typename Item, typename Key>
+bool BatchQueue<Item, Key>::AnyPending(const std::vector<Item*> &items) const
+{
+    for (auto &entry : pending_) {
+        if (std::find(items.begin(), items.end(), entry.second) != items.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Item, typename Key>
+template <typename Select>
+std::vector<Item*> BatchQueue<Item, Key>::TakeBatch(const Key &key, Select &select, std::unique_lock<std::mutex> &lock)
+{
+    leaders_.insert(key);
+    auto deadline = std::chrono::steady_clock::now() + max_wait_;
+    while (CountPending(key) < max_batch_) {
+        if (cond_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            break;
+        }
+    }
+
+    std::vector<Item*> queued;
+    for (auto &entry : pending_) {
+        if (entry.first == key) {
+            queued.emplace_back(entry.second);
+        }
+    }
+    std::vector<Item*> batch = select(queued);
+    if (batch.empty()) {
+        batch.emplace_back(queued[0]);
+    }
+    pending_.remove_if([&batch](const std::pair<Key, Item*> &entry) {
+        return std::find(batch.begin(), batch.end(), entry.second) != batch.end();
+    });
+    leaders_.erase(key);
+    // items left over become the next batch
+    cond_.notify_all();
+    return batch;
+}
+
+template <typename Item, typename Key>
+template <typename Select, typename Run>
+void BatchQueue<Item, Key>::Submit(const std::vector<Item*> &items, const Key &key, Select select, Run run)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (Item *item : items) {
+        pending_.emplace_back(key, item);
+    }
+    cond_.notify_all();
+    while (std::any_of(items.begin(), items.end(), [](const Item *item) { return !item->done; })) {
+        if (!AnyPending(items) || leaders_.count(key) != 0) {
+            cond_.wait(lock);
+            continue;
+        }
+        std::vector<Item*> batch = TakeBatch(key, select, lock);
+        lock.unlock();
+        run(batch);
+        lock.lock();
+        for (Item *item : batch) {
+            item->done = true;
+        }
+        cond_.notify_all();
+    }
+}
+
+template <typename Item, typename Key>
+template <typename Run>
+void BatchQueue<Item, Key>::Submit(const std::vector<Item*> &items, const Key &key, Run run)
+{
+    Submit(items, key, [this](const std::vector<Item*> &queued) { return Oldest(queued); }, run);
+}
+
+} // namespace funasr
+#endif
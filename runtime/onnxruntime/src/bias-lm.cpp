@@ -1,4 +1,5 @@
 #include "bias-lm.h"
+#include "model-bundle.h"
 #ifdef _WIN32
 #include "fst-types.cc"
 #endif
@@ -16,7 +17,7 @@ void print(std::queue<StateId> &q) {
 void BiasLm::LoadCfgFromYaml(const char* filename, BiasLmOption &opt) {
   YAML::Node config;
   try {
-    config = YAML::LoadFile(filename);
+    config = ModelBundle::LoadYaml(filename);
   } catch(exception const &e) {
     LOG(INFO) << "Error loading file, yaml file error or not exist.";
     exit(-1);
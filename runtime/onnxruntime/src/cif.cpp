@@ -0,0 +1,154 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "cpu-isa.h"
+
+namespace funasr {
+
+typedef void (*CifFunc)(const float *x, float a, float *out, int n);
+
+static void AccumulateScalar(const float *x, float a, float *out, int n)
+{
+    for (int k = 0; k < n; k++) {
+        out[k] += a * x[k];
+    }
+}
+
+static void ScaleScalar(const float *x, float a, float *out, int n)
+{
+    for (int k = 0; k < n; k++) {
+        out[k] = a * x[k];
+    }
+}
+
+#if defined(FUNASR_ISA_X86)
+// avx512f implies fma in gcc, which would fuse the mul and the add
+#if defined(__clang__)
+#define CIF_NO_CONTRACT
+#else
+#define CIF_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#endif
+
+__attribute__((target("avx2"))) CIF_NO_CONTRACT
+static void AccumulateAvx2(const float *x, float a, float *out, int n)
+{
+    __m256 va = _mm256_set1_ps(a);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 v = _mm256_mul_ps(va, _mm256_loadu_ps(x + k));
+        _mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_loadu_ps(out + k), v));
+    }
+    for (; k < n; k++) {
+        out[k] += a * x[k];
+    }
+}
+
+__attribute__((target("avx2")))
+static void ScaleAvx2(const float *x, float a, float *out, int n)
+{
+    __m256 va = _mm256_set1_ps(a);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        _mm256_storeu_ps(out + k, _mm256_mul_ps(va, _mm256_loadu_ps(x + k)));
+    }
+    for (; k < n; k++) {
+        out[k] = a * x[k];
+    }
+}
+
+__attribute__((target("avx512f"))) CIF_NO_CONTRACT
+static void AccumulateAvx512(const float *x, float a, float *out, int n)
+{
+    __m512 va = _mm512_set1_ps(a);
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512 v = _mm512_mul_ps(va, _mm512_loadu_ps(x + k));
+        _mm512_storeu_ps(out + k, _mm512_add_ps(_mm512_loadu_ps(out + k), v));
+    }
+    if (k < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - k)) - 1);
+        __m512 v = _mm512_mul_ps(va, _mm512_maskz_loadu_ps(mask, x + k));
+        _mm512_mask_storeu_ps(out + k, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, out + k), v));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void ScaleAvx512(const float *x, float a, float *out, int n)
+{
+    __m512 va = _mm512_set1_ps(a);
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        _mm512_storeu_ps(out + k, _mm512_mul_ps(va, _mm512_loadu_ps(x + k)));
+    }
+    if (k < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - k)) - 1);
+        _mm512_mask_storeu_ps(out + k, mask, _mm512_mul_ps(va, _mm512_maskz_loadu_ps(mask, x + k)));
+    }
+}
+#endif
+
+#if defined(FUNASR_ISA_NEON)
+static void AccumulateNeon(const float *x, float a, float *out, int n)
+{
+    float32x4_t va = vdupq_n_f32(a);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t v = vmulq_f32(va, vld1q_f32(x + k));
+        vst1q_f32(out + k, vaddq_f32(vld1q_f32(out + k), v));
+    }
+    for (; k < n; k++) {
+        out[k] += a * x[k];
+    }
+}
+
+static void ScaleNeon(const float *x, float a, float *out, int n)
+{
+    float32x4_t va = vdupq_n_f32(a);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        vst1q_f32(out + k, vmulq_f32(va, vld1q_f32(x + k)));
+    }
+    for (; k < n; k++) {
+        out[k] = a * x[k];
+    }
+}
+#endif
+
+struct CifImpl {
+    CifFunc accumulate;
+    CifFunc scale;
+};
+
+static const IsaDispatch<CifImpl> &GetCif()
+{
+    static const IsaDispatch<CifImpl> dispatch({
+#if defined(FUNASR_ISA_X86)
+        {CpuIsa::kAvx512f, {AccumulateAvx512, ScaleAvx512}},
+        {CpuIsa::kAvx2, {AccumulateAvx2, ScaleAvx2}},
+#elif defined(FUNASR_ISA_NEON)
+        {CpuIsa::kNeon, {AccumulateNeon, ScaleNeon}},
+#endif
+        {CpuIsa::kScalar, {AccumulateScalar, ScaleScalar}},
+    });
+    return dispatch;
+}
+
+const char *CifIsa()
+{
+    return GetCif().Name();
+}
+
+void CifAccumulate(const float *x, float a, float *out, int n)
+{
+    GetCif().Get().accumulate(x, a, out, n);
+}
+
+void CifScale(const float *x, float a, float *out, int n)
+{
+    GetCif().Get().scale(x, a, out, n);
+}
+
+} // namespace funasr
@@ -0,0 +1,22 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef CIF_H
+#define CIF_H
+
+namespace funasr {
+
+// Inner loops of continuous integrate-and-fire. CifAccumulate does
+// out[k] += a * x[k] and CifScale does out[k] = a * x[k] for k < n. The loops
+// are picked at runtime (avx512f/avx2/neon/scalar), mul and add are not fused
+// so all variants give bit-identical results.
+void CifAccumulate(const float *x, float a, float *out, int n);
+void CifScale(const float *x, float a, float *out, int n);
+
+// name of the selected inner loops, for logging
+const char *CifIsa();
+
+} // namespace funasr
+#endif
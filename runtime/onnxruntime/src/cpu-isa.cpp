@@ -0,0 +1,48 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "cpu-isa.h"
+
+namespace funasr {
+
+const char *IsaName(CpuIsa isa)
+{
+    switch (isa) {
+        case CpuIsa::kNeon:
+            return "neon";
+        case CpuIsa::kAvx2:
+            return "avx2";
+        case CpuIsa::kAvx512f:
+            return "avx512f";
+        default:
+            return "scalar";
+    }
+}
+
+static std::vector<CpuIsa> DetectIsas()
+{
+    std::vector<CpuIsa> isas;
+#if defined(FUNASR_ISA_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        isas.push_back(CpuIsa::kAvx512f);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        isas.push_back(CpuIsa::kAvx2);
+    }
+#elif defined(FUNASR_ISA_NEON)
+    isas.push_back(CpuIsa::kNeon);
+#endif
+    isas.push_back(CpuIsa::kScalar);
+    return isas;
+}
+
+const std::vector<CpuIsa> &SupportedIsas()
+{
+    static const std::vector<CpuIsa> isas = DetectIsas();
+    return isas;
+}
+
+} // namespace funasr
@@ -0,0 +1,86 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef CPU_ISA_H
+#define CPU_ISA_H
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+// the simd variants a kernel can be built with on this target, the x86 ones
+// are compiled with target attributes and picked at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FUNASR_ISA_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FUNASR_ISA_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace funasr {
+
+enum class CpuIsa { kScalar, kNeon, kAvx2, kAvx512f };
+
+// "scalar", "neon", "avx2" or "avx512f"
+const char *IsaName(CpuIsa isa);
+// detected once, ordered from the widest vectors down to kScalar
+const std::vector<CpuIsa> &SupportedIsas();
+
+// Runtime pick of the simd variants of a kernel. Impl holds the function pointers
+// of one variant, impls gives one per isa the kernel was built with and must
+// include kScalar. The variants this cpu can not run are dropped and Get()
+// returns the best of the rest unless Force() picked another one.
+template <typename Impl>
+class IsaDispatch {
+  public:
+    explicit IsaDispatch(const std::vector<std::pair<CpuIsa, Impl>> &impls);
+
+    const Impl &Get() const { return impls_[forced_.load(std::memory_order_acquire)].second; }
+    // name of the isa Get() returns, for logging
+    const char *Name() const { return IsaName(impls_[forced_.load(std::memory_order_acquire)].first); }
+    // Makes Get() return the variant of isa so the variants can be compared,
+    // "" goes back to the best one. false if this cpu can not run isa.
+    bool Force(const std::string &isa);
+
+  private:
+    // ordered like SupportedIsas()
+    std::vector<std::pair<CpuIsa, Impl>> impls_;
+    // index in impls_ of the variant Get() returns
+    std::atomic<size_t> forced_;
+};
+
+template <typename Impl>
+IsaDispatch<Impl>::IsaDispatch(const std::vector<std::pair<CpuIsa, Impl>> &impls)
+    : forced_(0)
+{
+    for (CpuIsa isa : SupportedIsas()) {
+        for (const auto &impl : impls) {
+            if (impl.first == isa) {
+                impls_.push_back(impl);
+            }
+        }
+    }
+}
+
+template <typename Impl>
+bool IsaDispatch<Impl>::Force(const std::string &isa)
+{
+    if (isa.empty()) {
+        forced_.store(0, std::memory_order_release);
+        return true;
+    }
+    for (size_t i = 0; i < impls_.size(); i++) {
+        if (isa == IsaName(impls_[i].first)) {
+            forced_.store(i, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace funasr
+#endif
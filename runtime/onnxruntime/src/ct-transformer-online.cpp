@@ -7,17 +7,17 @@
 
 namespace funasr {
 CTTransformerOnline::CTTransformerOnline()
-:env_(ORT_LOGGING_LEVEL_ERROR, ""),session_options{}
+:session_options{}
 {
 }
 
 void CTTransformerOnline::InitPunc(const std::string &punc_model, const std::string &punc_config, const std::string &token_file, int thread_num){
-    session_options.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options, thread_num);
     session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     session_options.DisableCpuMemArena();
 
     try{
-        m_session = std::make_unique<Ort::Session>(env_, ORTSTRING(punc_model).c_str(), session_options);
+        m_session = ModelRegistry::GetSession(punc_model, session_options, thread_num);
         LOG(INFO) << "Successfully load model from " << punc_model;
     }
     catch (std::exception const &e) {
@@ -15,6 +15,8 @@
 #include <iostream>
 #include <numeric>
 #include <cassert>
+#include <climits>
+#include <stdint.h>
 
 namespace funasr {
 enum class VadStateMachine {
@@ -304,18 +306,19 @@ public:
                bool online = false, int max_end_sil = 800, int max_single_segment_time = 15000,
                float speech_noise_thres = 0.8, int sample_rate = 16000) {
         max_end_sil_frame_cnt_thresh = max_end_sil - vad_opts.speech_to_sil_time_thres;
-        this->waveform = waveform;
         this->vad_opts.max_single_segment_time = max_single_segment_time;
         this->speech_noise_thres = speech_noise_thres;
         this->vad_opts.sample_rate = sample_rate;
 
-        ComputeDecibel();
+        ComputeDecibel(waveform);
         ComputeScores(score);
         if (!is_final) {
             DetectCommonFrames();
         } else {
             DetectLastFrames();
         }
+        // score is only read during this call
+        scores = nullptr;
 
         std::vector<std::vector<int>> segment_batch;
         if (output_data_buf.size() > 0) {
@@ -352,6 +355,13 @@ public:
                 std::vector<int> segment = {start_ms, end_ms};
                 segment_batch.push_back(segment);
             }
+            // drop the segments already returned, the last one is kept since
+            // PopDataToOutputBuf may still extend it
+            int num_done = std::min(output_data_buf_offset, (int)output_data_buf.size() - 1);
+            if (num_done > 0) {
+                output_data_buf.erase(output_data_buf.begin(), output_data_buf.begin() + num_done);
+                output_data_buf_offset -= num_done;
+            }
         }
 
         if (is_final) {
@@ -378,18 +388,26 @@ private:
     float noise_average_decibel;
     bool pre_end_silence_detected;
     bool next_seg;
+    // segments not returned yet, plus the last returned one
     std::vector<E2EVadSpeechBufWithDoa> output_data_buf;
     int output_data_buf_offset;
+    // probs of the current chunk only
     std::vector<E2EVadFrameProb> frame_probs;
     int max_end_sil_frame_cnt_thresh;
     float speech_noise_thres;
-    std::vector<std::vector<float>> scores;
+    // scores of the current chunk, not owned
+    const std::vector<std::vector<float>> *scores = nullptr;
     int idx_pre_chunk = 0;
     bool max_time_out;
+    // decibel of the frames from decibel_start_frame on, only the current chunk
+    // is kept so the memory does not grow with the stream
     std::vector<float> decibel;
+    int decibel_start_frame = 0;
     int data_buf_size = 0;
-    int data_buf_all_size = 0;
-    std::vector<float> waveform;
+    // samples fed minus the samples of the frames before data_buf_start_frame,
+    // 64 bit since the overlap of consecutive chunks is counted twice
+    int64_t data_buf_avail_size = 0;
+    bool data_buf_started = false;
 
     void AllResetDetection() {
         is_final = false;
@@ -412,13 +430,14 @@ private:
         frame_probs.clear();
         max_end_sil_frame_cnt_thresh = vad_opts.max_end_silence_time - vad_opts.speech_to_sil_time_thres;
         speech_noise_thres = vad_opts.speech_noise_thres;
-        scores.clear();
+        scores = nullptr;
         idx_pre_chunk = 0;
         max_time_out = false;
         decibel.clear();
-        int data_buf_size = 0;
-        int data_buf_all_size = 0;
-        waveform.clear();
+        decibel_start_frame = 0;
+        data_buf_size = 0;
+        data_buf_avail_size = 0;
+        data_buf_started = false;
         ResetDetection();
     }
 
@@ -434,14 +453,21 @@ private:
         frame_probs.clear();
     }
 
-    void ComputeDecibel() {
+    void ComputeDecibel(const std::vector<float> &waveform) {
         int frame_sample_length = int(vad_opts.frame_length_ms * vad_opts.sample_rate / 1000);
         int frame_shift_length = int(vad_opts.frame_in_ms * vad_opts.sample_rate / 1000);
-        if (data_buf_all_size == 0) {
-          data_buf_all_size = waveform.size();
-          data_buf_size = data_buf_all_size;
+        if (!data_buf_started) {
+          data_buf_started = !waveform.empty();
+          data_buf_avail_size = (int64_t)waveform.size() - (int64_t)data_buf_start_frame * frame_shift_length;
+          data_buf_size = waveform.size();
         } else {
-          data_buf_all_size += waveform.size();
+          data_buf_avail_size += waveform.size();
+        }
+        // frames before this chunk are not looked at again
+        int num_done = std::min((int)decibel.size(), frm_cnt - decibel_start_frame);
+        if (num_done > 0) {
+            decibel.erase(decibel.begin(), decibel.begin() + num_done);
+            decibel_start_frame += num_done;
         }
         for (int offset = 0; offset + frame_sample_length -1 < waveform.size(); offset += frame_shift_length) {
             float sum = 0.0;
@@ -455,7 +481,8 @@ private:
     void ComputeScores(const std::vector<std::vector<float>> &scores) {
         vad_opts.nn_eval_block_size = scores.size();
         frm_cnt += scores.size();
-        this->scores = scores;
+        this->scores = &scores;
+        frame_probs.clear();
     }
 
     void PopDataBufTillFrame(int frame_idx) {
@@ -463,7 +490,8 @@ private:
       while (data_buf_start_frame < frame_idx) {
         if (data_buf_size >= frame_sample_length) {
           data_buf_start_frame += 1;
-          data_buf_size = data_buf_all_size - data_buf_start_frame * frame_sample_length;
+          data_buf_avail_size -= frame_sample_length;
+          data_buf_size = (int)std::min<int64_t>(data_buf_avail_size, INT_MAX);
         }
       }
     }
@@ -512,6 +540,7 @@ private:
             std::cout << "Something wrong with the VAD algorithm\n";
         }
         data_buf_start_frame += frm_cnt;
+        data_buf_avail_size -= (int64_t)frm_cnt * int(vad_opts.frame_in_ms * vad_opts.sample_rate / 1000);
         cur_seg.end_ms = (start_frm + frm_cnt) * vad_opts.frame_in_ms;
         if (first_frm_is_start_point) {
             cur_seg.contain_seg_start_point = true;
@@ -590,7 +619,7 @@ private:
 
     FrameState GetFrameState(int t) {
         FrameState frame_state = FrameState::kFrameStateInvalid;
-        float cur_decibel = decibel[t];
+        float cur_decibel = decibel[t - decibel_start_frame];
         float cur_snr = cur_decibel - noise_average_decibel;
         if (cur_decibel < vad_opts.decibel_thres) {
             frame_state = FrameState::kFrameStateSil;
@@ -601,11 +630,12 @@ private:
         float noise_prob = 0.0;
         assert(sil_pdf_ids.size() == vad_opts.silence_pdf_num);
         if (sil_pdf_ids.size() > 0) {
-            std::vector<float> sil_pdf_scores;
+            const std::vector<float> &frame_scores = (*scores)[t - idx_pre_chunk];
+            double sil_sum = 0.0;
             for (auto sil_pdf_id: sil_pdf_ids) {
-                sil_pdf_scores.push_back(scores[t - idx_pre_chunk][sil_pdf_id]);
+                sil_sum += frame_scores[sil_pdf_id];
             }
-            sum_score = accumulate(sil_pdf_scores.begin(), sil_pdf_scores.end(), 0.0);
+            sum_score = sil_sum;
             noise_prob = log(sum_score) * vad_opts.speech_2_noise_ratio;
             float total_score = 1.0;
             sum_score = total_score - sum_score;
@@ -647,7 +677,7 @@ private:
             frame_state = GetFrameState(frm_cnt - 1 - i);
             DetectOneFrame(frame_state, frm_cnt - 1 - i, false);
         }
-        idx_pre_chunk += scores.size();
+        idx_pre_chunk += scores->size();
         return 0;
     }
 
@@ -0,0 +1,95 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include <functional>
+
+namespace funasr {
+
+bool FbankCache::Reset(const knf::FbankOptions &opts, const float *waves, int len)
+{
+    Clear();
+    // dithered frames are random, and without snip_edges the frames of a
+    // segment are not a slice of the frames of the whole utterance
+    if (opts.frame_opts.dither != 0 || !opts.frame_opts.snip_edges || waves == nullptr || len <= 0) {
+        return false;
+    }
+    opts_ = opts;
+    waves_ = waves;
+    len_ = len;
+    feats_.Resize(0, opts.mel_opts.num_bins + (opts.use_energy ? 1 : 0));
+    feats_.Reserve(knf::NumFrames(len, opts.frame_opts));
+    return true;
+}
+
+void FbankCache::Clear()
+{
+    waves_ = nullptr;
+    len_ = 0;
+    feats_.Clear();
+    joined_.clear();
+}
+
+void FbankCache::Join(const std::vector<const FbankCache*> &caches)
+{
+    Clear();
+    joined_ = caches;
+}
+
+bool FbankCache::SameOptions(const knf::FbankOptions &a, const knf::FbankOptions &b)
+{
+    // max_feature_vectors only limits the online frame buffer and debug_mel only logs
+    const knf::FrameExtractionOptions &fa = a.frame_opts;
+    const knf::FrameExtractionOptions &fb = b.frame_opts;
+    if (fa.samp_freq != fb.samp_freq || fa.frame_shift_ms != fb.frame_shift_ms ||
+        fa.frame_length_ms != fb.frame_length_ms || fa.dither != fb.dither ||
+        fa.preemph_coeff != fb.preemph_coeff || fa.remove_dc_offset != fb.remove_dc_offset ||
+        fa.window_type != fb.window_type || fa.round_to_power_of_two != fb.round_to_power_of_two ||
+        fa.blackman_coeff != fb.blackman_coeff || fa.snip_edges != fb.snip_edges) {
+        return false;
+    }
+    const knf::MelBanksOptions &ma = a.mel_opts;
+    const knf::MelBanksOptions &mb = b.mel_opts;
+    if (ma.num_bins != mb.num_bins || ma.low_freq != mb.low_freq || ma.high_freq != mb.high_freq ||
+        ma.vtln_low != mb.vtln_low || ma.vtln_high != mb.vtln_high || ma.htk_mode != mb.htk_mode) {
+        return false;
+    }
+    return a.use_energy == b.use_energy && a.energy_floor == b.energy_floor &&
+           a.raw_energy == b.raw_energy && a.htk_compat == b.htk_compat &&
+           a.use_log_fbank == b.use_log_fbank && a.use_power == b.use_power;
+}
+
+const float *FbankCache::GetSegment(const knf::FbankOptions &opts, const float *waves, int len, int &num_frames) const
+{
+    num_frames = 0;
+    for (auto cache : joined_) {
+        const float *rows = cache->GetSegment(opts, waves, len, num_frames);
+        if (rows != nullptr) {
+            return rows;
+        }
+    }
+    if (waves_ == nullptr || feats_.Empty() || !SameOptions(opts_, opts)) {
+        return nullptr;
+    }
+    std::less<const float*> less;
+    if (less(waves, waves_) || less(waves_ + len_, waves + len)) {
+        return nullptr;
+    }
+    // with snip_edges frame k of the segment is frame offset/shift + k of the utterance
+    int offset = (int)(waves - waves_);
+    int shift = opts.frame_opts.WindowShift();
+    if (shift <= 0 || offset % shift != 0) {
+        return nullptr;
+    }
+    int start = offset / shift;
+    int frames = knf::NumFrames(len, opts.frame_opts);
+    if (frames <= 0 || start + frames > feats_.NumRows()) {
+        return nullptr;
+    }
+    num_frames = frames;
+    return feats_.Row(start);
+}
+
+} // namespace funasr
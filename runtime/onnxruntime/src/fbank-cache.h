@@ -0,0 +1,48 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef FBANK_CACHE_H
+#define FBANK_CACHE_H
+
+#include <vector>
+#include "kaldi-native-fbank/csrc/feature-fbank.h"
+#include "feature-matrix.h"
+
+namespace funasr {
+
+// Fbank of a whole offline utterance, filled by the vad while it runs over the
+// samples. The offline asr models take the rows of each vad segment from it
+// instead of computing the same frames a second time, and fall back to their own
+// FbankKaldi when their fbank options differ or a segment is not frame aligned.
+class FbankCache {
+  public:
+    // Starts a cache for the fbank of waves[0, len), the rows are appended to
+    // Feats() by the caller. Returns false (and disables the cache) if frames
+    // computed with opts can not be reused, e.g. with dither.
+    bool Reset(const knf::FbankOptions &opts, const float *waves, int len);
+    void Clear();
+    FeatureMatrix &Feats() { return feats_; }
+    // Serves the segments of several utterances from their own caches, for
+    // batches mixing the segments of different requests. The caches must not
+    // change while this one is used.
+    void Join(const std::vector<const FbankCache*> &caches);
+
+    // Rows of the segment waves[0, len) computed with opts, or nullptr if the
+    // segment can not be served from the cache. waves must point into the
+    // buffer given to Reset() to be found.
+    const float *GetSegment(const knf::FbankOptions &opts, const float *waves, int len, int &num_frames) const;
+
+  private:
+    static bool SameOptions(const knf::FbankOptions &a, const knf::FbankOptions &b);
+
+    knf::FbankOptions opts_;
+    const float *waves_ = nullptr;
+    int len_ = 0;
+    FeatureMatrix feats_;
+    std::vector<const FbankCache*> joined_;
+};
+
+} // namespace funasr
+#endif
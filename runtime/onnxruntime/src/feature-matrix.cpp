@@ -0,0 +1,137 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+
+namespace funasr {
+
+#define FEATURE_MATRIX_ALIGN 64
+
+FeatureMatrix::FeatureMatrix()
+{
+}
+
+FeatureMatrix::FeatureMatrix(int num_rows, int num_cols)
+{
+    Resize(num_rows, num_cols);
+}
+
+FeatureMatrix::~FeatureMatrix()
+{
+    if (data_) {
+        AlignedFree(data_);
+    }
+}
+
+FeatureMatrix::FeatureMatrix(FeatureMatrix &&other) noexcept
+    : data_(other.data_), num_rows_(other.num_rows_), num_cols_(other.num_cols_), capacity_(other.capacity_)
+{
+    other.data_ = nullptr;
+    other.num_rows_ = 0;
+    other.capacity_ = 0;
+}
+
+FeatureMatrix &FeatureMatrix::operator=(FeatureMatrix &&other) noexcept
+{
+    if (this != &other) {
+        if (data_) {
+            AlignedFree(data_);
+        }
+        data_ = other.data_;
+        num_rows_ = other.num_rows_;
+        num_cols_ = other.num_cols_;
+        capacity_ = other.capacity_;
+        other.data_ = nullptr;
+        other.num_rows_ = 0;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+void FeatureMatrix::Grow(size_t min_size)
+{
+    if (min_size <= capacity_) {
+        return;
+    }
+    size_t new_capacity = std::max(min_size, capacity_ * 2);
+    float *new_data = (float *)AlignedMalloc(FEATURE_MATRIX_ALIGN, new_capacity * sizeof(float));
+    if (new_data == nullptr) {
+        throw std::bad_alloc();
+    }
+    if (data_) {
+        memcpy(new_data, data_, Size() * sizeof(float));
+        AlignedFree(data_);
+    }
+    data_ = new_data;
+    capacity_ = new_capacity;
+}
+
+void FeatureMatrix::Resize(int num_rows, int num_cols)
+{
+    if (num_cols != num_cols_) {
+        num_rows_ = 0;
+        num_cols_ = num_cols;
+    }
+    Grow((size_t)num_rows * num_cols);
+    num_rows_ = num_rows;
+}
+
+void FeatureMatrix::Reserve(int num_rows)
+{
+    Grow((size_t)num_rows * num_cols_);
+}
+
+void FeatureMatrix::Zeros()
+{
+    if (data_) {
+        memset(data_, 0, Size() * sizeof(float));
+    }
+}
+
+void FeatureMatrix::CopyFrom(const FeatureMatrix &other)
+{
+    Resize(other.num_rows_, other.num_cols_);
+    if (other.num_rows_ > 0) {
+        memcpy(data_, other.data_, other.Size() * sizeof(float));
+    }
+}
+
+float *FeatureMatrix::AppendRow()
+{
+    Grow(Size() + num_cols_);
+    return Row(num_rows_++);
+}
+
+void FeatureMatrix::AppendRow(const float *row)
+{
+    memcpy(AppendRow(), row, num_cols_ * sizeof(float));
+}
+
+void FeatureMatrix::AppendRows(const float *rows, int num_rows)
+{
+    if (num_rows <= 0) {
+        return;
+    }
+    Grow(Size() + (size_t)num_rows * num_cols_);
+    memcpy(Row(num_rows_), rows, (size_t)num_rows * num_cols_ * sizeof(float));
+    num_rows_ += num_rows;
+}
+
+void FeatureMatrix::AppendRows(const FeatureMatrix &other, int start, int end)
+{
+    AppendRows(other.Row(start), end - start);
+}
+
+void FeatureMatrix::EraseFront(int num_rows)
+{
+    if (num_rows >= num_rows_) {
+        num_rows_ = 0;
+        return;
+    }
+    memmove(data_, Row(num_rows), (size_t)(num_rows_ - num_rows) * num_cols_ * sizeof(float));
+    num_rows_ -= num_rows;
+}
+
+} // namespace funasr
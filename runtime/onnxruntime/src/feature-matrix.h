@@ -0,0 +1,62 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef FEATURE_MATRIX_H
+#define FEATURE_MATRIX_H
+
+#include <stddef.h>
+#include "alignedmem.h"
+
+namespace funasr {
+
+// Row-major float matrix with a single aligned buffer, used for features from
+// fbank through lfr/cmvn up to the onnx input tensor. Rows are stored back to
+// back (stride == num_cols), so Data() can be wrapped by Ort::Value directly.
+// Capacity is kept on Clear()/Resize() to avoid reallocation between chunks.
+class FeatureMatrix {
+  public:
+    FeatureMatrix();
+    FeatureMatrix(int num_rows, int num_cols);
+    ~FeatureMatrix();
+    FeatureMatrix(FeatureMatrix &&other) noexcept;
+    FeatureMatrix &operator=(FeatureMatrix &&other) noexcept;
+    // copies must be explicit, see CopyFrom()
+    FeatureMatrix(const FeatureMatrix &other) = delete;
+    FeatureMatrix &operator=(const FeatureMatrix &other) = delete;
+
+    // rows already present are kept when num_cols is unchanged, new rows are not initialized
+    void Resize(int num_rows, int num_cols);
+    void Reserve(int num_rows);
+    void Clear() { num_rows_ = 0; }
+    void Zeros();
+    void CopyFrom(const FeatureMatrix &other);
+
+    // returns the new (uninitialized) row
+    float *AppendRow();
+    void AppendRow(const float *row);
+    void AppendRows(const float *rows, int num_rows);
+    void AppendRows(const FeatureMatrix &other, int start, int end);
+    void EraseFront(int num_rows);
+
+    float *Row(int i) { return data_ + (size_t)i * num_cols_; }
+    const float *Row(int i) const { return data_ + (size_t)i * num_cols_; }
+    float *Data() { return data_; }
+    const float *Data() const { return data_; }
+    int NumRows() const { return num_rows_; }
+    int NumCols() const { return num_cols_; }
+    size_t Size() const { return (size_t)num_rows_ * num_cols_; }
+    bool Empty() const { return num_rows_ == 0; }
+
+  private:
+    void Grow(size_t min_size);
+
+    float *data_ = nullptr;
+    int num_rows_ = 0;
+    int num_cols_ = 0;
+    size_t capacity_ = 0;
+};
+
+} // namespace funasr
+#endif
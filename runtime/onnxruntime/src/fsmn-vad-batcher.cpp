@@ -0,0 +1,106 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "fsmn-vad-batcher.h"
+
+namespace funasr {
+
+FsmnVadBatcher::FsmnVadBatcher(FsmnVad *fsmnvad, int max_batch, int max_wait_us)
+    : fsmnvad_(fsmnvad), batch_supported_(HasBatchDim(fsmnvad->vad_session_.get())), queue_(max_batch, max_wait_us)
+{
+    if (!batch_supported_) {
+        LOG(WARNING) << "Vad model has a fixed batch dim, its online chunks are run one by one";
+    }
+}
+
+void FsmnVadBatcher::Forward(const FeatureMatrix &chunk_feats,
+                             std::vector<std::vector<float>> *out_prob,
+                             std::vector<std::vector<float>> *in_cache,
+                             bool is_final)
+{
+    if (!batch_supported_ || queue_.MaxBatch() <= 1) {
+        fsmnvad_->Forward(chunk_feats, out_prob, in_cache, is_final);
+        return;
+    }
+
+    Request req = {&chunk_feats, out_prob, in_cache, is_final, false};
+    queue_.Submit({&req}, chunk_feats.NumRows(), [this](const std::vector<Request*> &batch) { RunBatch(batch); });
+}
+
+void FsmnVadBatcher::RunBatch(const std::vector<Request*> &batch)
+{
+    int batch_size = batch.size();
+    if (batch_size == 1) {
+        fsmnvad_->Forward(*batch[0]->feats, batch[0]->out_prob, batch[0]->in_cache, batch[0]->is_final);
+        return;
+    }
+
+    int num_frames = batch[0]->feats->NumRows();
+    int feature_dim = batch[0]->feats->NumCols();
+    FeatureMatrix batch_feats(batch_size * num_frames, feature_dim);
+    for (int b = 0; b < batch_size; b++) {
+        memcpy(batch_feats.Row(b * num_frames), batch[b]->feats->Data(), batch[b]->feats->Size() * sizeof(float));
+    }
+    int num_caches = batch[0]->in_cache->size();
+    std::vector<std::vector<float>> batch_caches(num_caches);
+    for (int i = 0; i < num_caches; i++) {
+        size_t cache_size = (*batch[0]->in_cache)[i].size();
+        batch_caches[i].resize(batch_size * cache_size);
+        for (int b = 0; b < batch_size; b++) {
+            memcpy(batch_caches[i].data() + b * cache_size, (*batch[b]->in_cache)[i].data(), cache_size * sizeof(float));
+        }
+    }
+
+    Ort::MemoryInfo memory_info =
+            Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+    const int64_t vad_feats_shape[3] = {batch_size, num_frames, feature_dim};
+    std::vector<Ort::Value> vad_inputs;
+    vad_inputs.emplace_back(Ort::Value::CreateTensor<float>(
+            memory_info, batch_feats.Data(), batch_feats.Size(), vad_feats_shape, 3));
+    // cache node {batch,128,19,1}
+    const int64_t cache_feats_shape[4] = {batch_size, 128, 19, 1};
+    for (int i = 0; i < num_caches; i++) {
+        vad_inputs.emplace_back(Ort::Value::CreateTensor<float>(
+                memory_info, batch_caches[i].data(), batch_caches[i].size(), cache_feats_shape, 4));
+    }
+
+    std::vector<Ort::Value> vad_ort_outputs;
+    try {
+        vad_ort_outputs = fsmnvad_->vad_session_->Run(
+                Ort::RunOptions{nullptr}, fsmnvad_->vad_in_names_.data(), vad_inputs.data(),
+                vad_inputs.size(), fsmnvad_->vad_out_names_.data(), fsmnvad_->vad_out_names_.size());
+    } catch (std::exception const &e) {
+        LOG(WARNING) << "Batched vad forward failed, running its chunks one by one: " << e.what();
+        for (auto req : batch) {
+            fsmnvad_->Forward(*req->feats, req->out_prob, req->in_cache, req->is_final);
+        }
+        return;
+    }
+
+    // scatter probs and caches back to the sessions
+    const float *logp_data = vad_ort_outputs[0].GetTensorData<float>();
+    auto shape = vad_ort_outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+    int num_outputs = shape[1];
+    int output_dim = shape[2];
+    for (int b = 0; b < batch_size; b++) {
+        std::vector<std::vector<float>> &out_prob = *batch[b]->out_prob;
+        out_prob.resize(num_outputs);
+        for (int t = 0; t < num_outputs; t++) {
+            const float *row = logp_data + ((size_t)b * num_outputs + t) * output_dim;
+            out_prob[t].assign(row, row + output_dim);
+        }
+        if (batch[b]->is_final) {
+            continue;
+        }
+        for (int i = 0; i < num_caches; i++) {
+            std::vector<float> &cache = (*batch[b]->in_cache)[i];
+            const float *data = vad_ort_outputs[i + 1].GetTensorData<float>();
+            memcpy(cache.data(), data + b * cache.size(), cache.size() * sizeof(float));
+        }
+    }
+}
+
+} // namespace funasr
@@ -0,0 +1,51 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef FSMN_VAD_BATCHER_H
+#define FSMN_VAD_BATCHER_H
+
+#include <vector>
+#include "batch-queue.h"
+
+namespace funasr {
+class FsmnVad;
+class FeatureMatrix;
+
+// Runs the online vad chunks of many sessions sharing one FsmnVad as a single
+// batched onnx run. The first caller of a batch waits up to max_wait_us for
+// other sessions, then stacks the features and the fsmn caches of all chunks
+// with the same number of frames (the model has no length input and the caches
+// are taken from the last frames, so chunks can not be padded), runs them and
+// hands every caller its probs and caches back. Callers block until their own
+// chunk has run, so the contract is the one of FsmnVad::Forward.
+class FsmnVadBatcher {
+  public:
+    FsmnVadBatcher(FsmnVad *fsmnvad, int max_batch, int max_wait_us);
+
+    void Forward(const FeatureMatrix &chunk_feats,
+                 std::vector<std::vector<float>> *out_prob,
+                 std::vector<std::vector<float>> *in_cache,
+                 bool is_final);
+
+  private:
+    struct Request {
+        const FeatureMatrix *feats;
+        std::vector<std::vector<float>> *out_prob;
+        std::vector<std::vector<float>> *in_cache;
+        bool is_final;
+        bool done;
+    };
+
+    void RunBatch(const std::vector<Request*> &batch);
+
+    FsmnVad *fsmnvad_;
+    // false when the vad model has a fixed batch dim, e.g. one exported with batch 1
+    const bool batch_supported_;
+    // chunks of equal num_frames can be stacked
+    BatchQueue<Request, int> queue_;
+};
+
+} // namespace funasr
+#endif
@@ -8,78 +8,65 @@
 
 namespace funasr {
 
-void FsmnVadOnline::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
-                               std::vector<float> &waves) {
-    knf::OnlineFbank fbank(fbank_opts_);
-    // cache merge
-    waves.insert(waves.begin(), input_cache_.begin(), input_cache_.end());
-    int frame_number = ComputeFrameNum(waves.size(), frame_sample_length_, frame_shift_sample_length_);
-    // Send the audio after the last frame shift position to the cache
-    input_cache_.clear();
-    input_cache_.insert(input_cache_.begin(), waves.begin() + frame_number * frame_shift_sample_length_, waves.end());
-    if (frame_number == 0) {
-        return;
-    }
-    // Delete audio that haven't undergone fbank processing
-    waves.erase(waves.begin() + (frame_number - 1) * frame_shift_sample_length_ + frame_sample_length_, waves.end());
-
-    std::vector<float> buf(waves.size());
-    for (int32_t i = 0; i != waves.size(); ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
-    // fbank.AcceptWaveform(sample_rate, &waves[0], waves.size());
-    int32_t frames = fbank.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        vad_feats.emplace_back(frame_vector);
-    }
+// Feeds only the new samples to the long-lived fbank_ and returns the frames it made ready
+void FsmnVadOnline::FbankKaldi(float sample_rate, FeatureMatrix &vad_feats,
+                               const float *waves, int len, bool input_finished) {
+    int32_t num_bins = fbank_opts_.mel_opts.num_bins;
+    vad_feats.Resize(0, num_bins);
+    // at most ONLINE_FBANK_MAX_FRAMES frames per AcceptWaveform, so none is recycled before it is read
+    int step = ONLINE_FBANK_MAX_FRAMES * frame_shift_sample_length_;
+    int offset = 0;
+    do {
+        int n = std::min(step, len - offset);
+        if (n > 0) {
+            fbank_buf_.resize(n);
+            for (int32_t i = 0; i != n; ++i) {
+                fbank_buf_[i] = waves[offset + i] * 32768;
+            }
+            fbank_->AcceptWaveform(sample_rate, fbank_buf_.data(), n);
+            offset += n;
+        }
+        if (offset >= len && input_finished) {
+            fbank_->InputFinished();
+        }
+        for (; fbank_frames_ < fbank_->NumFramesReady(); ++fbank_frames_) {
+            vad_feats.AppendRow(fbank_->GetFrame(fbank_frames_));
+        }
+    } while (offset < len);
 }
 
-void FsmnVadOnline::ExtractFeats(float sample_rate, vector<std::vector<float>> &vad_feats,
+void FsmnVadOnline::ExtractFeats(float sample_rate, FeatureMatrix &vad_feats,
                                  vector<float> &waves, bool input_finished) {
-  FbankKaldi(sample_rate, vad_feats, waves);
+  vad_feats.Clear();
+  FbankKaldi(sample_rate, fbank_feats_, waves.data(), waves.size(), input_finished);
+  if (fbank_sink_ != nullptr) {
+    fbank_sink_->AppendRows(fbank_feats_, 0, fbank_feats_.NumRows());
+  }
+  // samples of the frames that have not been scored yet
+  reserve_waveforms_.insert(reserve_waveforms_.end(), waves.begin(), waves.end());
   // cache deal & online lfr,cmvn
-  if (vad_feats.size() > 0) {
-    if (!reserve_waveforms_.empty()) {
-      waves.insert(waves.begin(), reserve_waveforms_.begin(), reserve_waveforms_.end());
-    }
-    if (lfr_splice_cache_.empty()) {
+  if (fbank_feats_.NumRows() > 0) {
+    if (lfr_splice_cache_.Empty()) {
       for (int i = 0; i < (lfr_m - 1) / 2; i++) {
-        lfr_splice_cache_.emplace_back(vad_feats[0]);
-      }
-    }
-    if (vad_feats.size() + lfr_splice_cache_.size() >= lfr_m) {
-      vad_feats.insert(vad_feats.begin(), lfr_splice_cache_.begin(), lfr_splice_cache_.end());
-      int frame_from_waves = (waves.size() - frame_sample_length_) / frame_shift_sample_length_ + 1;
-      int minus_frame = reserve_waveforms_.empty() ? (lfr_m - 1) / 2 : 0;
-      int lfr_splice_frame_idxs = OnlineLfrCmvn(vad_feats, input_finished);
-      int reserve_frame_idx = std::abs(lfr_splice_frame_idxs - minus_frame);
-      reserve_waveforms_.clear();
-      reserve_waveforms_.insert(reserve_waveforms_.begin(),
-                                waves.begin() + reserve_frame_idx * frame_shift_sample_length_,
-                                waves.begin() + frame_from_waves * frame_shift_sample_length_);
-      int sample_length = (frame_from_waves - 1) * frame_shift_sample_length_ + frame_sample_length_;
-      waves.erase(waves.begin() + sample_length, waves.end());
-    } else {
-      reserve_waveforms_.clear();
-      reserve_waveforms_.insert(reserve_waveforms_.begin(),
-                                waves.begin() + frame_sample_length_ - frame_shift_sample_length_, waves.end());
-      lfr_splice_cache_.insert(lfr_splice_cache_.end(), vad_feats.begin(), vad_feats.end());
-    }
-  } else {
-    if (input_finished) {
-      if (!reserve_waveforms_.empty()) {
-        waves = reserve_waveforms_;
-      }
-      vad_feats = lfr_splice_cache_;
-      if(vad_feats.size() == 0){
-        LOG(ERROR) << "vad_feats's size is 0";
-      }else{
-        OnlineLfrCmvn(vad_feats, input_finished);
+        lfr_splice_cache_.AppendRow(fbank_feats_.Row(0));
       }
     }
+    lfr_splice_cache_.AppendRows(fbank_feats_, 0, fbank_feats_.NumRows());
+  }
+  if (lfr_splice_cache_.NumRows() >= lfr_m || (input_finished && !lfr_splice_cache_.Empty())) {
+    OnlineLfrCmvn(vad_feats, input_finished);
+  } else if (input_finished) {
+    LOG(ERROR) << "vad_feats's size is 0";
+  }
+
+  // hand the scorer exactly the samples of the output frames (lfr_n is 1 for vad)
+  int num_frames = vad_feats.NumRows();
+  if (num_frames > 0) {
+    int sample_length = std::min((int)reserve_waveforms_.size(),
+                                 (num_frames - 1) * frame_shift_sample_length_ + frame_sample_length_);
+    int shift_length = std::min((int)reserve_waveforms_.size(), num_frames * frame_shift_sample_length_);
+    waves.assign(reserve_waveforms_.begin(), reserve_waveforms_.begin() + sample_length);
+    reserve_waveforms_.erase(reserve_waveforms_.begin(), reserve_waveforms_.begin() + shift_length);
   }
   if(input_finished){
       Reset();
@@ -87,60 +74,35 @@ void FsmnVadOnline::ExtractFeats(float sample_rate, vector<std::vector<float>> &
   }
 }
 
-int FsmnVadOnline::OnlineLfrCmvn(vector<vector<float>> &vad_feats, bool input_finished) {
-    vector<vector<float>> out_feats;
-    int T = vad_feats.size();
+// Consumes the frames in lfr_splice_cache_ and keeps the ones needed by the next chunk
+int FsmnVadOnline::OnlineLfrCmvn(FeatureMatrix &vad_feats, bool input_finished) {
+    const FeatureMatrix &in_feats = lfr_splice_cache_;
+    int T = in_feats.NumRows();
     int T_lrf = ceil((T - (lfr_m - 1) / 2) / (float)lfr_n);
-    int lfr_splice_frame_idxs = T_lrf;
-    vector<float> p;
-    for (int i = 0; i < T_lrf; i++) {
-        if (lfr_m <= T - i * lfr_n) {
-            for (int j = 0; j < lfr_m; j++) {
-                p.insert(p.end(), vad_feats[i * lfr_n + j].begin(), vad_feats[i * lfr_n + j].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        } else {
-            if (input_finished) {
-                int num_padding = lfr_m - (T - i * lfr_n);
-                for (int j = 0; j < (vad_feats.size() - i * lfr_n); j++) {
-                    p.insert(p.end(), vad_feats[i * lfr_n + j].begin(), vad_feats[i * lfr_n + j].end());
-                }
-                for (int j = 0; j < num_padding; j++) {
-                    p.insert(p.end(), vad_feats[vad_feats.size() - 1].begin(), vad_feats[vad_feats.size() - 1].end());
-                }
-                out_feats.emplace_back(p);
-                p.clear();
-            } else {
-                lfr_splice_frame_idxs = i;
-                break;
-            }
-        }
+    // without input_finished, only the windows with lfr_m real frames are output
+    int num_out = T_lrf;
+    if (!input_finished) {
+        num_out = T >= lfr_m ? std::min(T_lrf, (T - lfr_m) / lfr_n + 1) : 0;
     }
-    lfr_splice_frame_idxs = std::min(T - 1, lfr_splice_frame_idxs * lfr_n);
-    lfr_splice_cache_.clear();
-    lfr_splice_cache_.insert(lfr_splice_cache_.begin(), vad_feats.begin() + lfr_splice_frame_idxs, vad_feats.end());
-
-    // Apply cmvn
-    for (auto &out_feat: out_feats) {
-        for (int j = 0; j < means_list_.size(); j++) {
-            out_feat[j] = (out_feat[j] + means_list_[j]) * vars_list_[j];
-        }
-    }
-    vad_feats = out_feats;
+    vad_feats.Resize(num_out, lfr_m * in_feats.NumCols());
+    // the left padding is already in lfr_splice_cache_
+    ApplyLfrCmvn(in_feats.Data(), T, in_feats.NumCols(), lfr_m, lfr_n, 0,
+                 means_list_, vars_list_, vad_feats.Data(), num_out);
+
+    int lfr_splice_frame_idxs = std::min(T - 1, num_out * lfr_n);
+    lfr_splice_cache_.EraseFront(lfr_splice_frame_idxs);
     return lfr_splice_frame_idxs;
 }
 
 std::vector<std::vector<int>>
 FsmnVadOnline::Infer(std::vector<float> &waves, bool input_finished) {
     std::vector<std::vector<int>> vad_segments;
-    std::vector<std::vector<float>> vad_feats;
     std::vector<std::vector<float>> vad_probs;
-    ExtractFeats(vad_sample_rate_, vad_feats, waves, input_finished);
-    if(vad_feats.size() == 0){
+    ExtractFeats(vad_sample_rate_, vad_feats_, waves, input_finished);
+    if(vad_feats_.Empty()){
       return vad_segments;
     }
-    fsmnvad_handle_->Forward(vad_feats, &vad_probs, &in_cache_, input_finished);
+    fsmnvad_handle_->BatchForward(vad_feats_, &vad_probs, &in_cache_, input_finished);
     if(vad_probs.size() == 0){
       return vad_segments;
     }
@@ -166,7 +128,6 @@ void FsmnVadOnline::Test() {
 }
 
 void FsmnVadOnline::InitOnline(std::shared_ptr<Ort::Session> &vad_session,
-                               Ort::Env &env,
                                std::vector<const char *> &vad_in_names,
                                std::vector<const char *> &vad_out_names,
                                knf::FbankOptions &fbank_opts,
@@ -189,6 +150,9 @@ void FsmnVadOnline::InitOnline(std::shared_ptr<Ort::Session> &vad_session,
 
     frame_sample_length_ = vad_sample_rate_ / 1000 * 25;;
     frame_shift_sample_length_ = vad_sample_rate_ / 1000 * 10;
+    lfr_splice_cache_.Resize(0, fbank_opts_.mel_opts.num_bins);
+    fbank_opts_.frame_opts.max_feature_vectors = ONLINE_FBANK_MAX_FRAMES;
+    fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts_);
 
     // 2pass
     audio_handle = make_unique<Audio>(vad_sample_rate,1);
@@ -200,7 +164,6 @@ FsmnVadOnline::~FsmnVadOnline() {
 FsmnVadOnline::FsmnVadOnline(FsmnVad* fsmnvad_handle):fsmnvad_handle_(std::move(fsmnvad_handle)),session_options_{}{
    InitCache();
    InitOnline(fsmnvad_handle_->vad_session_,
-              fsmnvad_handle_->env_,
               fsmnvad_handle_->vad_in_names_,
               fsmnvad_handle_->vad_out_names_,
               fsmnvad_handle_->fbank_opts_,
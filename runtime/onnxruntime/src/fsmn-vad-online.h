@@ -19,9 +19,13 @@ public:
     ~FsmnVadOnline();
     void Test();
     std::vector<std::vector<int>> Infer(std::vector<float> &waves, bool input_finished);
-    void ExtractFeats(float sample_rate, vector<vector<float>> &vad_feats, vector<float> &waves, bool input_finished);
+    void ExtractFeats(float sample_rate, FeatureMatrix &vad_feats, vector<float> &waves, bool input_finished);
     void Reset();
     int GetVadSampleRate() { return vad_sample_rate_; };
+    const knf::FbankOptions &GetFbankOptions() const { return fbank_opts_; }
+    // every fbank frame computed from now on is also appended to sink (offline
+    // pipeline, so the asr model can reuse them), nullptr to stop
+    void SetFbankSink(FeatureMatrix *sink) { fbank_sink_ = sink; }
 
     // 2pass
     std::unique_ptr<Audio> audio_handle = nullptr;
@@ -31,13 +35,12 @@ private:
     // std::unique_ptr<FsmnVad> fsmnvad_handle_;
     FsmnVad* fsmnvad_handle_ = nullptr;
 
-    void FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
-                    std::vector<float> &waves);
-    int OnlineLfrCmvn(vector<vector<float>> &vad_feats, bool input_finished);
+    void FbankKaldi(float sample_rate, FeatureMatrix &vad_feats,
+                    const float *waves, int len, bool input_finished);
+    int OnlineLfrCmvn(FeatureMatrix &vad_feats, bool input_finished);
     void InitVad(const std::string &vad_model, const std::string &vad_cmvn, const std::string &vad_config, int thread_num){}
     void InitCache();
     void InitOnline(std::shared_ptr<Ort::Session> &vad_session,
-                    Ort::Env &env,
                     std::vector<const char *> &vad_in_names,
                     std::vector<const char *> &vad_out_names,
                     knf::FbankOptions &fbank_opts,
@@ -48,22 +51,15 @@ private:
                     int vad_max_len,
                     double vad_speech_noise_thres);
 
-    static int ComputeFrameNum(int sample_length, int frame_sample_length, int frame_shift_sample_length) {
-        int frame_num = static_cast<int>((sample_length - frame_sample_length) / frame_shift_sample_length + 1);
-        if (frame_num >= 1 && sample_length >= frame_sample_length)
-            return frame_num;
-        else
-            return 0;
-    }
     void ResetCache() {
         reserve_waveforms_.clear();
-        input_cache_.clear();
-        lfr_splice_cache_.clear();
+        lfr_splice_cache_.Clear();
+        fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts_);
+        fbank_frames_ = 0;
     }
 
     // from fsmnvad_handle_
     std::shared_ptr<Ort::Session> vad_session_ = nullptr;
-    Ort::Env env_;
     Ort::SessionOptions session_options_;
     std::vector<const char *> vad_in_names_;
     std::vector<const char *> vad_out_names_;
@@ -72,12 +68,19 @@ private:
     std::vector<float> vars_list_;
 
     std::vector<std::vector<float>> in_cache_;
-    // The reserved waveforms by fbank
+    // fbank state kept for the whole utterance, only new samples are fed to it
+    std::unique_ptr<knf::OnlineFbank> fbank_ = nullptr;
+    // number of frames already read from fbank_
+    int32_t fbank_frames_ = 0;
+    std::vector<float> fbank_buf_;
+    FeatureMatrix *fbank_sink_ = nullptr;
+    // waveforms of the frames not passed to vad_scorer yet
     std::vector<float> reserve_waveforms_;
-    // waveforms reserved after last shift position
-    std::vector<float> input_cache_;
-    // lfr reserved cache
-    std::vector<std::vector<float>> lfr_splice_cache_;
+    // lfr reserved cache, new fbank frames are appended to it before lfr
+    FeatureMatrix lfr_splice_cache_;
+    // per-chunk scratch, reused to avoid reallocation
+    FeatureMatrix fbank_feats_;
+    FeatureMatrix vad_feats_;
 
     int vad_sample_rate_ = MODEL_SAMPLE_RATE;
     int vad_silence_duration_ = VAD_SILENCE_DURATION;
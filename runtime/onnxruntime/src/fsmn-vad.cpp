@@ -8,11 +8,11 @@
 
 namespace funasr {
 void FsmnVad::InitVad(const std::string &vad_model, const std::string &vad_cmvn, const std::string &vad_config, int thread_num) {
-    session_options_.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     session_options_.DisableCpuMemArena();
 
-    ReadModel(vad_model.c_str());
+    ReadModel(vad_model.c_str(), thread_num);
     LoadCmvn(vad_cmvn.c_str());
     LoadConfigFromYaml(vad_config.c_str());
     InitCache();
@@ -22,7 +22,7 @@ void FsmnVad::LoadConfigFromYaml(const char* filename){
 
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(ERROR) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -51,10 +51,9 @@ void FsmnVad::LoadConfigFromYaml(const char* filename){
     }
 }
 
-void FsmnVad::ReadModel(const char* vad_model) {
+void FsmnVad::ReadModel(const char* vad_model, int thread_num) {
     try {
-        vad_session_ = std::make_shared<Ort::Session>(
-                env_, ORTCHAR(vad_model), session_options_);
+        vad_session_ = ModelRegistry::GetSession(vad_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << vad_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load vad onnx model: " << e.what();
@@ -64,26 +63,44 @@ void FsmnVad::ReadModel(const char* vad_model) {
     GetOutputNames(vad_session_.get(), m_strOutputNames, vad_out_names_);
 }
 
+std::unique_ptr<FsmnVad::Binding> FsmnVad::AcquireBinding()
+{
+    {
+        std::lock_guard<std::mutex> lock(bindings_mutex_);
+        if (!bindings_.empty()) {
+            std::unique_ptr<Binding> binding = std::move(bindings_.back());
+            bindings_.pop_back();
+            return binding;
+        }
+    }
+    std::unique_ptr<Binding> binding = std::make_unique<Binding>();
+    binding->binding = std::make_unique<OrtBinding>(vad_session_.get(), vad_in_names_, vad_out_names_);
+    return binding;
+}
+
+void FsmnVad::ReleaseBinding(std::unique_ptr<Binding> binding)
+{
+    std::lock_guard<std::mutex> lock(bindings_mutex_);
+    bindings_.emplace_back(std::move(binding));
+}
+
 void FsmnVad::Forward(
-        const std::vector<std::vector<float>> &chunk_feats,
+        const FeatureMatrix &chunk_feats,
         std::vector<std::vector<float>> *out_prob,
         std::vector<std::vector<float>> *in_cache,
         bool is_final) {
     Ort::MemoryInfo memory_info =
             Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
 
-    int num_frames = chunk_feats.size();
-    const int feature_dim = chunk_feats[0].size();
+    int num_frames = chunk_feats.NumRows();
+    const int feature_dim = chunk_feats.NumCols();
 
     //  2. Generate input nodes tensor
     // vad node { batch,frame number,feature dim }
     const int64_t vad_feats_shape[3] = {1, num_frames, feature_dim};
-    std::vector<float> vad_feats;
-    for (const auto &chunk_feat: chunk_feats) {
-        vad_feats.insert(vad_feats.end(), chunk_feat.begin(), chunk_feat.end());
-    }
+    // onnxruntime only reads the input buffer
     Ort::Value vad_feats_ort = Ort::Value::CreateTensor<float>(
-            memory_info, vad_feats.data(), vad_feats.size(), vad_feats_shape, 3);
+            memory_info, const_cast<float *>(chunk_feats.Data()), chunk_feats.Size(), vad_feats_shape, 3);
     
     // 3. Put nodes into onnx input vector
     std::vector<Ort::Value> vad_inputs;
@@ -95,21 +112,38 @@ void FsmnVad::Forward(
       vad_inputs.emplace_back(std::move(Ort::Value::CreateTensor<float>(
               memory_info, (*in_cache)[i].data(), (*in_cache)[i].size(), cache_feats_shape, 4)));
     }
+    // the next caches are written to the scratch caches of the binding, which
+    // are swapped with in_cache afterwards
+    std::unique_ptr<Binding> binding = AcquireBinding();
+    std::vector<Ort::Value> vad_cache_outputs;
+    if (!is_final) {
+        binding->caches.resize(in_cache->size());
+        for (int i = 0; i < in_cache->size(); i++) {
+            binding->caches[i].resize((*in_cache)[i].size());
+            vad_cache_outputs.emplace_back(Ort::Value::CreateTensor<float>(
+                    memory_info, binding->caches[i].data(), binding->caches[i].size(), cache_feats_shape, 4));
+        }
+    }
   
     // 4. Onnx infer
-    std::vector<Ort::Value> vad_ort_outputs;
     try {
-        vad_ort_outputs = vad_session_->Run(
-                Ort::RunOptions{nullptr}, vad_in_names_.data(), vad_inputs.data(),
-                vad_inputs.size(), vad_out_names_.data(), vad_out_names_.size());
+        for (int i = 0; i < vad_inputs.size(); i++) {
+            binding->binding->BindInput(i, vad_inputs[i]);
+        }
+        for (int i = 0; i < vad_cache_outputs.size(); i++) {
+            binding->binding->BindOutput(i + 1, vad_cache_outputs[i]);
+        }
+        binding->binding->Run(num_frames);
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when run vad onnx forword: " << (e.what());
+        ReleaseBinding(std::move(binding));
         return;
     }
 
     // 5. Change infer result to output shapes
-    float *logp_data = vad_ort_outputs[0].GetTensorMutableData<float>();
-    auto type_info = vad_ort_outputs[0].GetTensorTypeAndShapeInfo();
+    Ort::Value &vad_logp = binding->binding->Output(0);
+    const float *logp_data = vad_logp.GetTensorData<float>();
+    auto type_info = vad_logp.GetTensorTypeAndShapeInfo();
 
     int num_outputs = type_info.GetShape()[1];
     int output_dim = type_info.GetShape()[2];
@@ -122,14 +156,14 @@ void FsmnVad::Forward(
   
     // get 4 caches outputs,each size is 128*19
     if(!is_final){
-        for (int i = 1; i < 5; i++) {
-        float* data = vad_ort_outputs[i].GetTensorMutableData<float>();
-        memcpy((*in_cache)[i-1].data(), data, sizeof(float) * 128*19);
+        for (int i = 0; i < in_cache->size(); i++) {
+            (*in_cache)[i].swap(binding->caches[i]);
         }
     }
+    ReleaseBinding(std::move(binding));
 }
 
-void FsmnVad::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
+void FsmnVad::FbankKaldi(float sample_rate, FeatureMatrix &vad_feats,
                          std::vector<float> &waves) {
     knf::OnlineFbank fbank(fbank_opts_);
 
@@ -139,109 +173,45 @@ void FsmnVad::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad
     }
     fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
     int32_t frames = fbank.NumFramesReady();
+    int32_t num_bins = fbank_opts_.mel_opts.num_bins;
+    vad_feats.Resize(frames, num_bins);
     for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        vad_feats.emplace_back(frame_vector);
+        memcpy(vad_feats.Row(i), fbank.GetFrame(i), num_bins * sizeof(float));
     }
 }
 
 void FsmnVad::LoadCmvn(const char *filename)
 {
     try{
-        using namespace std;
-        ifstream cmvn_stream(filename);
-        if (!cmvn_stream.is_open()) {
-            LOG(ERROR) << "Failed to open file: " << filename;
+        if (!ModelCache::LoadCmvn(filename, means_list_, vars_list_)) {
             exit(-1);
         }
-        string line;
-
-        while (getline(cmvn_stream, line)) {
-            istringstream iss(line);
-            vector<string> line_item{istream_iterator<string>{iss}, istream_iterator<string>{}};
-            if (line_item[0] == "<AddShift>") {
-                getline(cmvn_stream, line);
-                istringstream means_lines_stream(line);
-                vector<string> means_lines{istream_iterator<string>{means_lines_stream}, istream_iterator<string>{}};
-                if (means_lines[0] == "<LearnRateCoef>") {
-                    for (int j = 3; j < means_lines.size() - 1; j++) {
-                        means_list_.push_back(stof(means_lines[j]));
-                    }
-                    continue;
-                }
-            }
-            else if (line_item[0] == "<Rescale>") {
-                getline(cmvn_stream, line);
-                istringstream vars_lines_stream(line);
-                vector<string> vars_lines{istream_iterator<string>{vars_lines_stream}, istream_iterator<string>{}};
-                if (vars_lines[0] == "<LearnRateCoef>") {
-                    for (int j = 3; j < vars_lines.size() - 1; j++) {
-                        // vars_list_.push_back(stof(vars_lines[j])*scale);
-                        vars_list_.push_back(stof(vars_lines[j]));
-                    }
-                    continue;
-                }
-            }
-        }
     }catch(std::exception const &e) {
         LOG(ERROR) << "Error when load vad cmvn : " << e.what();
         exit(-1);
     }
 }
 
-void FsmnVad::LfrCmvn(std::vector<std::vector<float>> &vad_feats) {
-
-    std::vector<std::vector<float>> out_feats;
-    int T = vad_feats.size();
+void FsmnVad::LfrCmvn(const FeatureMatrix &vad_feats, FeatureMatrix &out_feats) {
+    // Pad (lfr_m - 1) / 2 frames at start and fill the last window with the last frame
+    int T = vad_feats.NumRows();
     int T_lrf = ceil(1.0 * T / lfr_n);
-
-    // Pad frames at start(copy first frame)
-    for (int i = 0; i < (lfr_m - 1) / 2; i++) {
-        vad_feats.insert(vad_feats.begin(), vad_feats[0]);
-    }
-    // Merge lfr_m frames as one,lfr_n frames per window
-    T = T + (lfr_m - 1) / 2;
-    std::vector<float> p;
-    for (int i = 0; i < T_lrf; i++) {
-        if (lfr_m <= T - i * lfr_n) {
-            for (int j = 0; j < lfr_m; j++) {
-                p.insert(p.end(), vad_feats[i * lfr_n + j].begin(), vad_feats[i * lfr_n + j].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        } else {
-            // Fill to lfr_m frames at last window if less than lfr_m frames  (copy last frame)
-            int num_padding = lfr_m - (T - i * lfr_n);
-            for (int j = 0; j < (vad_feats.size() - i * lfr_n); j++) {
-                p.insert(p.end(), vad_feats[i * lfr_n + j].begin(), vad_feats[i * lfr_n + j].end());
-            }
-            for (int j = 0; j < num_padding; j++) {
-                p.insert(p.end(), vad_feats[vad_feats.size() - 1].begin(), vad_feats[vad_feats.size() - 1].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        }
-    }
-    // Apply cmvn
-    for (auto &out_feat: out_feats) {
-        for (int j = 0; j < means_list_.size(); j++) {
-            out_feat[j] = (out_feat[j] + means_list_[j]) * vars_list_[j];
-        }
-    }
-    vad_feats = out_feats;
+    out_feats.Resize(T_lrf, lfr_m * vad_feats.NumCols());
+    ApplyLfrCmvn(vad_feats.Data(), T, vad_feats.NumCols(), lfr_m, lfr_n, (lfr_m - 1) / 2,
+                 means_list_, vars_list_, out_feats.Data(), T_lrf);
 }
 
 std::vector<std::vector<int>>
 FsmnVad::Infer(std::vector<float> &waves, bool input_finished) {
-    std::vector<std::vector<float>> vad_feats;
+    FeatureMatrix fbank_feats;
+    FeatureMatrix vad_feats;
     std::vector<std::vector<float>> vad_probs;
     std::vector<std::vector<int>> vad_segments;
-    FbankKaldi(vad_sample_rate_, vad_feats, waves);
-    if(vad_feats.size() == 0){
+    FbankKaldi(vad_sample_rate_, fbank_feats, waves);
+    if(fbank_feats.Empty()){
       return vad_segments;
     }
-    LfrCmvn(vad_feats);
+    LfrCmvn(fbank_feats, vad_feats);
     Forward(vad_feats, &vad_probs, &in_cache_, input_finished);
 
     E2EVadModel vad_scorer = E2EVadModel();
@@ -250,6 +220,27 @@ FsmnVad::Infer(std::vector<float> &waves, bool input_finished) {
     return vad_segments;
 }
 
+void FsmnVad::SetBatchSize(int batch_size) {
+    if (batch_size > 1) {
+        batcher_ = std::make_unique<FsmnVadBatcher>(this, batch_size, VAD_BATCH_WAIT_US);
+        LOG(INFO) << "Online vad chunks are batched across sessions, batch size: " << batch_size;
+    } else {
+        batcher_ = nullptr;
+    }
+}
+
+void FsmnVad::BatchForward(
+        const FeatureMatrix &chunk_feats,
+        std::vector<std::vector<float>> *out_prob,
+        std::vector<std::vector<float>> *in_cache,
+        bool is_final) {
+    if (batcher_) {
+        batcher_->Forward(chunk_feats, out_prob, in_cache, is_final);
+    } else {
+        Forward(chunk_feats, out_prob, in_cache, is_final);
+    }
+}
+
 void FsmnVad::InitCache(){
   std::vector<float> cache_feats(128 * 19 * 1, 0);
   for (int i=0;i<4;i++){
@@ -268,7 +259,7 @@ void FsmnVad::Test() {
 FsmnVad::~FsmnVad() {
 }
 
-FsmnVad::FsmnVad():env_(ORT_LOGGING_LEVEL_ERROR, ""),session_options_{} {
+FsmnVad::FsmnVad():session_options_{} {
 }
 
 } // namespace funasr
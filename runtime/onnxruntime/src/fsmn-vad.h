@@ -23,16 +23,23 @@ public:
     void InitVad(const std::string &vad_model, const std::string &vad_cmvn, const std::string &vad_config, int thread_num);
     std::vector<std::vector<int>> Infer(std::vector<float> &waves, bool input_finished=true);
     void Forward(
-        const std::vector<std::vector<float>> &chunk_feats,
+        const FeatureMatrix &chunk_feats,
         std::vector<std::vector<float>> *out_prob,
         std::vector<std::vector<float>> *in_cache,
         bool is_final);
+    // Forward of an online session, batched with the chunks of other
+    // sessions when SetBatchSize() enabled it
+    void BatchForward(
+        const FeatureMatrix &chunk_feats,
+        std::vector<std::vector<float>> *out_prob,
+        std::vector<std::vector<float>> *in_cache,
+        bool is_final);
+    void SetBatchSize(int batch_size);
     void Reset();
 
     int GetVadSampleRate() { return vad_sample_rate_; };
     
     std::shared_ptr<Ort::Session> vad_session_ = nullptr;
-    Ort::Env env_;
     Ort::SessionOptions session_options_;
     vector<string> m_strInputNames, m_strOutputNames;
     std::vector<const char *> vad_in_names_;
@@ -51,14 +58,26 @@ public:
     int lfr_n = VAD_LFR_N;
 
 private:
+    std::unique_ptr<FsmnVadBatcher> batcher_ = nullptr;
+
+    // io binding of a Forward() call and the buffers the next caches are written to
+    struct Binding {
+        std::unique_ptr<OrtBinding> binding;
+        std::vector<std::vector<float>> caches;
+    };
+    std::unique_ptr<Binding> AcquireBinding();
+    void ReleaseBinding(std::unique_ptr<Binding> binding);
+    // idle bindings, Forward() runs concurrently for many sessions
+    std::mutex bindings_mutex_;
+    std::vector<std::unique_ptr<Binding>> bindings_;
 
-    void ReadModel(const char* vad_model);
+    void ReadModel(const char* vad_model, int thread_num);
     void LoadConfigFromYaml(const char* filename);
 
-    void FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
+    void FbankKaldi(float sample_rate, FeatureMatrix &vad_feats,
                     std::vector<float> &waves);
 
-    void LfrCmvn(std::vector<std::vector<float>> &vad_feats);
+    void LfrCmvn(const FeatureMatrix &vad_feats, FeatureMatrix &out_feats);
     void LoadCmvn(const char *filename);
     void InitCache();
 
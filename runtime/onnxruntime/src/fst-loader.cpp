@@ -0,0 +1,30 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "fst-loader.h"
+
+namespace funasr {
+
+fst::StdFst *ReadFst(const std::string &path)
+{
+    // OpenFst maps the arrays of a ConstFst from the source file at the
+    // position of the stream, so read through the file holding path
+    std::string source;
+    std::unique_ptr<std::istream> stream = ModelBundle::OpenFileStream(path, source);
+    if (!stream) {
+        return nullptr;
+    }
+    fst::FstReadOptions opts(source);
+    opts.mode = fst::FstReadOptions::MAP;
+    fst::StdFst *result = fst::StdFst::Read(*stream, opts);
+    if (result && result->Type() != "const") {
+        LOG(INFO) << path << " is a " << result->Type()
+                  << " fst and is read into memory, convert it with funasr-fst-convert to map it";
+    }
+    return result;
+}
+
+} // namespace funasr
@@ -0,0 +1,21 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef FST_LOADER_H
+#define FST_LOADER_H
+
+#include <string>
+#include "fst/fstlib.h"
+
+namespace funasr {
+
+// Reads the fst at path, a file or a bundle entry. An aligned ConstFst, as
+// written by funasr-fst-convert, is mapped read only instead of copied into
+// the heap, so the worker processes of a host share one copy of TLG.fst and
+// the itn fsts in the page cache. Other fst types are read as before.
+fst::StdFst *ReadFst(const std::string &path);
+
+} // namespace funasr
+#endif
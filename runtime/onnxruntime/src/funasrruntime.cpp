@@ -1,8 +1,44 @@
 #include "precomp.h"
 #include <vector>
+#include <algorithm>
 
 
 	// APIs for Init
+	_FUNASRAPI bool FunRuntimeInit(int cpu_budget, std::string cpu_affinity, std::string model_cache_dir)
+	{
+		return funasr::RuntimeContext::Configure(cpu_budget, cpu_affinity) &&
+		       funasr::ModelCache::SetDir(model_cache_dir);
+	}
+
+	_FUNASRAPI bool FunPackModelBundle(std::string model_dir, std::string bundle_file)
+	{
+		const char *known_names[] = {MODEL_NAME, QUANT_MODEL_NAME, DECODER_NAME, QUANT_DECODER_NAME, MODEL_EB_NAME,
+		                             AM_CMVN_NAME, AM_CONFIG_NAME, TOKEN_PATH, MODEL_SEG_DICT, LM_FST_RES, LEX_PATH,
+		                             ITN_TAGGER_NAME, ITN_VERBALIZER_NAME};
+		std::vector<std::string> names;
+		for (const char *name : known_names) {
+			if (std::find(names.begin(), names.end(), name) == names.end() &&
+			    funasr::ModelBundle::Exists(funasr::PathAppend(model_dir, name))) {
+				names.push_back(name);
+			}
+		}
+		// the punc models load the jieba dicts from the dir of the bundle file
+		size_t slash = bundle_file.find_last_of("/\\");
+		std::string bundle_dir = slash == std::string::npos ? "." : bundle_file.substr(0, slash);
+		for (const char *name : {JIEBA_DICT, JIEBA_USERDICT, JIEBA_HMM_MODEL}) {
+			if (funasr::ModelBundle::Exists(funasr::PathAppend(model_dir, name)) &&
+			    !funasr::ModelBundle::Exists(funasr::PathAppend(bundle_dir, name))) {
+				LOG(WARNING) << name << " can not be bundled, copy it from " << model_dir << " to " << bundle_dir
+				             << ", the punc model loads it from there";
+			}
+		}
+		if (names.empty()) {
+			LOG(ERROR) << "No model files found in " << model_dir;
+			return false;
+		}
+		return funasr::ModelBundle::Pack(model_dir, names, bundle_file);
+	}
+
 	_FUNASRAPI FUNASR_HANDLE  FunASRInit(std::map<std::string, std::string>& model_path, int thread_num, ASR_TYPE type)
 	{
 		funasr::Model* mm = funasr::CreateModel(model_path, thread_num, type);
@@ -15,9 +51,13 @@
 		return mm;
 	}
 
-	_FUNASRAPI FUNASR_HANDLE  FsmnVadInit(std::map<std::string, std::string>& model_path, int thread_num)
+	_FUNASRAPI FUNASR_HANDLE  FsmnVadInit(std::map<std::string, std::string>& model_path, int thread_num, int batch_size)
 	{
 		funasr::VadModel* mm = funasr::CreateVadModel(model_path, thread_num);
+		if (mm) {
+			// online sessions created from this handle share batched vad runs
+			mm->SetBatchSize(batch_size);
+		}
 		return mm;
 	}
 
@@ -33,15 +73,26 @@
 		return mm;
 	}
 
-	_FUNASRAPI FUNASR_HANDLE  FunOfflineInit(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu, int batch_size)
+	_FUNASRAPI FUNASR_HANDLE  FunOfflineInit(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu, int batch_size,
+	                                         int offline_batch_size, int offline_batch_wait_us)
 	{
 		funasr::OfflineStream* mm = funasr::CreateOfflineStream(model_path, thread_num, use_gpu, batch_size);
+		if (mm) {
+			mm->SetRequestBatch(offline_batch_size, offline_batch_wait_us);
+		}
 		return mm;
 	}
 
-	_FUNASRAPI FUNASR_HANDLE  FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num)
+	_FUNASRAPI FUNASR_HANDLE  FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num, int vad_batch_size,
+	                                        int online_batch_size, int online_batch_wait_us)
 	{
 		funasr::TpassStream* mm = funasr::CreateTpassStream(model_path, thread_num);
+		if (mm && mm->vad_handle) {
+			mm->vad_handle->SetBatchSize(vad_batch_size);
+		}
+		if (mm && mm->asr_handle) {
+			mm->asr_handle->SetOnlineBatch(online_batch_size, online_batch_wait_us);
+		}
 		return mm;
 	}
 
@@ -205,10 +256,58 @@
 	}
 
 	// APIs for Offline-stream Infer
-	_FUNASRAPI FUNASR_RESULT FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
-												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
-												   int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
-												   std::string svs_lang, bool svs_itn)
+	// Decodes the segments of audio through the request batcher of offline_stream,
+	// in batches shared with other requests, the wfst search of dec_handle runs
+	// per segment after the batched am. false if the stream has no batcher.
+	static bool RequestBatchForward(funasr::OfflineStream* offline_stream, funasr::Audio &audio, const FunHotwordEmbedding &hw_emb,
+									FUNASR_DEC_HANDLE dec_handle, const std::vector<int> &index_vector,
+									std::vector<string> &msgs, std::vector<float> &msg_stimes)
+	{
+		funasr::OfflineBatcher* request_batcher = offline_stream->GetRequestBatcher();
+		if (!request_batcher) {
+			return false;
+		}
+		float** buff;
+		int* len;
+		int* flag;
+		float* start_time;
+		int batch_in = 0;
+		int msg_idx = 0;
+		std::vector<float*> seg_buff;
+		std::vector<int> seg_len;
+		while (audio.FetchDynamic(buff, len, flag, start_time, 1, batch_in) > 0) {
+			if(msg_idx < index_vector.size()){
+				seg_buff.emplace_back(buff[0]);
+				seg_len.emplace_back(len[0]);
+				msg_stimes[index_vector[msg_idx]] = start_time[0];
+				msg_idx++;
+			}else{
+				LOG(ERROR) << "msg_idx: " << msg_idx <<" is out of range " << index_vector.size();
+			}
+			delete[] buff;
+			delete[] len;
+			delete[] flag;
+			delete[] start_time;
+		}
+		std::vector<string> msg_batch = request_batcher->Forward(offline_stream->asr_handle.get(), seg_buff.data(),
+			seg_len.data(), seg_buff.size(), hw_emb, dec_handle, audio.GetFbankCache());
+		for(int idx=0; idx<msg_batch.size(); idx++){
+			msgs[index_vector[idx]] = msg_batch[idx];
+		}
+		return true;
+	}
+
+	// the embedding of a shared handle, bound by reference so it is never copied
+	static const FunHotwordEmbedding &HotwordsOf(const FUNASR_HW_EMB &hw_emb)
+	{
+		static const FunHotwordEmbedding empty_hw_emb;
+		return hw_emb ? *hw_emb : empty_hw_emb;
+	}
+
+	static FUNASR_RESULT OfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
+											FUNASR_MODE mode, QM_CALLBACK fn_callback, const FunHotwordEmbedding &hw_emb, 
+											int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
+											std::string svs_lang, bool svs_itn)
 	{
 		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
 		if (!offline_stream)
@@ -251,7 +350,8 @@
 
 		std::string cur_stamp = "[";
 		std::string lang = (offline_stream->asr_handle)->GetLang();
-		while (audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
+		bool batched = RequestBatchForward(offline_stream, audio, hw_emb, dec_handle, index_vector, msgs, msg_stimes);
+		while (!batched && audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
 			// dec reset
 			funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
 			if (wfst_decoder){
@@ -259,9 +359,9 @@
 			}
 			vector<string> msg_batch;
 			if(offline_stream->GetModelType() == MODEL_SVS){
-				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, svs_lang, svs_itn, batch_in);
+				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, svs_lang, svs_itn, batch_in, audio.GetFbankCache());
 			}else{
-				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in);
+				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in, audio.GetFbankCache());
 			}
 			for(int idx=0; idx<batch_in; idx++){
 				string msg = msg_batch[idx];
@@ -332,6 +432,24 @@
 		return p_result;
 	}
 
+	_FUNASRAPI FUNASR_RESULT FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
+												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
+												   int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												   std::string svs_lang, bool svs_itn)
+	{
+		return OfflineInferBuffer(handle, sz_buf, n_len, mode, fn_callback, FunHotwordEmbedding::FromRows(hw_emb),
+								  sampling_rate, wav_format, itn, dec_handle, svs_lang, svs_itn);
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
+												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const FUNASR_HW_EMB &hw_emb, 
+												   int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												   std::string svs_lang, bool svs_itn)
+	{
+		return OfflineInferBuffer(handle, sz_buf, n_len, mode, fn_callback, HotwordsOf(hw_emb),
+								  sampling_rate, wav_format, itn, dec_handle, svs_lang, svs_itn);
+	}
+
 	_FUNASRAPI FUNASR_RESULT FunOfflineInfer(FUNASR_HANDLE handle, const char* sz_filename, FUNASR_MODE mode, QM_CALLBACK fn_callback, 
 											 const std::vector<std::vector<float>> &hw_emb, int sampling_rate, bool itn, FUNASR_DEC_HANDLE dec_handle)
 	{
@@ -380,13 +498,16 @@
 
 		std::string cur_stamp = "[";
 		std::string lang = (offline_stream->asr_handle)->GetLang();
-		while (audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
+		bool batched = offline_stream->GetRequestBatcher() &&
+					   RequestBatchForward(offline_stream, audio, FunHotwordEmbedding::FromRows(hw_emb), dec_handle,
+										   index_vector, msgs, msg_stimes);
+		while (!batched && audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
 			// dec reset
 			funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
 			if (wfst_decoder){
 				wfst_decoder->StartUtterance();
 			}
-			vector<string> msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in);
+			vector<string> msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in, audio.GetFbankCache());
 			for(int idx=0; idx<batch_in; idx++){
 				string msg = msg_batch[idx];
 				if(msg_idx < index_vector.size()){
@@ -455,6 +576,25 @@
 	}
 
 //#if !defined(__APPLE__)
+	_FUNASRAPI FUNASR_HW_EMB CompileSharedHotwordEmbedding(FUNASR_HANDLE handle, std::string &hotwords, ASR_TYPE mode)
+	{
+		FUNASR_HW_EMB emb;
+		if (mode == ASR_OFFLINE){
+			funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+			if (offline_stream)
+				emb = (offline_stream->asr_handle)->CompileSharedHotwordEmbedding(hotwords);
+		}
+		else if (mode == ASR_TWO_PASS){
+			funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
+			if (tpass_stream)
+				emb = (tpass_stream->asr_handle)->CompileSharedHotwordEmbedding(hotwords);
+		}
+		else{
+			LOG(ERROR) << "Not implement: Online model does not support Hotword yet!";
+		}
+		return emb ? emb : std::make_shared<const FunHotwordEmbedding>();
+	}
+
 	_FUNASRAPI const std::vector<std::vector<float>> CompileHotwordEmbedding(FUNASR_HANDLE handle, std::string &hotwords, ASR_TYPE mode)
 	{
 		if (mode == ASR_OFFLINE){
@@ -481,11 +621,11 @@
 //#endif
 
 	// APIs for 2pass-stream Infer
-	_FUNASRAPI FUNASR_RESULT FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
-												 int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
-												 int sampling_rate, std::string wav_format, ASR_TYPE mode, 
-												 const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
-												 std::string svs_lang, bool svs_itn)
+	static FUNASR_RESULT TpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
+										  int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
+										  int sampling_rate, std::string wav_format, ASR_TYPE mode, 
+										  const FunHotwordEmbedding &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+										  std::string svs_lang, bool svs_itn)
 	{
 		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
 		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
@@ -550,10 +690,8 @@
 			}else if(mode == ASR_TWO_PASS){
 				p_result->msg += msg;
 			}
-			if(frame != nullptr){
-				delete frame;
-				frame = nullptr;
-			}
+			audio->ReleaseFrame(frame);
+			frame = nullptr;
 		}
 
 		// timestamp
@@ -579,6 +717,8 @@
 			string msg = msgs.size()>0?msgs[0]:"";
 			std::vector<std::string> msg_vec = funasr::SplitStr(msg, " | ");  // split with timestamp
 			if(msg_vec.size()==0){
+				audio->ReleaseFrame(frame);
+				frame = nullptr;
 				continue;
 			}
 			msg = msg_vec[0];
@@ -623,10 +763,8 @@
 			if (!(p_result->stamp).empty()){
 				p_result->stamp_sents = funasr::TimestampSentence(p_result->tpass_msg, p_result->stamp);
 			}
-			if(frame != nullptr){
-				delete frame;
-				frame = nullptr;
-			}
+			audio->ReleaseFrame(frame);
+			frame = nullptr;
 		}
 
 		if(input_finished){
@@ -636,6 +774,26 @@
 		return p_result;
 	}
 
+	_FUNASRAPI FUNASR_RESULT FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
+												 int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
+												 int sampling_rate, std::string wav_format, ASR_TYPE mode, 
+												 const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												 std::string svs_lang, bool svs_itn)
+	{
+		return TpassInferBuffer(handle, online_handle, sz_buf, n_len, punc_cache, input_finished, sampling_rate, wav_format,
+								mode, FunHotwordEmbedding::FromRows(hw_emb), itn, dec_handle, svs_lang, svs_itn);
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
+												 int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
+												 int sampling_rate, std::string wav_format, ASR_TYPE mode, 
+												 const FUNASR_HW_EMB &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												 std::string svs_lang, bool svs_itn)
+	{
+		return TpassInferBuffer(handle, online_handle, sz_buf, n_len, punc_cache, input_finished, sampling_rate, wav_format,
+								mode, HotwordsOf(hw_emb), itn, dec_handle, svs_lang, svs_itn);
+	}
+
 	_FUNASRAPI const int FunASRGetRetNumber(FUNASR_RESULT result)
 	{
 		if (!result)
@@ -833,7 +991,8 @@
 			if(paraformer !=nullptr){
 				if (paraformer->lm_){
 					mm = new funasr::WfstDecoder(paraformer->lm_.get(),
-						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale);
+						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale,
+						paraformer->GetBiasLmCache());
 				}
 				return mm;
 			}
@@ -854,7 +1013,8 @@
 			if(paraformer !=nullptr){
 				if (paraformer->lm_){
 					mm = new funasr::WfstDecoder(paraformer->lm_.get(),
-						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale);
+						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale,
+						paraformer->GetBiasLmCache());
 				}
 				return mm;
 			}
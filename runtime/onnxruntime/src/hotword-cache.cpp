@@ -0,0 +1,43 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "hotword-cache.h"
+#include <algorithm>
+
+namespace funasr {
+
+std::string NormalizeHotwords(const std::string &hotwords)
+{
+    std::vector<std::string> words;
+    for (auto &word : split(hotwords, ' ')) {
+        if (!word.empty()) {
+            words.push_back(word);
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    std::string key;
+    for (auto &word : words) {
+        if (!key.empty()) {
+            key += ' ';
+        }
+        key += word;
+    }
+    return key;
+}
+
+std::string NormalizeHotwords(const std::unordered_map<std::string, int> &hws_map, int inc_bias)
+{
+    std::vector<std::pair<std::string, int>> hotwords(hws_map.begin(), hws_map.end());
+    std::sort(hotwords.begin(), hotwords.end());
+    std::string key = std::to_string(inc_bias);
+    for (auto &hotword : hotwords) {
+        key += '\n' + hotword.first + '\t' + std::to_string(hotword.second);
+    }
+    return key;
+}
+
+} // namespace funasr
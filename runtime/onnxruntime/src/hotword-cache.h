@@ -0,0 +1,91 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef HOTWORD_CACHE_H
+#define HOTWORD_CACHE_H
+
+#include <stdint.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <glog/logging.h>
+
+namespace funasr {
+
+// key of a nn hotword string: its words sorted and deduplicated
+std::string NormalizeHotwords(const std::string &hotwords);
+// key of the fst hotwords and their weights for the increment bias
+std::string NormalizeHotwords(const std::unordered_map<std::string, int> &hws_map, int inc_bias);
+
+// Resources compiled from a hotword set, kept for the next connection with
+// the same set. Most connections send the hotwords of the server plus a few
+// of their own, so the hotword embedding run and the bias lm graph would
+// otherwise be rebuilt for every connection. The values are shared and must
+// not be changed by their users. Holds at most capacity entries and drops the
+// least recently used one.
+template <class T>
+class HotwordCache {
+  public:
+    HotwordCache(const std::string &name, size_t capacity) : name_(name), capacity_(capacity) {}
+
+    // value of key, built by build on a miss; a null value is not cached
+    std::shared_ptr<T> Get(const std::string &key, const std::function<std::shared_ptr<T>()> &build)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+                hits_++;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->second;
+            }
+            misses_++;
+        }
+        // built outside the lock, a concurrent miss of the same key builds it too
+        std::shared_ptr<T> value = build();
+        if (!value) {
+            return value;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            return it->second->second;
+        }
+        entries_.emplace_front(key, value);
+        index_[key] = entries_.begin();
+        if (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        LOG(INFO) << "Compile " << name_ << " for a new hotword set, cache hits " << hits_
+                  << ", misses " << misses_ << ", entries " << entries_.size();
+        return value;
+    }
+
+    void Stats(uint64_t &hits, uint64_t &misses)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hits = hits_;
+        misses = misses_;
+    }
+
+  private:
+    typedef std::list<std::pair<std::string, std::shared_ptr<T>>> EntryList;
+
+    std::string name_;
+    size_t capacity_;
+    std::mutex mutex_;
+    // most recently used first
+    EntryList entries_;
+    std::unordered_map<std::string, typename EntryList::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+} // namespace funasr
+#endif
@@ -29,9 +29,13 @@ void  ITNProcessor::InitITN(const std::string& tagger_path,
                      const std::string& verbalizer_path, 
                      int thread_num) {
   try{
-    tagger_.reset(StdVectorFst::Read(tagger_path));
+    tagger_ = ModelRegistry::Get<StdFst>(tagger_path, [&]() {
+      return ReadFst(tagger_path);
+    });
     LOG(INFO) << "Successfully load model from " << tagger_path;
-    verbalizer_.reset(StdVectorFst::Read(verbalizer_path));
+    verbalizer_ = ModelRegistry::Get<StdFst>(verbalizer_path, [&]() {
+      return ReadFst(verbalizer_path);
+    });
     LOG(INFO) << "Successfully load model from " << verbalizer_path;
   }catch(exception const &e){
     LOG(ERROR) << "Error loading itn models";
@@ -60,7 +64,7 @@ std::string ITNProcessor::shortest_path(const StdVectorFst& lattice) {
 }
 
 std::string ITNProcessor::compose(const std::string& input,
-                               const StdVectorFst* fst) {
+                               const StdFst* fst) {
   StdVectorFst input_fst;
   compiler_->operator()(input, &input_fst);
 
@@ -25,6 +25,7 @@
 #include "itn-token-parser.h"
 
 using fst::StdArc;
+using fst::StdFst;
 using fst::StdVectorFst;
 using fst::StringCompiler;
 using fst::StringPrinter;
@@ -42,11 +43,11 @@ class ITNProcessor : public ITNModel {
 
  private:
   std::string shortest_path(const StdVectorFst& lattice);
-  std::string compose(const std::string& input, const StdVectorFst* fst);
+  std::string compose(const std::string& input, const StdFst* fst);
 
   ParseType parse_type_;
-  std::shared_ptr<StdVectorFst> tagger_ = nullptr;
-  std::shared_ptr<StdVectorFst> verbalizer_ = nullptr;
+  std::shared_ptr<StdFst> tagger_ = nullptr;
+  std::shared_ptr<StdFst> verbalizer_ = nullptr;
   std::shared_ptr<StringCompiler<StdArc>> compiler_ = nullptr;
   std::shared_ptr<StringPrinter<StdArc>> printer_ = nullptr;
 };
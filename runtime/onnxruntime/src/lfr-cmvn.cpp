@@ -0,0 +1,120 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "lfr-cmvn.h"
+#include <algorithm>
+#include <cstring>
+#include "cpu-isa.h"
+
+namespace funasr {
+
+// out[k] = (x[k] + means[k]) * vars[k], add and mul are kept separate (no fma)
+// so every variant rounds exactly like the scalar one
+typedef void (*AddMulFunc)(const float *x, const float *means, const float *vars, float *out, int n);
+
+static void AddMulScalar(const float *x, const float *means, const float *vars, float *out, int n)
+{
+    for (int k = 0; k < n; k++) {
+        out[k] = (x[k] + means[k]) * vars[k];
+    }
+}
+
+#if defined(FUNASR_ISA_X86)
+__attribute__((target("avx2")))
+static void AddMulAvx2(const float *x, const float *means, const float *vars, float *out, int n)
+{
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 v = _mm256_add_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(means + k));
+        _mm256_storeu_ps(out + k, _mm256_mul_ps(v, _mm256_loadu_ps(vars + k)));
+    }
+    for (; k < n; k++) {
+        out[k] = (x[k] + means[k]) * vars[k];
+    }
+}
+
+__attribute__((target("avx512f")))
+static void AddMulAvx512(const float *x, const float *means, const float *vars, float *out, int n)
+{
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512 v = _mm512_add_ps(_mm512_loadu_ps(x + k), _mm512_loadu_ps(means + k));
+        _mm512_storeu_ps(out + k, _mm512_mul_ps(v, _mm512_loadu_ps(vars + k)));
+    }
+    if (k < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - k)) - 1);
+        __m512 v = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, x + k), _mm512_maskz_loadu_ps(mask, means + k));
+        _mm512_mask_storeu_ps(out + k, mask, _mm512_mul_ps(v, _mm512_maskz_loadu_ps(mask, vars + k)));
+    }
+}
+#endif
+
+#if defined(FUNASR_ISA_NEON)
+static void AddMulNeon(const float *x, const float *means, const float *vars, float *out, int n)
+{
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t v = vaddq_f32(vld1q_f32(x + k), vld1q_f32(means + k));
+        vst1q_f32(out + k, vmulq_f32(v, vld1q_f32(vars + k)));
+    }
+    for (; k < n; k++) {
+        out[k] = (x[k] + means[k]) * vars[k];
+    }
+}
+#endif
+
+static IsaDispatch<AddMulFunc> &AddMul()
+{
+    static IsaDispatch<AddMulFunc> dispatch({
+#if defined(FUNASR_ISA_X86)
+        {CpuIsa::kAvx512f, AddMulAvx512},
+        {CpuIsa::kAvx2, AddMulAvx2},
+#elif defined(FUNASR_ISA_NEON)
+        {CpuIsa::kNeon, AddMulNeon},
+#endif
+        {CpuIsa::kScalar, AddMulScalar},
+    });
+    return dispatch;
+}
+
+const char *LfrCmvnIsa()
+{
+    return AddMul().Name();
+}
+
+bool SetLfrCmvnIsa(const std::string &isa)
+{
+    return AddMul().Force(isa);
+}
+
+void ApplyLfrCmvn(const float *in, int num_frames, int in_dim,
+                  int lfr_m, int lfr_n, int left_pad,
+                  const std::vector<float> &means, const std::vector<float> &vars,
+                  float *out, int num_out)
+{
+    if (num_frames <= 0) {
+        return;
+    }
+    AddMulFunc add_mul = AddMul().Get();
+    int out_dim = lfr_m * in_dim;
+    int cmvn_dim = std::min(std::min((int)means.size(), (int)vars.size()), out_dim);
+    for (int i = 0; i < num_out; i++) {
+        float *p = out + (size_t)i * out_dim;
+        for (int j = 0; j < lfr_m; j++) {
+            int idx = std::min(std::max(i * lfr_n + j - left_pad, 0), num_frames - 1);
+            const float *src = in + (size_t)idx * in_dim;
+            int offset = j * in_dim;
+            int n = std::min(std::max(cmvn_dim - offset, 0), in_dim);
+            if (n > 0) {
+                add_mul(src, means.data() + offset, vars.data() + offset, p + offset, n);
+            }
+            if (n < in_dim) {
+                memcpy(p + offset + n, src + n, (in_dim - n) * sizeof(float));
+            }
+        }
+    }
+}
+
+} // namespace funasr
@@ -0,0 +1,33 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef LFR_CMVN_H
+#define LFR_CMVN_H
+
+#include <string>
+#include <vector>
+
+namespace funasr {
+
+// Low frame rate splicing and cmvn in a single pass. Writes num_out rows of
+// lfr_m*in_dim floats to out, slot j of row i is frame
+// clamp(i*lfr_n + j - left_pad, 0, num_frames-1) of in, so the edges repeat the
+// first/last frame. cmvn is (x + means) * vars over the first means.size() columns.
+// The inner loop is picked at runtime (avx512f/avx2/neon/scalar), all variants
+// give bit-identical results.
+void ApplyLfrCmvn(const float *in, int num_frames, int in_dim,
+                  int lfr_m, int lfr_n, int left_pad,
+                  const std::vector<float> &means, const std::vector<float> &vars,
+                  float *out, int num_out);
+
+// name of the selected inner loop, for logging
+const char *LfrCmvnIsa();
+// Forces the inner loop to isa ("avx512f", "avx2", "neon" or "scalar") so the
+// variants can be compared, "" goes back to the runtime pick. false if this
+// cpu can not run isa.
+bool SetLfrCmvnIsa(const std::string &isa);
+
+} // namespace funasr
+#endif
@@ -0,0 +1,39 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "load-timer.h"
+#include <iomanip>
+
+namespace funasr {
+
+LoadTimer::LoadTimer(const std::string &handle)
+    : handle_(handle), start_(std::chrono::steady_clock::now()), last_(start_)
+{
+}
+
+void LoadTimer::Mark(const std::string &component)
+{
+    auto now = std::chrono::steady_clock::now();
+    steps_.emplace_back(component, std::chrono::duration<double>(now - last_).count());
+    last_ = now;
+}
+
+void LoadTimer::Report() const
+{
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+    report << handle_ << " loaded in " << total << " s";
+    for (size_t i = 0; i < steps_.size(); i++) {
+        report << (i == 0 ? " (" : ", ") << steps_[i].first << " " << steps_[i].second << " s";
+    }
+    if (!steps_.empty()) {
+        report << ")";
+    }
+    LOG(INFO) << report.str();
+}
+
+} // namespace funasr
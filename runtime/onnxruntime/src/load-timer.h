@@ -0,0 +1,33 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef LOAD_TIMER_H
+#define LOAD_TIMER_H
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace funasr {
+
+// Wall time a handle spends loading each of its models, logged as one line
+// when the handle is ready so that startup regressions show per component.
+class LoadTimer {
+  public:
+    explicit LoadTimer(const std::string &handle);
+    // the time since the previous mark was spent on component
+    void Mark(const std::string &component);
+    void Report() const;
+
+  private:
+    std::string handle_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+    std::vector<std::pair<std::string, double>> steps_;
+};
+
+} // namespace funasr
+#endif
@@ -0,0 +1,391 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "model-bundle.h"
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+namespace funasr {
+
+static const char BUNDLE_MAGIC[8] = {'F', 'U', 'N', 'A', 'S', 'R', 'M', 'B'};
+
+// std::istream over memory, seekable as OpenFst expects from its streams
+class MemoryStreamBuf : public std::streambuf {
+  public:
+    MemoryStreamBuf(const char *data, size_t size)
+    {
+        char *begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        char *pos = dir == std::ios_base::beg ? eback() : (dir == std::ios_base::cur ? gptr() : egptr());
+        pos += off;
+        if (pos < eback() || pos > egptr()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), pos, egptr());
+        return pos_type(pos - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+// keeps the bundle mapped while its entry is read
+class BundleStream : public std::istream {
+  public:
+    BundleStream(std::shared_ptr<ModelBundle> bundle, const char *data, size_t size)
+        : std::istream(nullptr), bundle_(bundle), buf_(data, size)
+    {
+        rdbuf(&buf_);
+    }
+
+  private:
+    std::shared_ptr<ModelBundle> bundle_;
+    MemoryStreamBuf buf_;
+};
+
+ModelBundle::~ModelBundle()
+{
+#ifndef _WIN32
+    if (buffer_.empty() && data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+ModelBundle *ModelBundle::Open(const std::string &file)
+{
+    std::unique_ptr<ModelBundle> bundle(new ModelBundle());
+    bundle->file_ = file;
+#ifndef _WIN32
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        LOG(ERROR) << "Failed to map model bundle " << file;
+        return nullptr;
+    }
+    bundle->data_ = (const char*)addr;
+    bundle->size_ = st.st_size;
+#else
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        return nullptr;
+    }
+    bundle->buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (bundle->buffer_.empty()) {
+        return nullptr;
+    }
+    bundle->data_ = bundle->buffer_.data();
+    bundle->size_ = bundle->buffer_.size();
+#endif
+
+    // not a bundle, e.g. a model file opened as a dir
+    const size_t header_size = 8 + 4 + 4 + 8;
+    if (bundle->size_ < header_size || memcmp(bundle->data_, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0) {
+        return nullptr;
+    }
+    uint32_t version, num_entries;
+    memcpy(&version, bundle->data_ + 8, sizeof(version));
+    memcpy(&num_entries, bundle->data_ + 12, sizeof(num_entries));
+    const size_t entry_size = NAME_LEN + 4 + 4 + 8 + 8;
+    if (version != VERSION) {
+        LOG(ERROR) << "Model bundle " << file << " has version " << version << ", expected " << VERSION;
+        return nullptr;
+    }
+    if (header_size + (size_t)num_entries * entry_size > bundle->size_) {
+        LOG(ERROR) << "Model bundle " << file << " is truncated";
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < num_entries; i++) {
+        const char *record = bundle->data_ + header_size + i * entry_size;
+        std::string name(record, strnlen(record, NAME_LEN));
+        uint32_t kind;
+        uint64_t offset, size;
+        memcpy(&kind, record + NAME_LEN, sizeof(kind));
+        memcpy(&offset, record + NAME_LEN + 8, sizeof(offset));
+        memcpy(&size, record + NAME_LEN + 16, sizeof(size));
+        if (offset > bundle->size_ || size > bundle->size_ - offset || kind > SEG_DICT) {
+            LOG(ERROR) << "Model bundle " << file << " has a broken entry " << name;
+            return nullptr;
+        }
+        Entry entry = {bundle->data_ + offset, (size_t)size, (Kind)kind};
+        bundle->entries_.emplace_back(name, entry);
+    }
+    LOG(INFO) << "Open model bundle " << file << " with " << num_entries << " files";
+    return bundle.release();
+}
+
+bool ModelBundle::Lookup(const std::string &name, Entry &entry) const
+{
+    for (auto &item : entries_) {
+        if (item.first == name) {
+            entry = item.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<ModelBundle> ModelBundle::Find(const std::string &path, Entry &entry)
+{
+    size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        return nullptr;
+    }
+    std::string file = path.substr(0, slash);
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) {
+        return nullptr;
+    }
+    std::shared_ptr<ModelBundle> bundle = ModelRegistry::Get<ModelBundle>(file, [&]() {
+        return Open(file);
+    });
+    if (!bundle || !bundle->Lookup(path.substr(slash + 1), entry)) {
+        return nullptr;
+    }
+    return bundle;
+}
+
+bool ModelBundle::Exists(const std::string &path)
+{
+    if (access(path.c_str(), F_OK) == 0) {
+        return true;
+    }
+    Entry entry;
+    return Find(path, entry) != nullptr;
+}
+
+bool ModelBundle::ReadFile(const std::string &path, std::string &content)
+{
+    Entry entry;
+    std::shared_ptr<ModelBundle> bundle = Find(path, entry);
+    if (bundle) {
+        if (entry.kind != RAW) {
+            LOG(ERROR) << path << " is stored prebuilt in its bundle";
+            return false;
+        }
+        content.assign(entry.data, entry.size);
+        return true;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+YAML::Node ModelBundle::LoadYaml(const std::string &path)
+{
+    Entry entry;
+    std::shared_ptr<ModelBundle> bundle = Find(path, entry);
+    if (!bundle) {
+        return YAML::LoadFile(path);
+    }
+    BundleStream stream(bundle, entry.data, entry.size);
+    return YAML::Load(stream);
+}
+
+std::unique_ptr<std::istream> ModelBundle::OpenStream(const std::string &path)
+{
+    Entry entry;
+    std::shared_ptr<ModelBundle> bundle = Find(path, entry);
+    if (bundle && entry.kind == RAW) {
+        return std::unique_ptr<std::istream>(new BundleStream(bundle, entry.data, entry.size));
+    }
+    std::unique_ptr<std::ifstream> in(new std::ifstream(path, std::ios::binary));
+    if (bundle || !in->is_open()) {
+        return nullptr;
+    }
+    return std::move(in);
+}
+
+std::unique_ptr<std::istream> ModelBundle::OpenFileStream(const std::string &path, std::string &source)
+{
+    Entry entry;
+    std::shared_ptr<ModelBundle> bundle = Find(path, entry);
+    if (bundle && entry.kind != RAW) {
+        return nullptr;
+    }
+    source = bundle ? bundle->file_ : path;
+    std::unique_ptr<std::ifstream> in(new std::ifstream(source, std::ios::binary));
+    if (!in->is_open()) {
+        return nullptr;
+    }
+    if (bundle) {
+        in->seekg(entry.data - bundle->data_);
+    }
+    return std::move(in);
+}
+
+bool ModelBundle::ReadStrings(const char *data, size_t size, std::vector<std::string> &strings)
+{
+    uint32_t count;
+    if (size < sizeof(count)) {
+        return false;
+    }
+    memcpy(&count, data, sizeof(count));
+    size_t table_size = sizeof(uint32_t) * ((size_t)count + 2);
+    if (table_size > size) {
+        return false;
+    }
+    std::vector<uint32_t> offsets(count + 1);
+    memcpy(offsets.data(), data + sizeof(count), offsets.size() * sizeof(uint32_t));
+    const char *bytes = data + table_size;
+    size_t bytes_size = size - table_size;
+    strings.clear();
+    strings.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > bytes_size) {
+            return false;
+        }
+        strings.emplace_back(bytes + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return true;
+}
+
+static void AppendStrings(const std::vector<std::string> &strings, std::string &out)
+{
+    uint32_t count = strings.size();
+    std::vector<uint32_t> offsets(1, 0);
+    for (auto &str : strings) {
+        offsets.push_back(offsets.back() + str.size());
+    }
+    out.append((const char*)&count, sizeof(count));
+    out.append((const char*)offsets.data(), offsets.size() * sizeof(uint32_t));
+    for (auto &str : strings) {
+        out.append(str);
+    }
+}
+
+bool ModelBundle::Pack(const std::string &model_dir, const std::vector<std::string> &names,
+                       const std::string &bundle_file)
+{
+    std::vector<std::pair<std::string, Kind>> entries;
+    std::vector<std::string> payloads;
+    for (auto &name : names) {
+        if (name.size() >= NAME_LEN) {
+            LOG(ERROR) << "File name " << name << " is too long for a model bundle";
+            return false;
+        }
+        std::string path = PathAppend(model_dir, name);
+        std::string payload;
+        Kind kind = RAW;
+        if (name == AM_CMVN_NAME) {
+            std::vector<float> means, vars;
+            if (!ModelCache::LoadCmvn(path, means, vars)) {
+                return false;
+            }
+            uint32_t sizes[2] = {(uint32_t)means.size(), (uint32_t)vars.size()};
+            payload.append((const char*)sizes, sizeof(sizes));
+            payload.append((const char*)means.data(), means.size() * sizeof(float));
+            payload.append((const char*)vars.data(), vars.size() * sizeof(float));
+            kind = CMVN;
+        } else if (name == TOKEN_PATH) {
+            std::vector<std::string> tokens;
+            if (!ModelCache::LoadTokens(path, tokens)) {
+                LOG(ERROR) << "Failed to read " << path;
+                return false;
+            }
+            AppendStrings(tokens, payload);
+            kind = TOKENS;
+        } else if (name == MODEL_SEG_DICT) {
+            std::ifstream in(path);
+            if (!in.is_open()) {
+                LOG(ERROR) << "Failed to read " << path;
+                return false;
+            }
+            std::vector<uint32_t> num_tokens;
+            std::vector<std::string> strings;
+            std::string textline;
+            while (getline(in, textline)) {
+                std::vector<string> line_item = split(textline, '\t');
+                if (line_item.size() > 1) {
+                    std::vector<string> segs_vec = split(line_item[1], ' ');
+                    num_tokens.push_back(segs_vec.size());
+                    strings.push_back(line_item[0]);
+                    strings.insert(strings.end(), segs_vec.begin(), segs_vec.end());
+                }
+            }
+            uint32_t num_words = num_tokens.size();
+            payload.append((const char*)&num_words, sizeof(num_words));
+            payload.append((const char*)num_tokens.data(), num_tokens.size() * sizeof(uint32_t));
+            AppendStrings(strings, payload);
+            kind = SEG_DICT;
+        } else if (!ReadFile(path, payload)) {
+            LOG(ERROR) << "Failed to read " << path;
+            return false;
+        }
+        entries.emplace_back(name, kind);
+        payloads.emplace_back(std::move(payload));
+    }
+
+    const size_t header_size = 8 + 4 + 4 + 8;
+    const size_t entry_size = NAME_LEN + 4 + 4 + 8 + 8;
+    std::string header(header_size + entries.size() * entry_size, '\0');
+    memcpy(&header[0], BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    uint32_t version = VERSION, num_entries = entries.size();
+    memcpy(&header[8], &version, sizeof(version));
+    memcpy(&header[12], &num_entries, sizeof(num_entries));
+    uint64_t offset = header.size();
+    for (size_t i = 0; i < entries.size(); i++) {
+        offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        char *record = &header[header_size + i * entry_size];
+        uint32_t kind = entries[i].second;
+        uint64_t size = payloads[i].size();
+        memcpy(record, entries[i].first.data(), entries[i].first.size());
+        memcpy(record + NAME_LEN, &kind, sizeof(kind));
+        memcpy(record + NAME_LEN + 8, &offset, sizeof(offset));
+        memcpy(record + NAME_LEN + 16, &size, sizeof(size));
+        offset += size;
+    }
+
+    std::string temp_file = bundle_file + ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary);
+        out.write(header.data(), header.size());
+        uint64_t pos = header.size();
+        for (auto &payload : payloads) {
+            uint64_t aligned = (pos + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            out.write(std::string(aligned - pos, '\0').data(), aligned - pos);
+            out.write(payload.data(), payload.size());
+            pos = aligned + payload.size();
+        }
+        if (!out.good()) {
+            LOG(ERROR) << "Failed to write " << temp_file;
+            out.close();
+            remove(temp_file.c_str());
+            return false;
+        }
+    }
+    if (rename(temp_file.c_str(), bundle_file.c_str()) != 0) {
+        LOG(ERROR) << "Failed to write " << bundle_file;
+        remove(temp_file.c_str());
+        return false;
+    }
+    LOG(INFO) << "Packed " << entries.size() << " files of " << model_dir << " into " << bundle_file;
+    return true;
+}
+
+} // namespace funasr
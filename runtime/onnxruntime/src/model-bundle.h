@@ -0,0 +1,90 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef MODEL_BUNDLE_H
+#define MODEL_BUNDLE_H
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+namespace funasr {
+
+// All files of a model dir in one file that is mapped into memory instead of
+// read and parsed file by file. Only the file bytes are shared through the
+// page cache: onnxruntime copies the initializers of an onnx entry into every
+// session it creates from them, so each process still holds its own weights;
+// the prebuilt entries and aligned ConstFst entries are read in place.
+// A path "<bundle>/<name>" names the entry <name> of the bundle file
+// <bundle>, which makes a bundle usable wherever a model dir is expected: the
+// loaders go through Exists/ReadFile/LoadYaml/OpenStream and find their files
+// in either.
+//
+// Layout, little endian:
+//   header  char magic[8] "FUNASRMB", uint32 version, uint32 num_entries, uint64 reserved
+//   entries num_entries x {char name[48], uint32 kind, uint32 reserved, uint64 offset, uint64 size}
+//   data    every entry 64 byte aligned
+// RAW entries hold the bytes of the file (onnx, yaml, fst, lexicon). The text
+// resources are stored prebuilt: CMVN as uint32 num_means, uint32 num_vars and
+// the two float arrays, TOKENS as a string table, SEG_DICT as uint32 num_words,
+// uint32 num_tokens[num_words] and a string table of every word followed by
+// its tokens. A string table is uint32 count, uint32 offsets[count + 1] and
+// the bytes of the strings.
+class ModelBundle {
+  public:
+    enum Kind { RAW = 0, CMVN = 1, TOKENS = 2, SEG_DICT = 3 };
+    struct Entry {
+        const char *data;
+        size_t size;
+        Kind kind;
+    };
+
+    ~ModelBundle();
+
+    // Bundle holding path and the entry of path in it, nullptr if path is not
+    // inside a bundle. The entry data lives as long as the returned bundle.
+    static std::shared_ptr<ModelBundle> Find(const std::string &path, Entry &entry);
+    // path is a file or a bundle entry
+    static bool Exists(const std::string &path);
+    // bytes of a file or of a RAW bundle entry
+    static bool ReadFile(const std::string &path, std::string &content);
+    // YAML::LoadFile for files and bundle entries, throws the same way
+    static YAML::Node LoadYaml(const std::string &path);
+    // Stream over a file or a RAW bundle entry, the entry is read in place.
+    // nullptr if path can not be opened.
+    static std::unique_ptr<std::istream> OpenStream(const std::string &path);
+    // Stream over the file holding path, a file or the bundle of a RAW entry,
+    // positioned at the data of path. For readers that map the file source
+    // themselves. nullptr if path can not be opened.
+    static std::unique_ptr<std::istream> OpenFileStream(const std::string &path, std::string &source);
+    // strings of the string table at data[0, size), false if it is broken
+    static bool ReadStrings(const char *data, size_t size, std::vector<std::string> &strings);
+
+    // Packs the files names of model_dir into bundle_file. am.mvn, tokens.json
+    // and seg_dict are converted to their prebuilt kinds.
+    static bool Pack(const std::string &model_dir, const std::vector<std::string> &names,
+                     const std::string &bundle_file);
+
+  private:
+    static const uint32_t VERSION = 1;
+    static const size_t NAME_LEN = 48;
+    static const size_t ALIGNMENT = 64;
+
+    ModelBundle() = default;
+    static ModelBundle *Open(const std::string &file);
+    bool Lookup(const std::string &name, Entry &entry) const;
+
+    std::string file_;
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    // the bundle read into memory where it can not be mapped
+    std::vector<char> buffer_;
+    std::vector<std::pair<std::string, Entry>> entries_;
+};
+
+} // namespace funasr
+#endif
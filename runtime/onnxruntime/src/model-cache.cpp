@@ -0,0 +1,355 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "model-cache.h"
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace funasr {
+
+std::mutex ModelCache::mutex_;
+std::string ModelCache::dir_;
+
+// bumped when the layout of a sidecar changes
+static const uint32_t SIDECAR_VERSION = 1;
+static const uint32_t CMVN_MAGIC = 0x4e564d43;   // "CMVN"
+static const uint32_t TOKENS_MAGIC = 0x4e4b4f54; // "TOKN"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t HashBytes(uint64_t hash, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// fnv-1a over 8 byte words, models are hundreds of MB
+static uint64_t HashWords(uint64_t hash, const char *data, size_t len)
+{
+    size_t words = len / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    return HashBytes(hash, data + words * sizeof(uint64_t), len - words * sizeof(uint64_t));
+}
+
+// hash of a file or of a bundle entry
+static bool HashFile(const std::string &file, uint64_t &hash)
+{
+    hash = FNV_OFFSET;
+    ModelBundle::Entry entry;
+    if (ModelBundle::Find(file, entry)) {
+        hash = HashWords(hash, entry.data, entry.size);
+        return true;
+    }
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        hash = HashWords(hash, buffer.data(), in.gcount());
+    }
+    return true;
+}
+
+static std::string CpuFeatures()
+{
+    std::string features;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    features = "x86";
+    if (__builtin_cpu_supports("avx")) features += "+avx";
+    if (__builtin_cpu_supports("fma")) features += "+fma";
+    if (__builtin_cpu_supports("avx2")) features += "+avx2";
+    if (__builtin_cpu_supports("avx512f")) features += "+avx512f";
+    if (__builtin_cpu_supports("avx512bw")) features += "+avx512bw";
+    if (__builtin_cpu_supports("avx512vl")) features += "+avx512vl";
+#elif defined(__aarch64__)
+    features = "arm64";
+#elif defined(_M_X64) || defined(_M_IX86)
+    // msvc: no feature query, key on the build only
+    features = "x86-msvc";
+#else
+    features = "generic";
+#endif
+    return features;
+}
+
+bool ModelCache::SetDir(const std::string &dir)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir_.clear();
+    if (dir.empty()) {
+        return true;
+    }
+#ifdef _WIN32
+    int ret = _mkdir(dir.c_str());
+#else
+    int ret = mkdir(dir.c_str(), 0755);
+#endif
+    if (ret != 0 && errno != EEXIST) {
+        LOG(ERROR) << "Failed to create model cache dir " << dir;
+        return false;
+    }
+    dir_ = dir;
+    LOG(INFO) << "Cache optimized models in " << dir;
+    return true;
+}
+
+std::string ModelCache::Dir()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dir_;
+}
+
+std::string ModelCache::GraphTag()
+{
+    static const std::string tag = std::string("ort-") + OrtGetApiBase()->GetVersionString() + "|" + CpuFeatures();
+    return tag;
+}
+
+std::string ModelCache::CacheFile(const std::string &src_file, const std::string &tag, const std::string &ext)
+{
+    std::string dir = Dir();
+    uint64_t hash;
+    if (dir.empty() || !HashFile(src_file, hash)) {
+        return "";
+    }
+    hash = HashBytes(hash, tag.data(), tag.size());
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    std::string name = src_file.substr(src_file.find_last_of("/\\") + 1);
+    return PathAppend(dir, name + "." + hex + ext);
+}
+
+std::string ModelCache::TempFile(const std::string &file)
+{
+    // unique per writer, renamed to file once complete so that readers never
+    // see a partial cache file
+    size_t id = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                (size_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    return file + ".tmp" + std::to_string(id);
+}
+
+Ort::Session *ModelCache::LoadSession(const std::string &model_path, const Ort::SessionOptions &options,
+                                      OrtPrepackedWeightsContainer *prepacked_weights)
+{
+    // a model in a bundle is created from the mapped bytes, onnxruntime copies
+    // its initializers into the session
+    ModelBundle::Entry entry;
+    std::shared_ptr<ModelBundle> bundle = ModelBundle::Find(model_path, entry);
+    auto create = [&](const Ort::SessionOptions &session_options) {
+        if (bundle) {
+            return new Ort::Session(RuntimeContext::Env(), entry.data, entry.size, session_options, prepacked_weights);
+        }
+        return new Ort::Session(RuntimeContext::Env(), ORTSTRING(model_path).c_str(), session_options, prepacked_weights);
+    };
+
+    std::string graph_file = CacheFile(model_path, GraphTag(), ".onnx");
+    if (graph_file.empty()) {
+        return create(options);
+    }
+    if (access(graph_file.c_str(), F_OK) == 0) {
+        Ort::SessionOptions cached_options = options.Clone();
+        cached_options.SetGraphOptimizationLevel(ORT_DISABLE_ALL);
+        try {
+            Ort::Session *session = new Ort::Session(RuntimeContext::Env(), ORTSTRING(graph_file).c_str(), cached_options, prepacked_weights);
+            LOG(INFO) << "Load optimized graph of " << model_path << " from " << graph_file;
+            return session;
+        } catch (std::exception const &e) {
+            LOG(WARNING) << "Drop broken optimized graph " << graph_file << ": " << e.what();
+            remove(graph_file.c_str());
+        }
+    }
+
+    std::string temp_file = TempFile(graph_file);
+    Ort::SessionOptions save_options = options.Clone();
+    save_options.SetOptimizedModelFilePath(ORTSTRING(temp_file).c_str());
+    Ort::Session *session = create(save_options);
+    if (rename(temp_file.c_str(), graph_file.c_str()) != 0) {
+        LOG(WARNING) << "Failed to save optimized graph of " << model_path << " to " << graph_file;
+        remove(temp_file.c_str());
+    }
+    return session;
+}
+
+bool ModelCache::ReadSidecar(const std::string &file, uint32_t magic, std::vector<std::vector<char>> &records)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    uint32_t header[3];
+    if (!in.read((char*)header, sizeof(header)) || header[0] != magic || header[1] != SIDECAR_VERSION) {
+        return false;
+    }
+    records.resize(header[2]);
+    for (auto &record : records) {
+        uint64_t len;
+        if (!in.read((char*)&len, sizeof(len))) {
+            return false;
+        }
+        record.resize(len);
+        if (len > 0 && !in.read(record.data(), len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ModelCache::WriteSidecar(const std::string &file, uint32_t magic, const std::vector<std::vector<char>> &records)
+{
+    std::string temp_file = TempFile(file);
+    {
+        std::ofstream out(temp_file, std::ios::binary);
+        uint32_t header[3] = {magic, SIDECAR_VERSION, (uint32_t)records.size()};
+        out.write((const char*)header, sizeof(header));
+        for (auto &record : records) {
+            uint64_t len = record.size();
+            out.write((const char*)&len, sizeof(len));
+            out.write(record.data(), len);
+        }
+        if (!out.good()) {
+            LOG(WARNING) << "Failed to write " << temp_file;
+            out.close();
+            remove(temp_file.c_str());
+            return;
+        }
+    }
+    if (rename(temp_file.c_str(), file.c_str()) != 0) {
+        remove(temp_file.c_str());
+    }
+}
+
+bool ModelCache::LoadCmvn(const std::string &cmvn_file, std::vector<float> &means, std::vector<float> &vars)
+{
+    ModelBundle::Entry entry;
+    std::shared_ptr<ModelBundle> bundle = ModelBundle::Find(cmvn_file, entry);
+    if (bundle && entry.kind == ModelBundle::CMVN) {
+        uint32_t sizes[2];
+        if (entry.size < sizeof(sizes)) {
+            LOG(ERROR) << "Broken cmvn " << cmvn_file;
+            return false;
+        }
+        memcpy(sizes, entry.data, sizeof(sizes));
+        if (entry.size != sizeof(sizes) + ((size_t)sizes[0] + sizes[1]) * sizeof(float)) {
+            LOG(ERROR) << "Broken cmvn " << cmvn_file;
+            return false;
+        }
+        means.resize(sizes[0]);
+        vars.resize(sizes[1]);
+        memcpy(means.data(), entry.data + sizeof(sizes), means.size() * sizeof(float));
+        memcpy(vars.data(), entry.data + sizeof(sizes) + means.size() * sizeof(float), vars.size() * sizeof(float));
+        return true;
+    }
+
+    std::string sidecar = CacheFile(cmvn_file, "cmvn", ".bin");
+    std::vector<std::vector<char>> records;
+    if (!sidecar.empty() && ReadSidecar(sidecar, CMVN_MAGIC, records) && records.size() == 2) {
+        means.resize(records[0].size() / sizeof(float));
+        vars.resize(records[1].size() / sizeof(float));
+        memcpy(means.data(), records[0].data(), means.size() * sizeof(float));
+        memcpy(vars.data(), records[1].data(), vars.size() * sizeof(float));
+        return true;
+    }
+
+    std::unique_ptr<std::istream> cmvn_stream = ModelBundle::OpenStream(cmvn_file);
+    if (!cmvn_stream) {
+        LOG(ERROR) << "Failed to open file: " << cmvn_file;
+        return false;
+    }
+    means.clear();
+    vars.clear();
+    std::string line;
+    while (getline(*cmvn_stream, line)) {
+        std::istringstream iss(line);
+        std::vector<std::string> line_item{std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{}};
+        if (line_item.empty()) {
+            continue;
+        }
+        if (line_item[0] == "<AddShift>") {
+            getline(*cmvn_stream, line);
+            std::istringstream means_lines_stream(line);
+            std::vector<std::string> means_lines{std::istream_iterator<std::string>{means_lines_stream}, std::istream_iterator<std::string>{}};
+            if (!means_lines.empty() && means_lines[0] == "<LearnRateCoef>") {
+                for (int j = 3; j < (int)means_lines.size() - 1; j++) {
+                    means.push_back(stof(means_lines[j]));
+                }
+            }
+        } else if (line_item[0] == "<Rescale>") {
+            getline(*cmvn_stream, line);
+            std::istringstream vars_lines_stream(line);
+            std::vector<std::string> vars_lines{std::istream_iterator<std::string>{vars_lines_stream}, std::istream_iterator<std::string>{}};
+            if (!vars_lines.empty() && vars_lines[0] == "<LearnRateCoef>") {
+                for (int j = 3; j < (int)vars_lines.size() - 1; j++) {
+                    vars.push_back(stof(vars_lines[j]));
+                }
+            }
+        }
+    }
+
+    if (!sidecar.empty()) {
+        records.resize(2);
+        records[0].assign((const char*)means.data(), (const char*)(means.data() + means.size()));
+        records[1].assign((const char*)vars.data(), (const char*)(vars.data() + vars.size()));
+        WriteSidecar(sidecar, CMVN_MAGIC, records);
+    }
+    return true;
+}
+
+bool ModelCache::LoadTokens(const std::string &token_file, std::vector<std::string> &tokens)
+{
+    ModelBundle::Entry entry;
+    std::shared_ptr<ModelBundle> bundle = ModelBundle::Find(token_file, entry);
+    if (bundle && entry.kind == ModelBundle::TOKENS) {
+        return ModelBundle::ReadStrings(entry.data, entry.size, tokens);
+    }
+
+    std::string sidecar = CacheFile(token_file, "tokens", ".bin");
+    std::vector<std::vector<char>> records;
+    if (!sidecar.empty() && ReadSidecar(sidecar, TOKENS_MAGIC, records)) {
+        tokens.clear();
+        tokens.reserve(records.size());
+        for (auto &record : records) {
+            tokens.emplace_back(record.begin(), record.end());
+        }
+        return true;
+    }
+
+    nlohmann::json json_array;
+    std::unique_ptr<std::istream> file = ModelBundle::OpenStream(token_file);
+    if (!file) {
+        return false;
+    }
+    *file >> json_array;
+    tokens.clear();
+    for (const auto &element : json_array) {
+        tokens.push_back(element);
+    }
+
+    if (!sidecar.empty()) {
+        records.clear();
+        for (auto &token : tokens) {
+            records.emplace_back(token.begin(), token.end());
+        }
+        WriteSidecar(sidecar, TOKENS_MAGIC, records);
+    }
+    return true;
+}
+
+} // namespace funasr
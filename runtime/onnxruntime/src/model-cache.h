@@ -0,0 +1,52 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "onnxruntime_cxx_api.h"
+
+namespace funasr {
+
+// Files derived from the model files by the first start and reused by every
+// later one: the onnx graphs after graph optimization, and binary sidecars of
+// the text cmvn and token files. A cache file is named by a hash of the
+// content of its source file and, for graphs, of the onnxruntime version and
+// the cpu features, so an updated model, runtime or machine misses the cache
+// instead of loading a stale file. Without a cache dir everything is loaded
+// from the source files as before.
+class ModelCache {
+  public:
+    // creates dir if missing, empty disables the cache
+    static bool SetDir(const std::string &dir);
+
+    // Session of model_path. Loads the cached optimized graph without
+    // optimizing it again, or optimizes the model with options and saves the
+    // result for the next start.
+    static Ort::Session *LoadSession(const std::string &model_path, const Ort::SessionOptions &options,
+                                     OrtPrepackedWeightsContainer *prepacked_weights);
+    // means and vars of a kaldi am.mvn
+    static bool LoadCmvn(const std::string &cmvn_file, std::vector<float> &means, std::vector<float> &vars);
+    // token list of a tokens.json
+    static bool LoadTokens(const std::string &token_file, std::vector<std::string> &tokens);
+
+  private:
+    static std::string Dir();
+    // cache file of src_file for the given tag, "" without cache dir
+    static std::string CacheFile(const std::string &src_file, const std::string &tag, const std::string &ext);
+    static std::string TempFile(const std::string &file);
+    static std::string GraphTag();
+    static bool ReadSidecar(const std::string &file, uint32_t magic, std::vector<std::vector<char>> &records);
+    static void WriteSidecar(const std::string &file, uint32_t magic, const std::vector<std::vector<char>> &records);
+
+    static std::mutex mutex_;
+    static std::string dir_;
+};
+
+} // namespace funasr
+#endif
@@ -0,0 +1,106 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "model-registry.h"
+#include <chrono>
+
+namespace funasr {
+
+ModelRegistry &ModelRegistry::Instance()
+{
+    static ModelRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<void> ModelRegistry::Find(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = resources_.find(key);
+    if (it == resources_.end()) {
+        return nullptr;
+    }
+    return it->second.lock();
+}
+
+std::shared_ptr<void> ModelRegistry::Insert(const std::string &key, std::shared_ptr<void> resource)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::weak_ptr<void> &entry = resources_[key];
+    std::shared_ptr<void> current = entry.lock();
+    if (current) {
+        return current;
+    }
+    entry = resource;
+    // drop the entries of resources freed by their last handle
+    for (auto it = resources_.begin(); it != resources_.end();) {
+        if (it->second.expired()) {
+            it = resources_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return resource;
+}
+
+std::shared_ptr<Ort::Session> ModelRegistry::GetSession(const std::string &model_path,
+                                                        const Ort::SessionOptions &options, int thread_num)
+{
+    // with a cpu budget the sessions have no pool of their own
+    std::string key = model_path + "|threads=" +
+                      (RuntimeContext::CpuBudget() > 0 ? std::string("global") : std::to_string(thread_num));
+    bool loaded = false;
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<Ort::Session> session = Get<Ort::Session>(key, [&]() {
+        ModelRegistry &registry = Instance();
+        OrtPrepackedWeightsContainer *prepacked_weights = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex_);
+            if (!registry.prepacked_weights_) {
+                registry.prepacked_weights_ = std::make_unique<Ort::PrepackedWeightsContainer>();
+            }
+            prepacked_weights = *registry.prepacked_weights_;
+        }
+        loaded = true;
+        return ModelCache::LoadSession(model_path, options, prepacked_weights);
+    });
+    if (!loaded) {
+        LOG(INFO) << "Share the loaded model " << model_path;
+    } else if (session) {
+        LOG(INFO) << "Load session of " << model_path << " in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s";
+    }
+    return session;
+}
+
+std::shared_ptr<Vocab> ModelRegistry::GetVocab(const std::string &token_file)
+{
+    return Get<Vocab>(token_file, [&]() {
+        return new Vocab(token_file.c_str());
+    });
+}
+
+std::shared_ptr<Vocab> ModelRegistry::GetVocab(const std::string &lm_cfg_file, const std::string &lex_file)
+{
+    return Get<Vocab>(lm_cfg_file + "|" + lex_file, [&]() {
+        return new Vocab(lm_cfg_file.c_str(), lex_file.c_str());
+    });
+}
+
+std::shared_ptr<PhoneSet> ModelRegistry::GetPhoneSet(const std::string &token_file)
+{
+    return Get<PhoneSet>(token_file, [&]() {
+        return new PhoneSet(token_file.c_str());
+    });
+}
+
+std::shared_ptr<SegDict> ModelRegistry::GetSegDict(const std::string &seg_dict_file)
+{
+    return Get<SegDict>(seg_dict_file, [&]() {
+        return new SegDict(seg_dict_file.c_str());
+    });
+}
+
+} // namespace funasr
@@ -0,0 +1,79 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include "onnxruntime_cxx_api.h"
+
+namespace funasr {
+class Vocab;
+class PhoneSet;
+class SegDict;
+
+// Models and resources loaded from disk, shared by all handles of the process.
+// Every offline, 2pass, vad and punc handle asking for the same file gets the
+// same object, so a second handle on a model costs neither the load time nor
+// the memory again. The registry only keeps weak references: a resource is
+// freed with the last handle using it and loaded again by the next one.
+// Everything handed out is read-only after loading, Ort::Session::Run is
+// thread safe.
+class ModelRegistry {
+  public:
+    // Session of model_path created with options. The key also holds the
+    // thread setting, the only session option the models set differently.
+    // All sessions share one prepacked weights container, so the prepacked
+    // weights of a model loaded with different settings exist only once.
+    static std::shared_ptr<Ort::Session> GetSession(const std::string &model_path,
+                                                    const Ort::SessionOptions &options, int thread_num);
+    static std::shared_ptr<Vocab> GetVocab(const std::string &token_file);
+    static std::shared_ptr<Vocab> GetVocab(const std::string &lm_cfg_file, const std::string &lex_file);
+    static std::shared_ptr<PhoneSet> GetPhoneSet(const std::string &token_file);
+    static std::shared_ptr<SegDict> GetSegDict(const std::string &seg_dict_file);
+
+    // Resource of type T registered under key, created by load() if no handle
+    // holds it. load() runs without the registry lock and may return nullptr
+    // or throw, neither is cached.
+    template <typename T>
+    static std::shared_ptr<T> Get(const std::string &key, const std::function<T*()> &load);
+
+  private:
+    static ModelRegistry &Instance();
+    std::shared_ptr<void> Find(const std::string &key);
+    // returns the resource registered under key meanwhile, or resource
+    std::shared_ptr<void> Insert(const std::string &key, std::shared_ptr<void> resource);
+
+    std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<void>> resources_;
+    std::unique_ptr<Ort::PrepackedWeightsContainer> prepacked_weights_ = nullptr;
+};
+
+template <typename T>
+std::shared_ptr<T> ModelRegistry::Get(const std::string &key, const std::function<T*()> &load)
+{
+    std::string type_key = std::string(typeid(T).name()) + ":" + key;
+    ModelRegistry &registry = Instance();
+    std::shared_ptr<void> resource = registry.Find(type_key);
+    if (resource) {
+        return std::static_pointer_cast<T>(resource);
+    }
+    // loading can take seconds, handles of other models do not wait for it.
+    // Two handles loading the same file at once both load it, the later one
+    // takes the copy of the first and drops its own.
+    std::shared_ptr<T> loaded(load());
+    if (!loaded) {
+        return nullptr;
+    }
+    return std::static_pointer_cast<T>(registry.Insert(type_key, loaded));
+}
+
+} // namespace funasr
+#endif
@@ -18,9 +18,12 @@ Model *CreateModel(std::map<std::string, std::string>& model_path, int thread_nu
         am_config_path = PathAppend(model_path.at(MODEL_DIR), AM_CONFIG_NAME);
         token_path = PathAppend(model_path.at(MODEL_DIR), TOKEN_PATH);
 
+        LoadTimer timer("Offline asr handle");
         Model *mm;
         mm = new Paraformer();
         mm->InitAsr(am_model_path, am_cmvn_path, am_config_path, token_path, thread_num);
+        timer.Mark("asr");
+        timer.Report();
         return mm;
     }else if(type == ASR_ONLINE){
         // online
@@ -40,9 +43,12 @@ Model *CreateModel(std::map<std::string, std::string>& model_path, int thread_nu
         am_config_path = PathAppend(model_path.at(MODEL_DIR), AM_CONFIG_NAME);
         token_path = PathAppend(model_path.at(MODEL_DIR), TOKEN_PATH);
 
+        LoadTimer timer("Online asr handle");
         Model *mm;
         mm = new Paraformer();
         mm->InitAsr(en_model_path, de_model_path, am_cmvn_path, am_config_path, token_path, thread_num);
+        timer.Mark("asr");
+        timer.Report();
         return mm;
     }else{
         LOG(ERROR)<<"Wrong ASR_TYPE : " << type;
@@ -0,0 +1,148 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "offline-batcher.h"
+
+namespace funasr {
+
+OfflineBatcher::OfflineBatcher(int max_batch, int max_wait_us, int sample_rate)
+    : max_batch_samples_((int64_t)300 * sample_rate), max_segment_samples_(60 * sample_rate),
+      queue_(max_batch, max_wait_us)
+{
+}
+
+size_t OfflineBatcher::HashHotwords(const FunHotwordEmbedding &hw_emb)
+{
+    // fnv-1a over the float bits, read in place
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)hw_emb.num_hotwords;
+    for (float value : hw_emb.data) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+bool OfflineBatcher::SameHotwords(const FunHotwordEmbedding &a, const FunHotwordEmbedding &b)
+{
+    return &a == &b || (a.num_hotwords == b.num_hotwords && a.dim == b.dim && a.data == b.data);
+}
+
+std::vector<OfflineBatcher::Segment*> OfflineBatcher::SelectBatch(const std::vector<Segment*> &queued)
+{
+    // the queued segments with the hotwords of the oldest one, sorted by
+    // length, the oldest one is always taken
+    std::vector<Segment*> candidates;
+    for (Segment *seg : queued) {
+        if (candidates.empty() || SameHotwords(*seg->request->hw_emb, *candidates[0]->request->hw_emb)) {
+            candidates.emplace_back(seg);
+        }
+    }
+    Segment *oldest = candidates[0];
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Segment *a, const Segment *b) { return a->len < b->len; });
+    int count = candidates.size();
+    int pos = std::find(candidates.begin(), candidates.end(), oldest) - candidates.begin();
+    int size = std::min(queue_.MaxBatch(), count);
+    if (oldest->len >= max_segment_samples_) {
+        size = 1;
+    }
+    // the window of size segments around the oldest one with the least padding
+    int begin = -1;
+    int spread = 0;
+    for (int start = std::max(0, pos - size + 1); start <= std::min(pos, count - size); start++) {
+        int start_spread = candidates[start + size - 1]->len - candidates[start]->len;
+        if (begin < 0 || start_spread < spread) {
+            begin = start;
+            spread = start_spread;
+        }
+    }
+    // drop the longest segments until the padded batch fits
+    int end = begin + size;
+    while (end - begin > 1 && (int64_t)candidates[end - 1]->len * (end - begin) > max_batch_samples_) {
+        if (candidates[end - 1] != oldest) {
+            end--;
+        } else {
+            begin++;
+        }
+    }
+    return std::vector<Segment*>(candidates.begin() + begin, candidates.begin() + end);
+}
+
+void OfflineBatcher::RunBatch(const std::vector<Segment*> &batch)
+{
+    int batch_in = batch.size();
+    std::vector<float*> din(batch_in);
+    std::vector<int> len(batch_in);
+    std::vector<void*> wfst_decoders(batch_in);
+    std::vector<const FbankCache*> caches;
+    for (int i = 0; i < batch_in; i++) {
+        din[i] = batch[i]->data;
+        len[i] = batch[i]->len;
+        wfst_decoders[i] = batch[i]->request->wfst_decoder;
+        const FbankCache *cache = batch[i]->request->fbank_cache;
+        if (cache && std::find(caches.begin(), caches.end(), cache) == caches.end()) {
+            caches.emplace_back(cache);
+        }
+    }
+    std::vector<std::string> texts;
+    std::exception_ptr error;
+    try {
+        // the requests are blocked until their segments are done, so their
+        // caches and audio stay as they are while the batch runs
+        FbankCache joined;
+        const FbankCache *fbank_cache = nullptr;
+        if (caches.size() == 1) {
+            fbank_cache = caches[0];
+        } else if (caches.size() > 1) {
+            joined.Join(caches);
+            fbank_cache = &joined;
+        }
+        Request *first = batch[0]->request;
+        texts = first->asr->Forward(din.data(), len.data(), true, *first->hw_emb, wfst_decoders, fbank_cache);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (!error && texts.size() != batch.size()) {
+        LOG(ERROR) << "Offline batch of " << batch.size() << " segments returned " << texts.size() << " texts";
+    }
+    for (int i = 0; i < batch_in; i++) {
+        if (error) {
+            batch[i]->error = error;
+        } else if (i < (int)texts.size()) {
+            batch[i]->text = texts[i];
+        }
+    }
+}
+
+std::vector<std::string> OfflineBatcher::Forward(Model *asr, float **din, const int *len, int num_segments,
+                                                 const FunHotwordEmbedding &hw_emb, void *wfst_decoder,
+                                                 const FbankCache *fbank_cache)
+{
+    Request req = {asr, &hw_emb, fbank_cache, wfst_decoder};
+    std::vector<Segment> segments(num_segments);
+    std::vector<Segment*> items;
+    for (int i = 0; i < num_segments; i++) {
+        segments[i] = {&req, din[i], len[i], "", nullptr, false};
+        items.emplace_back(&segments[i]);
+    }
+    if (num_segments > 0) {
+        queue_.Submit(items, HashHotwords(hw_emb),
+                      [this](const std::vector<Segment*> &queued) { return SelectBatch(queued); },
+                      [this](const std::vector<Segment*> &batch) { RunBatch(batch); });
+    }
+
+    std::vector<std::string> results;
+    for (auto &seg : segments) {
+        if (seg.error) {
+            std::rethrow_exception(seg.error);
+        }
+        results.emplace_back(std::move(seg.text));
+    }
+    return results;
+}
+
+} // namespace funasr
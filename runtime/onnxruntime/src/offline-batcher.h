@@ -0,0 +1,71 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef OFFLINE_BATCHER_H
+#define OFFLINE_BATCHER_H
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "funasrruntime.h"
+#include "batch-queue.h"
+#include "fbank-cache.h"
+#include "model.h"
+
+namespace funasr {
+
+// Decodes the vad segments of concurrent offline requests in shared batches.
+// Every request queues its segments under the hash of its hotwords and waits;
+// the leader of a batch takes the oldest queued segment with the ones closest
+// to it in length, runs them through one Model::Forward and hands the texts
+// back to the requests they came from. Segments batch with each other only when
+// their requests have equal hotword embeddings. A request with a wfst decoder
+// has its segments searched with it after the shared am run. The callers keep
+// their own timestamps, punc and itn.
+class OfflineBatcher {
+  public:
+    OfflineBatcher(int max_batch, int max_wait_us, int sample_rate);
+
+    // Texts of the segments din[i][0, len[i]), like asr->Forward of them in
+    // batches of one request. din must stay valid until it returns, fbank_cache
+    // is the cache of the audio holding them, or nullptr. wfst_decoder is the
+    // decoder handle of the request, or nullptr for greedy search.
+    std::vector<std::string> Forward(Model *asr, float **din, const int *len, int num_segments,
+                                     const FunHotwordEmbedding &hw_emb, void *wfst_decoder,
+                                     const FbankCache *fbank_cache);
+
+  private:
+    struct Request {
+        Model *asr;
+        const FunHotwordEmbedding *hw_emb;
+        const FbankCache *fbank_cache;
+        void *wfst_decoder;
+    };
+    struct Segment {
+        Request *request;
+        float *data;
+        int len;
+        std::string text;
+        std::exception_ptr error;
+        bool done;
+    };
+
+    // the oldest queued segment with the ones closest to it in length
+    std::vector<Segment*> SelectBatch(const std::vector<Segment*> &queued);
+    void RunBatch(const std::vector<Segment*> &batch);
+    static size_t HashHotwords(const FunHotwordEmbedding &hw_emb);
+    static bool SameHotwords(const FunHotwordEmbedding &a, const FunHotwordEmbedding &b);
+
+    // limits of Audio::FetchDynamic: padded samples per batch, and the length
+    // from which a segment runs alone
+    int64_t max_batch_samples_;
+    int max_segment_samples_;
+    // segments of requests with equal hotword hashes can share a batch
+    BatchQueue<Segment, size_t> queue_;
+};
+
+} // namespace funasr
+#endif
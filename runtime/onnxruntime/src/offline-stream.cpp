@@ -3,6 +3,7 @@
 namespace funasr {
 OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu, int batch_size)
 {
+    LoadTimer timer("Offline handle");
     // VAD model
     if(model_path.find(VAD_DIR) != model_path.end()){
         string vad_model_path;
@@ -15,15 +16,16 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         }
         vad_cmvn_path = PathAppend(model_path.at(VAD_DIR), VAD_CMVN_NAME);
         vad_config_path = PathAppend(model_path.at(VAD_DIR), VAD_CONFIG_NAME);
-        if (access(vad_model_path.c_str(), F_OK) != 0 ||
-            access(vad_cmvn_path.c_str(), F_OK) != 0 ||
-            access(vad_config_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(vad_model_path) ||
+            !ModelBundle::Exists(vad_cmvn_path) ||
+            !ModelBundle::Exists(vad_config_path) )
         {
             LOG(INFO) << "VAD model file is not exist, skip load vad model.";
         }else{
             vad_handle = make_unique<FsmnVad>();
             vad_handle->InitVad(vad_model_path, vad_cmvn_path, vad_config_path, thread_num);
             use_vad = true;
+            timer.Mark("vad");
         }
     }
 
@@ -44,6 +46,7 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
             #else
             LOG(ERROR) <<"GPU is not supported! CPU will be used! If you want to use GPU, please add -DGPU=ON when cmake";
             asr_handle = make_unique<Paraformer>();
+            asr_handle->SetBatchSize(batch_size);
             use_gpu = false;
             #endif
         }else{
@@ -53,6 +56,7 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
                 model_type = MODEL_SVS;
             }else{
                 asr_handle = make_unique<Paraformer>();
+                asr_handle->SetBatchSize(batch_size);
             }
         }
 
@@ -60,15 +64,17 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         hw_cpu_model_path = PathAppend(model_path.at(MODEL_DIR), MODEL_EB_NAME);
         hw_gpu_model_path = PathAppend(model_path.at(MODEL_DIR), TORCH_MODEL_EB_NAME);
         seg_dict_path = PathAppend(model_path.at(MODEL_DIR), MODEL_SEG_DICT);
-        if (access(hw_cpu_model_path.c_str(), F_OK) == 0) { // if model_eb.onnx exist, hotword enabled
+        if (ModelBundle::Exists(hw_cpu_model_path)) { // if model_eb.onnx exist, hotword enabled
           enable_hotword = true;
           asr_handle->InitHwCompiler(hw_cpu_model_path, thread_num);
           asr_handle->InitSegDict(seg_dict_path);
+          timer.Mark("hotword");
         }
         if (use_gpu && access(hw_gpu_model_path.c_str(), F_OK) == 0) { // if model_eb.torchscript exist, hotword enabled
           enable_hotword = true;
           asr_handle->InitHwCompiler(hw_gpu_model_path, thread_num);
           asr_handle->InitSegDict(seg_dict_path);
+          timer.Mark("hotword");
         }
 
         am_model_path = PathAppend(model_path.at(MODEL_DIR), MODEL_NAME);
@@ -87,6 +93,7 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         token_path = PathAppend(model_path.at(MODEL_DIR), TOKEN_PATH);
 
         asr_handle->InitAsr(am_model_path, am_cmvn_path, am_config_path, token_path, thread_num);
+        timer.Mark("asr");
     }
 
     // Lm resource
@@ -95,11 +102,12 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         fst_path = PathAppend(model_path.at(LM_DIR), LM_FST_RES);
         lm_config_path = PathAppend(model_path.at(LM_DIR), LM_CONFIG_NAME);
         lex_path = PathAppend(model_path.at(LM_DIR), LEX_PATH);
-        if (access(lex_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(lex_path) )
         {
             LOG(ERROR) << "Lexicon.txt file is not exist, please use the latest version. Skip load LM model.";
         }else{
             asr_handle->InitLm(fst_path, lm_config_path, lex_path);
+            timer.Mark("lm");
         }
     }
 
@@ -116,15 +124,16 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         punc_config_path = PathAppend(model_path.at(PUNC_DIR), PUNC_CONFIG_NAME);
         token_path = PathAppend(model_path.at(PUNC_DIR), TOKEN_PATH);
 
-        if (access(punc_model_path.c_str(), F_OK) != 0 ||
-            access(punc_config_path.c_str(), F_OK) != 0 ||
-            access(token_path.c_str(), F_OK) != 0)
+        if (!ModelBundle::Exists(punc_model_path) ||
+            !ModelBundle::Exists(punc_config_path) ||
+            !ModelBundle::Exists(token_path))
         {
             LOG(INFO) << "PUNC model file is not exist, skip load punc model.";
         }else{
             punc_handle = make_unique<CTTransformer>();
             punc_handle->InitPunc(punc_model_path, punc_config_path, token_path, thread_num);
             use_punc = true;
+            timer.Mark("punc");
         }
     }
 #if !defined(__APPLE__)
@@ -133,14 +142,15 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         string itn_tagger_path = PathAppend(model_path.at(ITN_DIR), ITN_TAGGER_NAME);
         string itn_verbalizer_path = PathAppend(model_path.at(ITN_DIR), ITN_VERBALIZER_NAME);
 
-        if (access(itn_tagger_path.c_str(), F_OK) != 0 ||
-            access(itn_verbalizer_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(itn_tagger_path) ||
+            !ModelBundle::Exists(itn_verbalizer_path) )
         {
             LOG(INFO) << "ITN model file is not exist, skip load ITN model.";
         }else{
             itn_handle = make_unique<ITNProcessor>();
             itn_handle->InitITN(itn_tagger_path, itn_verbalizer_path, thread_num);
             use_itn = true;
+            timer.Mark("itn");
         }
     }
 #endif
@@ -148,6 +158,21 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
         use_itn = false;
         use_punc = false;
     }
+    timer.Report();
+}
+
+OfflineStream::~OfflineStream()
+{
+}
+
+void OfflineStream::SetRequestBatch(int max_batch, int max_wait_us)
+{
+    // the sensevoice forward takes no hotwords and decodes one language per call
+    if (max_batch <= 1 || !asr_handle || model_type == MODEL_SVS) {
+        request_batcher.reset();
+        return;
+    }
+    request_batcher = make_unique<OfflineBatcher>(max_batch, max_wait_us, asr_handle->GetAsrSampleRate());
 }
 
 OfflineStream *CreateOfflineStream(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu, int batch_size)
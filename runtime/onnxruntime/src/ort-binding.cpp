@@ -0,0 +1,115 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "ort-binding.h"
+
+namespace funasr {
+
+OrtBinding::OrtBinding(Ort::Session *session, const std::vector<const char*> &input_names,
+                       const std::vector<const char*> &output_names, int max_buckets)
+    : session_(session), input_names_(input_names), output_names_(output_names),
+      max_buckets_(std::max(max_buckets, 1)),
+      memory_info_(Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU)),
+      binding_(*session), caller_outputs_(output_names.size(), nullptr)
+{
+}
+
+void OrtBinding::BindInput(size_t index, const Ort::Value &value)
+{
+    binding_.BindInput(input_names_[index], value);
+}
+
+void OrtBinding::BindOutput(size_t index, const Ort::Value &value)
+{
+    caller_outputs_[index] = &value;
+}
+
+void OrtBinding::BindOutputs(const std::vector<Ort::Value> *kept)
+{
+    // in index order, GetOutputValues() returns them in binding order
+    binding_.ClearBoundOutputs();
+    for (size_t i = 0; i < output_names_.size(); i++) {
+        if (caller_outputs_[i]) {
+            binding_.BindOutput(output_names_[i], *caller_outputs_[i]);
+        } else if (kept) {
+            binding_.BindOutput(output_names_[i], (*kept)[i]);
+        } else {
+            binding_.BindOutput(output_names_[i], memory_info_);
+        }
+    }
+}
+
+// the status onnxruntime fails a run with when a bound output tensor has a
+// different shape than the node writing it produces
+static bool IsBufferShapeMismatch(const Ort::Exception &e)
+{
+    return e.GetOrtErrorCode() == ORT_FAIL &&
+           strstr(e.what(), "Shape mismatch attempting to re-use buffer") != nullptr;
+}
+
+void OrtBinding::Run(int64_t bucket)
+{
+    outputs_ = nullptr;
+    auto it = buckets_.find(bucket);
+    if (it != buckets_.end()) {
+        // outputs the caller bound when the bucket was learned are not kept
+        for (size_t i = 0; i < output_names_.size(); i++) {
+            if (!caller_outputs_[i] && (OrtValue*)it->second[i] == nullptr) {
+                buckets_.erase(it);
+                it = buckets_.end();
+                break;
+            }
+        }
+    }
+    try {
+        if (it != buckets_.end()) {
+            try {
+                BindOutputs(&it->second);
+                session_->Run(Ort::RunOptions{nullptr}, binding_);
+                outputs_ = &it->second;
+            } catch (Ort::Exception const &e) {
+                // the outputs of the bucket did not fit, learn them again;
+                // any other error is the caller's and must not run twice
+                if (!IsBufferShapeMismatch(e)) {
+                    throw;
+                }
+                buckets_.erase(it);
+                it = buckets_.end();
+            }
+        }
+        if (it == buckets_.end()) {
+            BindOutputs(nullptr);
+            session_->Run(Ort::RunOptions{nullptr}, binding_);
+            if ((int)buckets_.size() >= max_buckets_) {
+                buckets_.clear();
+            }
+            std::vector<Ort::Value> &kept = buckets_[bucket];
+            kept = binding_.GetOutputValues();
+            for (size_t i = 0; i < kept.size(); i++) {
+                if (caller_outputs_[i]) {
+                    kept[i] = Ort::Value(nullptr);
+                }
+            }
+            outputs_ = &kept;
+        }
+    } catch (...) {
+        binding_.ClearBoundInputs();
+        binding_.ClearBoundOutputs();
+        std::fill(caller_outputs_.begin(), caller_outputs_.end(), nullptr);
+        throw;
+    }
+    // inputs and caller outputs are only borrowed for this run
+    binding_.ClearBoundInputs();
+    binding_.ClearBoundOutputs();
+    std::fill(caller_outputs_.begin(), caller_outputs_.end(), nullptr);
+}
+
+Ort::Value &OrtBinding::Output(size_t index)
+{
+    return (*outputs_)[index];
+}
+
+} // namespace funasr
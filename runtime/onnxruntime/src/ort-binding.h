@@ -0,0 +1,50 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef ORT_BINDING_H
+#define ORT_BINDING_H
+
+#include <map>
+#include <vector>
+#include "onnxruntime_cxx_api.h"
+
+namespace funasr {
+
+// Ort::IoBinding of one session that keeps its output tensors between runs.
+// The first run of a bucket lets onnxruntime allocate the outputs, later runs of
+// the same bucket write into those tensors again, so a steady stream of equally
+// shaped runs allocates nothing. The caller picks the bucket key so that it
+// determines every output shape (e.g. the number of frames). Outputs can also be
+// bound to the caller's own buffers, e.g. a cache fed back as input next run.
+// Not thread safe, use one per stream or take it from a pool.
+class OrtBinding {
+  public:
+    OrtBinding(Ort::Session *session, const std::vector<const char*> &input_names,
+               const std::vector<const char*> &output_names, int max_buckets=8);
+
+    // value must stay alive until Run() returns
+    void BindInput(size_t index, const Ort::Value &value);
+    // output index is written into value instead of a kept tensor, for the next Run() only
+    void BindOutput(size_t index, const Ort::Value &value);
+    void Run(int64_t bucket);
+    // output of the last Run() that was not bound by the caller, valid until the next Run()
+    Ort::Value &Output(size_t index);
+
+  private:
+    void BindOutputs(const std::vector<Ort::Value> *kept);
+
+    Ort::Session *session_;
+    std::vector<const char*> input_names_;
+    std::vector<const char*> output_names_;
+    int max_buckets_;
+    Ort::MemoryInfo memory_info_;
+    Ort::IoBinding binding_;
+    std::vector<const Ort::Value*> caller_outputs_;
+    std::map<int64_t, std::vector<Ort::Value>> buckets_;
+    std::vector<Ort::Value> *outputs_ = nullptr;
+};
+
+} // namespace funasr
+#endif
@@ -17,6 +17,7 @@ ParaformerOnline::ParaformerOnline(Model* offline_handle, std::vector<int> chunk
         para_handle->fbank_opts_,
         para_handle->encoder_session_,
         para_handle->decoder_session_,
+        para_handle->online_batcher_,
         para_handle->en_szInputNames_,
         para_handle->en_szOutputNames_,
         para_handle->de_szInputNames_,
@@ -40,6 +41,7 @@ ParaformerOnline::ParaformerOnline(Model* offline_handle, std::vector<int> chunk
         svs_handle->fbank_opts_,
         svs_handle->encoder_session_,
         svs_handle->decoder_session_,
+        svs_handle->online_batcher_,
         svs_handle->en_szInputNames_,
         svs_handle->en_szOutputNames_,
         svs_handle->de_szInputNames_,
@@ -65,6 +67,7 @@ void ParaformerOnline::InitOnline(
         knf::FbankOptions &fbank_opts,
         std::shared_ptr<Ort::Session> &encoder_session,
         std::shared_ptr<Ort::Session> &decoder_session,
+        std::shared_ptr<SessionBatcher> &online_batcher,
         vector<const char*> &en_szInputNames,
         vector<const char*> &en_szOutputNames,
         vector<const char*> &de_szInputNames,
@@ -85,6 +88,7 @@ void ParaformerOnline::InitOnline(
     fbank_opts_ = fbank_opts;
     encoder_session_ = encoder_session;
     decoder_session_ = decoder_session;
+    online_batcher_ = online_batcher;
     en_szInputNames_ = en_szInputNames;
     en_szOutputNames_ = en_szOutputNames;
     de_szInputNames_ = de_szInputNames;
@@ -106,242 +110,156 @@ void ParaformerOnline::InitOnline(
 
     // other vars
     sqrt_factor = std::sqrt(encoder_size);
-    for(int i=0; i<fsmn_lorder*fsmn_dims; i++){
-        fsmn_init_cache_.emplace_back(0);
-    }
     chunk_len = chunk_size[1]*frame_shift*lfr_n*offline_handle_->GetAsrSampleRate()/1000;
 
     frame_sample_length_ = offline_handle_->GetAsrSampleRate() / 1000 * frame_length;
     frame_shift_sample_length_ = offline_handle_->GetAsrSampleRate() / 1000 * frame_shift;
-
-}
-
-void ParaformerOnline::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &wav_feats,
-                               std::vector<float> &waves) {
-    knf::OnlineFbank fbank(fbank_opts_);
-    // cache merge
-    waves.insert(waves.begin(), input_cache_.begin(), input_cache_.end());
-    int frame_number = ComputeFrameNum(waves.size(), frame_sample_length_, frame_shift_sample_length_);
-    // Send the audio after the last frame shift position to the cache
-    input_cache_.clear();
-    input_cache_.insert(input_cache_.begin(), waves.begin() + frame_number * frame_shift_sample_length_, waves.end());
-    if (frame_number == 0) {
-        return;
+    lfr_splice_cache_.Resize(0, fbank_opts_.mel_opts.num_bins);
+    fbank_opts_.frame_opts.max_feature_vectors = ONLINE_FBANK_MAX_FRAMES;
+    fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts_);
+    pos_emb_table_ = PosEmbTable::GetInstance(lfr_m*n_mels);
+    // batched streams go through the batcher, which allocates per batch anyway
+    if (!online_batcher_) {
+        encoder_binding_ = std::make_unique<OrtBinding>(encoder_session_.get(), en_szInputNames_, en_szOutputNames_);
+        decoder_binding_ = std::make_unique<OrtBinding>(decoder_session_.get(), de_szInputNames_, de_szOutputNames_);
     }
-    // Delete audio that haven't undergone fbank processing
-    waves.erase(waves.begin() + (frame_number - 1) * frame_shift_sample_length_ + frame_sample_length_, waves.end());
+}
 
-    std::vector<float> buf(waves.size());
-    for (int32_t i = 0; i != waves.size(); ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
-    int32_t frames = fbank.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        wav_feats.emplace_back(frame_vector);
-    }
+// Feeds only the new samples to the long-lived fbank_ and returns the frames it made ready
+void ParaformerOnline::FbankKaldi(float sample_rate, FeatureMatrix &wav_feats,
+                               const float *waves, int len, bool input_finished) {
+    int32_t num_bins = fbank_opts_.mel_opts.num_bins;
+    wav_feats.Resize(0, num_bins);
+    // at most ONLINE_FBANK_MAX_FRAMES frames per AcceptWaveform, so none is recycled before it is read
+    int step = ONLINE_FBANK_MAX_FRAMES * frame_shift_sample_length_;
+    int offset = 0;
+    do {
+        int n = std::min(step, len - offset);
+        if (n > 0) {
+            fbank_buf_.resize(n);
+            for (int32_t i = 0; i != n; ++i) {
+                fbank_buf_[i] = waves[offset + i] * 32768;
+            }
+            fbank_->AcceptWaveform(sample_rate, fbank_buf_.data(), n);
+            offset += n;
+        }
+        if (offset >= len && input_finished) {
+            fbank_->InputFinished();
+        }
+        for (; fbank_frames_ < fbank_->NumFramesReady(); ++fbank_frames_) {
+            wav_feats.AppendRow(fbank_->GetFrame(fbank_frames_));
+        }
+    } while (offset < len);
 }
 
-void ParaformerOnline::ExtractFeats(float sample_rate, vector<std::vector<float>> &wav_feats,
+void ParaformerOnline::ExtractFeats(float sample_rate, FeatureMatrix &wav_feats,
                                  vector<float> &waves, bool input_finished) {
-    FbankKaldi(sample_rate, wav_feats, waves);
+    wav_feats.Clear();
+    FbankKaldi(sample_rate, fbank_feats_, waves.data(), waves.size(), input_finished);
     // cache deal & online lfr,cmvn
-    if (wav_feats.size() > 0) {
-        if (!reserve_waveforms_.empty()) {
-        waves.insert(waves.begin(), reserve_waveforms_.begin(), reserve_waveforms_.end());
-        }
-        if (lfr_splice_cache_.empty()) {
+    if (fbank_feats_.NumRows() > 0) {
+        if (lfr_splice_cache_.Empty()) {
             for (int i = 0; i < (lfr_m - 1) / 2; i++) {
-                lfr_splice_cache_.emplace_back(wav_feats[0]);
-            }
-        }
-        if (wav_feats.size() + lfr_splice_cache_.size() >= lfr_m) {
-            wav_feats.insert(wav_feats.begin(), lfr_splice_cache_.begin(), lfr_splice_cache_.end());
-            int frame_from_waves = (waves.size() - frame_sample_length_) / frame_shift_sample_length_ + 1;
-            int minus_frame = reserve_waveforms_.empty() ? (lfr_m - 1) / 2 : 0;
-            int lfr_splice_frame_idxs = OnlineLfrCmvn(wav_feats, input_finished);
-            int reserve_frame_idx = std::abs(lfr_splice_frame_idxs - minus_frame);
-            reserve_waveforms_.clear();
-            reserve_waveforms_.insert(reserve_waveforms_.begin(),
-                                        waves.begin() + reserve_frame_idx * frame_shift_sample_length_,
-                                        waves.begin() + frame_from_waves * frame_shift_sample_length_);
-            int sample_length = (frame_from_waves - 1) * frame_shift_sample_length_ + frame_sample_length_;
-            waves.erase(waves.begin() + sample_length, waves.end());
-        } else {
-            reserve_waveforms_.clear();
-            reserve_waveforms_.insert(reserve_waveforms_.begin(),
-                                        waves.begin() + frame_sample_length_ - frame_shift_sample_length_, waves.end());
-            lfr_splice_cache_.insert(lfr_splice_cache_.end(), wav_feats.begin(), wav_feats.end());
-        }
-    } else {
-        if (input_finished) {
-            if (!reserve_waveforms_.empty()) {
-                waves = reserve_waveforms_;
-            }
-            wav_feats = lfr_splice_cache_;
-            if(wav_feats.size() == 0){
-                LOG(ERROR) << "wav_feats's size is 0";
-            }else{
-                OnlineLfrCmvn(wav_feats, input_finished);
+                lfr_splice_cache_.AppendRow(fbank_feats_.Row(0));
             }
         }
+        lfr_splice_cache_.AppendRows(fbank_feats_, 0, fbank_feats_.NumRows());
+    }
+    if (lfr_splice_cache_.NumRows() >= lfr_m || (input_finished && !lfr_splice_cache_.Empty())) {
+        OnlineLfrCmvn(wav_feats, input_finished);
+    } else if (input_finished) {
+        LOG(ERROR) << "wav_feats's size is 0";
     }
     if(input_finished){
         ResetCache();
     }
 }
 
-int ParaformerOnline::OnlineLfrCmvn(vector<vector<float>> &wav_feats, bool input_finished) {
-    vector<vector<float>> out_feats;
-    int T = wav_feats.size();
+// Consumes the frames in lfr_splice_cache_ and keeps the ones needed by the next chunk
+int ParaformerOnline::OnlineLfrCmvn(FeatureMatrix &wav_feats, bool input_finished) {
+    const FeatureMatrix &in_feats = lfr_splice_cache_;
+    int T = in_feats.NumRows();
     int T_lrf = ceil((T - (lfr_m - 1) / 2) / (float)lfr_n);
-    int lfr_splice_frame_idxs = T_lrf;
-    vector<float> p;
-    for (int i = 0; i < T_lrf; i++) {
-        if (lfr_m <= T - i * lfr_n) {
-            for (int j = 0; j < lfr_m; j++) {
-                p.insert(p.end(), wav_feats[i * lfr_n + j].begin(), wav_feats[i * lfr_n + j].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        } else {
-            if (input_finished) {
-                int num_padding = lfr_m - (T - i * lfr_n);
-                for (int j = 0; j < (wav_feats.size() - i * lfr_n); j++) {
-                    p.insert(p.end(), wav_feats[i * lfr_n + j].begin(), wav_feats[i * lfr_n + j].end());
-                }
-                for (int j = 0; j < num_padding; j++) {
-                    p.insert(p.end(), wav_feats[wav_feats.size() - 1].begin(), wav_feats[wav_feats.size() - 1].end());
-                }
-                out_feats.emplace_back(p);
-                p.clear();
-            } else {
-                lfr_splice_frame_idxs = i;
-                break;
-            }
-        }
+    // without input_finished, only the windows with lfr_m real frames are output
+    int num_out = T_lrf;
+    if (!input_finished) {
+        num_out = T >= lfr_m ? std::min(T_lrf, (T - lfr_m) / lfr_n + 1) : 0;
     }
-    lfr_splice_frame_idxs = std::min(T - 1, lfr_splice_frame_idxs * lfr_n);
-    lfr_splice_cache_.clear();
-    lfr_splice_cache_.insert(lfr_splice_cache_.begin(), wav_feats.begin() + lfr_splice_frame_idxs, wav_feats.end());
-
-    // Apply cmvn
-    for (auto &out_feat: out_feats) {
-        for (int j = 0; j < means_list_.size(); j++) {
-            out_feat[j] = (out_feat[j] + means_list_[j]) * vars_list_[j];
-        }
-    }
-    wav_feats = out_feats;
+    wav_feats.Resize(num_out, lfr_m * in_feats.NumCols());
+    // the left padding is already in lfr_splice_cache_
+    ApplyLfrCmvn(in_feats.Data(), T, in_feats.NumCols(), lfr_m, lfr_n, 0,
+                 means_list_, vars_list_, wav_feats.Data(), num_out);
+
+    int lfr_splice_frame_idxs = std::min(T - 1, num_out * lfr_n);
+    lfr_splice_cache_.EraseFront(lfr_splice_frame_idxs);
     return lfr_splice_frame_idxs;
 }
 
-void ParaformerOnline::GetPosEmb(std::vector<std::vector<float>> &wav_feats, int timesteps, int feat_dim)
+void ParaformerOnline::GetPosEmb(FeatureMatrix &wav_feats, int timesteps, int feat_dim)
 {
-    int start_idx = start_idx_cache_;
-    start_idx_cache_ += timesteps;
-    int mm = start_idx_cache_;
-
-    int i;
-    float scale = -0.0330119726594128;
-
-    std::vector<float> tmp(mm*feat_dim);
-
-    for (i = 0; i < feat_dim/2; i++) {
-        float tmptime = exp(i * scale);
-        int j;
-        for (j = 0; j < mm; j++) {
-            int sin_idx = j * feat_dim + i;
-            int cos_idx = j * feat_dim + i + feat_dim/2;
-            float coe = tmptime * (j + 1);
-            tmp[sin_idx] = sin(coe);
-            tmp[cos_idx] = cos(coe);
-        }
-    }
-
-    for (i = start_idx; i < start_idx + timesteps; i++) {
-        for (int j = 0; j < feat_dim; j++) {
-            wav_feats[i-start_idx][j] += tmp[i*feat_dim+j];
-        }
+    if (!pos_emb_table_ || pos_emb_table_->FeatDim() != feat_dim) {
+        pos_emb_table_ = PosEmbTable::GetInstance(feat_dim);
     }
+    pos_emb_table_->AddTo(wav_feats.Data(), start_idx_cache_, timesteps);
+    start_idx_cache_ += timesteps;
 }
 
-void ParaformerOnline::CifSearch(std::vector<std::vector<float>> hidden, std::vector<float> alphas, bool is_final, std::vector<std::vector<float>>& list_frame)
+// Integrates the encoder frames in place, frame i is hidden + i*hidden_stride. The
+// fired tokens are the first rows of cif_embeds_, the row after them holds the
+// token that is still open. Returns the number of fired tokens.
+int ParaformerOnline::CifSearch(const float *hidden, int64_t hidden_stride, const float *alphas, int num_frames,
+                                int hidden_size, bool is_final)
 {
+    int num_tokens = 0;
     try{
-        int hidden_size = 0;
-        if(hidden.size() > 0){
-            hidden_size = hidden[0].size();
-        }
-        // cache
-        int i,j;
-        int chunk_size_pre = chunk_size[0];
-        for (i = 0; i < chunk_size_pre; i++)
-            alphas[i] = 0.0;
-
-        int chunk_size_suf = std::accumulate(chunk_size.begin(), chunk_size.end()-1, 0);
-        for (i = chunk_size_suf; i < alphas.size(); i++){
-            alphas[i] = 0.0;
-        }
-
-        if(hidden_cache_.size()>0){
-            hidden.insert(hidden.begin(), hidden_cache_.begin(), hidden_cache_.end());
-            alphas.insert(alphas.begin(), alphas_cache_.begin(), alphas_cache_.end());
-            hidden_cache_.clear();
-            alphas_cache_.clear();
-        }
-        
-        if (is_last_chunk) {
-            std::vector<float> tail_hidden(hidden_size, 0);
-            hidden.emplace_back(tail_hidden);
-            alphas.emplace_back(tail_alphas);
-        }
-
+        // the cached frame, the chunk and the tail fire at most one token each
+        cif_embeds_.resize((size_t)(num_frames + 3) * hidden_size);
+        std::fill(cif_embeds_.begin(), cif_embeds_.begin() + hidden_size, 0.0f);
         float intergrate = 0.0;
-        int len_time = alphas.size();
-        std::vector<float> frames(hidden_size, 0);
-        std::vector<float> list_fire;
-
-        for (i = 0; i < len_time; i++) {
-            float alpha = alphas[i];
+        auto step = [&](const float *frame, float alpha) {
+            float *token = cif_embeds_.data() + (size_t)num_tokens * hidden_size;
             if (alpha + intergrate < cif_threshold) {
                 intergrate += alpha;
-                list_fire.emplace_back(intergrate);
-                for (j = 0; j < hidden_size; j++) {
-                    frames[j] += alpha * hidden[i][j];
-                }
+                CifAccumulate(frame, alpha, token, hidden_size);
             } else {
-                for (j = 0; j < hidden_size; j++) {
-                    frames[j] += (cif_threshold - intergrate) * hidden[i][j];
-                }
-                std::vector<float> frames_cp(frames);
-                list_frame.emplace_back(frames_cp);
+                CifAccumulate(frame, cif_threshold - intergrate, token, hidden_size);
+                num_tokens++;
                 intergrate += alpha;
-                list_fire.emplace_back(intergrate);
                 intergrate -= cif_threshold;
-                for (j = 0; j < hidden_size; j++) {
-                    frames[j] = intergrate * hidden[i][j];
-                }
+                CifScale(frame, intergrate, token + hidden_size, hidden_size);
             }
+        };
+
+        // cache
+        step(cif_hidden_cache_.data(), cif_alpha_cache_);
+        // the overlapped frames of the chunk do not fire
+        int chunk_size_pre = chunk_size[0];
+        int chunk_size_suf = std::accumulate(chunk_size.begin(), chunk_size.end()-1, 0);
+        for (int i = 0; i < num_frames; i++) {
+            float alpha = (i < chunk_size_pre || i >= chunk_size_suf) ? 0.0f : alphas[i];
+            step(hidden + i * hidden_stride, alpha);
+        }
+        if (is_last_chunk) {
+            std::vector<float> tail_hidden(hidden_size, 0);
+            step(tail_hidden.data(), tail_alphas);
         }
 
         // cache
-        alphas_cache_.emplace_back(intergrate);
+        const float *frames = cif_embeds_.data() + (size_t)num_tokens * hidden_size;
+        cif_alpha_cache_ = intergrate;
+        cif_hidden_cache_.resize(hidden_size);
         if (intergrate > 0.0) {
-            std::vector<float> hidden_cache(hidden_size, 0);
-            for (i = 0; i < hidden_size; i++) {
-                hidden_cache[i] = frames[i] / intergrate;
+            for (int i = 0; i < hidden_size; i++) {
+                cif_hidden_cache_[i] = frames[i] / intergrate;
             }
-            hidden_cache_.emplace_back(hidden_cache);
         } else {
-            std::vector<float> frames_cp(frames);
-            hidden_cache_.emplace_back(frames_cp);
+            std::copy(frames, frames + hidden_size, cif_hidden_cache_.begin());
         }
     }catch (std::exception const &e)
     {
         LOG(ERROR)<<e.what();
     }
+    return num_tokens;
 }
 
 void ParaformerOnline::InitCache(){
@@ -349,38 +267,20 @@ void ParaformerOnline::InitCache(){
     start_idx_cache_ = 0;
     is_first_chunk = true;
     is_last_chunk = false;
-    hidden_cache_.clear();
-    alphas_cache_.clear();
-    feats_cache_.clear();
-    decoder_onnx.clear();
 
     // cif cache
-    std::vector<float> hidden_cache(encoder_size, 0);
-    hidden_cache_.emplace_back(hidden_cache);
-    alphas_cache_.emplace_back(0);
+    cif_hidden_cache_.assign(encoder_size, 0);
+    cif_alpha_cache_ = 0;
 
     // feats
-    std::vector<float> feat_cache(feat_dims, 0);
-    for(int i=0; i<(chunk_size[0]+chunk_size[2]); i++){
-        feats_cache_.emplace_back(feat_cache);
-    }
+    feats_cache_.Resize(chunk_size[0]+chunk_size[2], feat_dims);
+    feats_cache_.Zeros();
 
     // fsmn cache
-#ifdef _WIN_X86
-    Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
-#else
-    Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-#endif
-    const int64_t fsmn_shape_[3] = {1, fsmn_dims, fsmn_lorder};
-    for(int l=0; l<fsmn_layers; l++){
-        Ort::Value onnx_fsmn_cache = Ort::Value::CreateTensor<float>(
-            m_memoryInfo,
-            fsmn_init_cache_.data(),
-            fsmn_init_cache_.size(),
-            fsmn_shape_,
-            3);
-        decoder_onnx.emplace_back(std::move(onnx_fsmn_cache));
+    for (auto &cache : fsmn_cache_) {
+        cache.assign((size_t)fsmn_layers * fsmn_dims * fsmn_lorder, 0);
     }
+    fsmn_cur_ = 0;
 };
 
 void ParaformerOnline::Reset()
@@ -389,34 +289,47 @@ void ParaformerOnline::Reset()
 }
 
 void ParaformerOnline::ResetCache() {
-    reserve_waveforms_.clear();
-    input_cache_.clear();
-    lfr_splice_cache_.clear();
+    lfr_splice_cache_.Clear();
+    fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts_);
+    fbank_frames_ = 0;
 }
 
-void ParaformerOnline::AddOverlapChunk(std::vector<std::vector<float>> &wav_feats, bool input_finished){
-    wav_feats.insert(wav_feats.begin(), feats_cache_.begin(), feats_cache_.end());
+// chunk_feats = feats_cache_ + wav_feats[start, end)
+void ParaformerOnline::AddOverlapChunk(const FeatureMatrix &wav_feats, int start, int end, FeatureMatrix &chunk_feats, bool input_finished){
+    chunk_feats.CopyFrom(feats_cache_);
+    chunk_feats.AppendRows(wav_feats, start, end);
+    int num_rows = chunk_feats.NumRows();
+    feats_cache_.Clear();
     if(input_finished){
-        feats_cache_.clear();
-        feats_cache_.insert(feats_cache_.begin(), wav_feats.end()-chunk_size[0], wav_feats.end());
+        feats_cache_.AppendRows(chunk_feats, num_rows-chunk_size[0], num_rows);
         if(!is_last_chunk){
-            int padding_length = std::accumulate(chunk_size.begin(), chunk_size.end(), 0) - wav_feats.size();
-            std::vector<float> tmp(feat_dims, 0);
+            int padding_length = std::accumulate(chunk_size.begin(), chunk_size.end(), 0) - num_rows;
             for(int i=0; i<padding_length; i++){
-                wav_feats.emplace_back(feat_dims);
+                memset(chunk_feats.AppendRow(), 0, feat_dims * sizeof(float));
             }
         }
     }else{
-        feats_cache_.clear();
-        feats_cache_.insert(feats_cache_.begin(), wav_feats.end()-chunk_size[0]-chunk_size[2], wav_feats.end());        
+        feats_cache_.AppendRows(chunk_feats, num_rows-chunk_size[0]-chunk_size[2], num_rows);
+    }
+}
+
+// Streams sharing the offline model run their chunks as one batch when online batching is on
+std::vector<Ort::Value> ParaformerOnline::RunSession(Ort::Session *session, vector<const char*> &input_names,
+                                                     std::vector<Ort::Value> &inputs, vector<const char*> &output_names)
+{
+    if (online_batcher_) {
+        return online_batcher_->Run(session, input_names.data(), inputs.data(), inputs.size(),
+                                    output_names.data(), output_names.size());
     }
+    return session->Run(Ort::RunOptions{nullptr}, input_names.data(), inputs.data(), inputs.size(),
+                        output_names.data(), output_names.size());
 }
 
-string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_feats, bool input_finished)
+string ParaformerOnline::ForwardChunk(FeatureMatrix &chunk_feats, bool input_finished)
 {
     string result;
     try{
-        int32_t num_frames = chunk_feats.size();
+        int32_t num_frames = chunk_feats.NumRows();
 
     #ifdef _WIN_X86
             Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
@@ -424,14 +337,10 @@ string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_fea
             Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
     #endif
         const int64_t input_shape_[3] = {1, num_frames, feat_dims};
-        std::vector<float> wav_feats;
-        for (const auto &chunk_feat: chunk_feats) {
-            wav_feats.insert(wav_feats.end(), chunk_feat.begin(), chunk_feat.end());
-        }
         Ort::Value onnx_feats = Ort::Value::CreateTensor<float>(
             m_memoryInfo,
-            wav_feats.data(),
-            wav_feats.size(),
+            chunk_feats.Data(),
+            chunk_feats.Size(),
             input_shape_,
             3);
 
@@ -445,74 +354,98 @@ string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_fea
         input_onnx.emplace_back(std::move(onnx_feats));
         input_onnx.emplace_back(std::move(onnx_feats_len)); 
         
-        auto encoder_tensor = encoder_session_->Run(Ort::RunOptions{nullptr}, en_szInputNames_.data(), input_onnx.data(), input_onnx.size(), en_szOutputNames_.data(), en_szOutputNames_.size());
-
-        // get enc_vec
-        std::vector<int64_t> enc_shape = encoder_tensor[0].GetTensorTypeAndShapeInfo().GetShape();
-        float* enc_data = encoder_tensor[0].GetTensorMutableData<float>();
-        std::vector<std::vector<float>> enc_vec(enc_shape[1], std::vector<float>(enc_shape[2]));
-        for (int i = 0; i < enc_shape[1]; i++) {
-            for (int j = 0; j < enc_shape[2]; j++) {
-                enc_vec[i][j] = enc_data[i * enc_shape[2] + j];
+        // the outputs of the bindings stay valid until their next run
+        std::vector<Ort::Value> encoder_tensor;
+        Ort::Value *enc = nullptr;
+        Ort::Value *enc_lens = nullptr;
+        Ort::Value *alphas = nullptr;
+        if (encoder_binding_) {
+            for (int i = 0; i < input_onnx.size(); i++) {
+                encoder_binding_->BindInput(i, input_onnx[i]);
             }
+            encoder_binding_->Run(num_frames);
+            enc = &encoder_binding_->Output(0);
+            enc_lens = &encoder_binding_->Output(1);
+            alphas = &encoder_binding_->Output(2);
+        } else {
+            encoder_tensor = RunSession(encoder_session_.get(), en_szInputNames_, input_onnx, en_szOutputNames_);
+            enc = &encoder_tensor[0];
+            enc_lens = &encoder_tensor[1];
+            alphas = &encoder_tensor[2];
         }
 
-        // get alpha_vec
-        std::vector<int64_t> alpha_shape = encoder_tensor[2].GetTensorTypeAndShapeInfo().GetShape();
-        float* alpha_data = encoder_tensor[2].GetTensorMutableData<float>();
-        std::vector<float> alpha_vec(alpha_shape[1]);
-        for (int i = 0; i < alpha_shape[1]; i++) {
-            alpha_vec[i] = alpha_data[i];
-        } 
+        // cif reads the encoder output in place
+        std::vector<int64_t> enc_shape = enc->GetTensorTypeAndShapeInfo().GetShape();
+        const float* enc_data = enc->GetTensorData<float>();
+        std::vector<int64_t> alpha_shape = alphas->GetTensorTypeAndShapeInfo().GetShape();
+        const float* alpha_data = alphas->GetTensorData<float>();
+        int cif_frames = std::min(enc_shape[1], alpha_shape[1]);
+        int num_tokens = CifSearch(enc_data, enc_shape[2], alpha_data, cif_frames, enc_shape[2], input_finished);
 
-        std::vector<std::vector<float>> list_frame;
-        CifSearch(enc_vec, alpha_vec, input_finished, list_frame);
+        if(num_tokens>0){
+            // acoustic_embeds, acoustic_embeds_len and the fsmn caches follow enc and enc_lens
+            std::vector<Ort::Value> decoder_onnx;
 
-        
-        if(list_frame.size()>0){
-            // enc
-            decoder_onnx.insert(decoder_onnx.begin(), std::move(encoder_tensor[0]));
-            // enc_lens
-            decoder_onnx.insert(decoder_onnx.begin()+1, std::move(encoder_tensor[1]));
-
-            // acoustic_embeds
-            const int64_t emb_shape_[3] = {1, (int64_t)list_frame.size(), (int64_t)list_frame[0].size()};
-            std::vector<float> emb_input;
-            for (const auto &list_frame_: list_frame) {
-                emb_input.insert(emb_input.end(), list_frame_.begin(), list_frame_.end());
-            }
+            // acoustic_embeds, the fired tokens of cif_embeds_
+            const int64_t emb_shape_[3] = {1, num_tokens, enc_shape[2]};
             Ort::Value onnx_emb = Ort::Value::CreateTensor<float>(
                 m_memoryInfo,
-                emb_input.data(),
-                emb_input.size(),
+                cif_embeds_.data(),
+                (size_t)num_tokens * enc_shape[2],
                 emb_shape_,
                 3);
-            decoder_onnx.insert(decoder_onnx.begin()+2, std::move(onnx_emb));
+            decoder_onnx.emplace_back(std::move(onnx_emb));
 
             // acoustic_embeds_len
             const int64_t emb_length_shape[1] = {1};
             std::vector<int32_t> emb_length;
-            emb_length.emplace_back(list_frame.size());
+            emb_length.emplace_back(num_tokens);
             Ort::Value onnx_emb_len = Ort::Value::CreateTensor<int32_t>(
                 m_memoryInfo, emb_length.data(), emb_length.size(), emb_length_shape, 1);
-            decoder_onnx.insert(decoder_onnx.begin()+3, std::move(onnx_emb_len));
-
-            auto decoder_tensor = decoder_session_->Run(Ort::RunOptions{nullptr}, de_szInputNames_.data(), decoder_onnx.data(), decoder_onnx.size(), de_szOutputNames_.data(), de_szOutputNames_.size());
-            // fsmn cache
-            try{
-                decoder_onnx.clear();
-            }catch (std::exception const &e)
-            {
-                LOG(ERROR)<<e.what();
-                return result;
-            }
+            decoder_onnx.emplace_back(std::move(onnx_emb_len));
+
+            // fsmn caches, the next ones are written to the other half of fsmn_cache_
+            const int64_t fsmn_shape_[3] = {1, fsmn_dims, fsmn_lorder};
+            size_t fsmn_size = (size_t)fsmn_dims * fsmn_lorder;
+            float *cur_cache = fsmn_cache_[fsmn_cur_].data();
+            float *next_cache = fsmn_cache_[1 - fsmn_cur_].data();
             for(int l=0;l<fsmn_layers;l++){
-                decoder_onnx.emplace_back(std::move(decoder_tensor[2+l]));
+                decoder_onnx.emplace_back(Ort::Value::CreateTensor<float>(
+                    m_memoryInfo, cur_cache + l * fsmn_size, fsmn_size, fsmn_shape_, 3));
+            }
+
+            std::vector<Ort::Value> decoder_tensor;
+            Ort::Value *logits = nullptr;
+            if (decoder_binding_) {
+                std::vector<Ort::Value> cache_outputs;
+                for(int l=0;l<fsmn_layers;l++){
+                    cache_outputs.emplace_back(Ort::Value::CreateTensor<float>(
+                        m_memoryInfo, next_cache + l * fsmn_size, fsmn_size, fsmn_shape_, 3));
+                }
+                decoder_binding_->BindInput(0, *enc);
+                decoder_binding_->BindInput(1, *enc_lens);
+                for (int i = 0; i < decoder_onnx.size(); i++) {
+                    decoder_binding_->BindInput(i + 2, decoder_onnx[i]);
+                }
+                for(int l=0;l<fsmn_layers;l++){
+                    decoder_binding_->BindOutput(2 + l, cache_outputs[l]);
+                }
+                decoder_binding_->Run((enc_shape[1] << 32) | num_tokens);
+                logits = &decoder_binding_->Output(0);
+            } else {
+                decoder_onnx.insert(decoder_onnx.begin(), std::move(*enc_lens));
+                decoder_onnx.insert(decoder_onnx.begin(), std::move(*enc));
+                decoder_tensor = RunSession(decoder_session_.get(), de_szInputNames_, decoder_onnx, de_szOutputNames_);
+                for(int l=0;l<fsmn_layers;l++){
+                    memcpy(next_cache + l * fsmn_size, decoder_tensor[2+l].GetTensorData<float>(), fsmn_size * sizeof(float));
+                }
+                logits = &decoder_tensor[0];
             }
+            fsmn_cur_ = 1 - fsmn_cur_;
 
-            std::vector<int64_t> decoder_shape = decoder_tensor[0].GetTensorTypeAndShapeInfo().GetShape();
-            float* float_data = decoder_tensor[0].GetTensorMutableData<float>();
-            result = offline_handle_->GreedySearch(float_data, list_frame.size(), decoder_shape[2]);
+            std::vector<int64_t> decoder_shape = logits->GetTensorTypeAndShapeInfo().GetShape();
+            float* float_data = logits->GetTensorMutableData<float>();
+            result = offline_handle_->GreedySearch(float_data, num_tokens, decoder_shape[2]);
         }
     }catch (std::exception const &e)
     {
@@ -524,15 +457,15 @@ string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_fea
 
 string ParaformerOnline::Forward(float* din, int len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* wfst_decoder)
 {
-    std::vector<std::vector<float>> wav_feats;
+    FeatureMatrix &wav_feats = wav_feats_;
     std::vector<float> waves(din, din+len);
 
     string result="";
     try{
         if(len <16*60 && input_finished && !is_first_chunk){
             is_last_chunk = true;
-            wav_feats = feats_cache_;
-            result = ForwardChunk(wav_feats, is_last_chunk);
+            chunk_feats_.CopyFrom(feats_cache_);
+            result = ForwardChunk(chunk_feats_, is_last_chunk);
             // reset
             ResetCache();
             Reset();
@@ -542,34 +475,30 @@ string ParaformerOnline::Forward(float* din, int len, bool input_finished, const
             is_first_chunk = false;
         }
         ExtractFeats(offline_handle_->GetAsrSampleRate(), wav_feats, waves, input_finished);
-        if(wav_feats.size() == 0){
+        if(wav_feats.Empty()){
             return result;
         }
         
-        for (auto& row : wav_feats) {
-            for (auto& val : row) {
-                val *= sqrt_factor;
-            }
+        float *feats_data = wav_feats.Data();
+        for (size_t i = 0; i < wav_feats.Size(); i++) {
+            feats_data[i] *= sqrt_factor;
         }
 
-        GetPosEmb(wav_feats, wav_feats.size(), wav_feats[0].size());
+        int num_rows = wav_feats.NumRows();
+        GetPosEmb(wav_feats, num_rows, wav_feats.NumCols());
         if(input_finished){
-            if(wav_feats.size()+chunk_size[2] <= chunk_size[1]){
+            if(num_rows+chunk_size[2] <= chunk_size[1]){
                 is_last_chunk = true;
-                AddOverlapChunk(wav_feats, input_finished);
+                AddOverlapChunk(wav_feats, 0, num_rows, chunk_feats_, input_finished);
             }else{
                 // first chunk
-                std::vector<std::vector<float>> first_chunk;
-                first_chunk.insert(first_chunk.begin(), wav_feats.begin(), wav_feats.end());
-                AddOverlapChunk(first_chunk, input_finished);
-                string str_first_chunk = ForwardChunk(first_chunk, is_last_chunk);
+                AddOverlapChunk(wav_feats, 0, num_rows, chunk_feats_, input_finished);
+                string str_first_chunk = ForwardChunk(chunk_feats_, is_last_chunk);
 
                 // last chunk
                 is_last_chunk = true;
-                std::vector<std::vector<float>> last_chunk;
-                last_chunk.insert(last_chunk.begin(), wav_feats.end()-(wav_feats.size()+chunk_size[2]-chunk_size[1]), wav_feats.end());
-                AddOverlapChunk(last_chunk, input_finished);
-                string str_last_chunk = ForwardChunk(last_chunk, is_last_chunk);
+                AddOverlapChunk(wav_feats, num_rows-(num_rows+chunk_size[2]-chunk_size[1]), num_rows, chunk_feats_, input_finished);
+                string str_last_chunk = ForwardChunk(chunk_feats_, is_last_chunk);
 
                 result = str_first_chunk+str_last_chunk;
                 // reset
@@ -578,10 +507,10 @@ string ParaformerOnline::Forward(float* din, int len, bool input_finished, const
                 return result;
             }
         }else{
-            AddOverlapChunk(wav_feats, input_finished);
+            AddOverlapChunk(wav_feats, 0, num_rows, chunk_feats_, input_finished);
         }
 
-        result = ForwardChunk(wav_feats, is_last_chunk);
+        result = ForwardChunk(chunk_feats_, is_last_chunk);
         if(input_finished){
             // reset
             ResetCache();
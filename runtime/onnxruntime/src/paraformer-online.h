@@ -16,23 +16,18 @@ namespace funasr {
     */
     private:
 
-        void FbankKaldi(float sample_rate, std::vector<std::vector<float>> &wav_feats,
-                std::vector<float> &waves);
-        int OnlineLfrCmvn(vector<vector<float>> &wav_feats, bool input_finished);
-        void GetPosEmb(std::vector<std::vector<float>> &wav_feats, int timesteps, int feat_dim);
-        void CifSearch(std::vector<std::vector<float>> hidden, std::vector<float> alphas, bool is_final, std::vector<std::vector<float>> &list_frame);
+        void FbankKaldi(float sample_rate, FeatureMatrix &wav_feats,
+                const float *waves, int len, bool input_finished);
+        int OnlineLfrCmvn(FeatureMatrix &wav_feats, bool input_finished);
+        void GetPosEmb(FeatureMatrix &wav_feats, int timesteps, int feat_dim);
+        int CifSearch(const float *hidden, int64_t hidden_stride, const float *alphas, int num_frames,
+                      int hidden_size, bool is_final);
 
-        static int ComputeFrameNum(int sample_length, int frame_sample_length, int frame_shift_sample_length) {
-            int frame_num = static_cast<int>((sample_length - frame_sample_length) / frame_shift_sample_length + 1);
-            if (frame_num >= 1 && sample_length >= frame_sample_length)
-                return frame_num;
-            else
-                return 0;
-        }
         void InitOnline(
             knf::FbankOptions &fbank_opts,
             std::shared_ptr<Ort::Session> &encoder_session,
             std::shared_ptr<Ort::Session> &decoder_session,
+            std::shared_ptr<SessionBatcher> &online_batcher,
             vector<const char*> &en_szInputNames,
             vector<const char*> &en_szOutputNames,
             vector<const char*> &de_szInputNames,
@@ -50,6 +45,8 @@ namespace funasr {
             int fsmn_dims_,
             float cif_threshold_,
             float tail_alphas_);
+        std::vector<Ort::Value> RunSession(Ort::Session *session, vector<const char*> &input_names,
+                                           std::vector<Ort::Value> &inputs, vector<const char*> &output_names);
 
         void StartUtterance()
         {
@@ -64,6 +61,7 @@ namespace funasr {
         knf::FbankOptions fbank_opts_;
         std::shared_ptr<Ort::Session> encoder_session_ = nullptr;
         std::shared_ptr<Ort::Session> decoder_session_ = nullptr;
+        std::shared_ptr<SessionBatcher> online_batcher_ = nullptr;
         Ort::SessionOptions session_options_;
         vector<const char*> en_szInputNames_;
         vector<const char*> en_szOutputNames_;
@@ -90,21 +88,34 @@ namespace funasr {
         int frame_sample_length_ = MODEL_SAMPLE_RATE / 1000 * frame_length;
         int frame_shift_sample_length_ = MODEL_SAMPLE_RATE / 1000 * frame_shift;
 
-        // The reserved waveforms by fbank
-        std::vector<float> reserve_waveforms_;
-        // waveforms reserved after last shift position
-        std::vector<float> input_cache_;
-        // lfr reserved cache
-        std::vector<std::vector<float>> lfr_splice_cache_;
+        // fbank state kept for the whole utterance, only new samples are fed to it
+        std::unique_ptr<knf::OnlineFbank> fbank_ = nullptr;
+        // number of frames already read from fbank_
+        int32_t fbank_frames_ = 0;
+        std::vector<float> fbank_buf_;
+        // lfr reserved cache, new fbank frames are appended to it before lfr
+        FeatureMatrix lfr_splice_cache_;
         // position index cache
         int start_idx_cache_ = 0;
-        // cif alpha
-        std::vector<float> alphas_cache_;
-        std::vector<std::vector<float>> hidden_cache_;
-        std::vector<std::vector<float>> feats_cache_;
-        // fsmn init caches
-        std::vector<float> fsmn_init_cache_;
-        std::vector<Ort::Value> decoder_onnx;
+        // shared by the online sessions of the same feat dim
+        std::shared_ptr<PosEmbTable> pos_emb_table_ = nullptr;
+        // cif state carried to the next chunk: the open token scaled to weight 1 and its weight
+        float cif_alpha_cache_ = 0;
+        std::vector<float> cif_hidden_cache_;
+        // fired tokens of the chunk, the acoustic_embeds input of the decoder
+        std::vector<float> cif_embeds_;
+        FeatureMatrix feats_cache_;
+        // per-chunk scratch, reused to avoid reallocation
+        FeatureMatrix fbank_feats_;
+        FeatureMatrix wav_feats_;
+        FeatureMatrix chunk_feats_;
+        // fsmn caches of the decoder, fsmn_cache_[fsmn_cur_] is the input of the
+        // next chunk and the decoder writes its new caches to the other one
+        std::vector<float> fsmn_cache_[2];
+        int fsmn_cur_ = 0;
+        // reused onnx outputs, null when online_batcher_ is used
+        std::unique_ptr<OrtBinding> encoder_binding_ = nullptr;
+        std::unique_ptr<OrtBinding> decoder_binding_ = nullptr;
 
         bool is_first_chunk = true;
         bool is_last_chunk = false;
@@ -116,10 +127,10 @@ namespace funasr {
         void Reset();
         void ResetCache();
         void InitCache();
-        void ExtractFeats(float sample_rate, vector<vector<float>> &wav_feats, vector<float> &waves, bool input_finished);
-        void AddOverlapChunk(std::vector<std::vector<float>> &wav_feats, bool input_finished);
+        void ExtractFeats(float sample_rate, FeatureMatrix &wav_feats, vector<float> &waves, bool input_finished);
+        void AddOverlapChunk(const FeatureMatrix &wav_feats, int start, int end, FeatureMatrix &chunk_feats, bool input_finished);
         
-        string ForwardChunk(std::vector<std::vector<float>> &wav_feats, bool input_finished);
+        string ForwardChunk(FeatureMatrix &chunk_feats, bool input_finished);
         string Forward(float* din, int len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr);
         string Rescoring();
 
@@ -68,8 +68,7 @@ void ParaformerTorch::InitLm(const std::string &lm_file,
                         const std::string &lm_cfg_file, 
                         const std::string &lex_file) {
     try {
-        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(
-            fst::Fst<fst::StdArc>::Read(lm_file));
+        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(ReadFst(lm_file));
         if (lm_){
             lm_vocab = new Vocab(lm_cfg_file.c_str(), lex_file.c_str());
             LOG(INFO) << "Successfully load lm file " << lm_file;
@@ -298,7 +297,8 @@ void ParaformerTorch::LfrCmvn(std::vector<std::vector<float>> &asr_feats) {
     asr_feats = out_feats;
 }
 
-std::vector<std::string> ParaformerTorch::Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in)
+std::vector<std::string> ParaformerTorch::Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in,
+    const FbankCache *fbank_cache)
 {
     vector<std::string> results;
     string result="";
@@ -313,7 +313,15 @@ std::vector<std::string> ParaformerTorch::Forward(float** din, int* len, bool in
     int max_frames = 0;
     for(int index=0; index<batch_in; index++){
         std::vector<std::vector<float>> asr_feats;
-        FbankKaldi(asr_sample_rate, din[index], len[index], asr_feats);
+        int32_t cached_frames = 0;
+        const float *cached = fbank_cache ? fbank_cache->GetSegment(fbank_opts_, din[index], len[index], cached_frames) : nullptr;
+        if(cached != nullptr){
+            for(int32_t i = 0; i < cached_frames; i++){
+                asr_feats.emplace_back(cached + (size_t)i * in_feat_dim, cached + (size_t)(i + 1) * in_feat_dim);
+            }
+        }else{
+            FbankKaldi(asr_sample_rate, din[index], len[index], asr_feats);
+        }
         if(asr_feats.size() != 0){
             LfrCmvn(asr_feats);
         }
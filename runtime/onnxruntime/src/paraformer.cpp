@@ -13,8 +13,8 @@ namespace funasr {
 
 Paraformer::Paraformer()
 :use_hotword(false),
- env_(ORT_LOGGING_LEVEL_ERROR, "paraformer"),session_options_{},
- hw_env_(ORT_LOGGING_LEVEL_ERROR, "paraformer_hw"),hw_session_options{} {
+ session_options_{},
+ hw_session_options{} {
 }
 
 // offline
@@ -32,13 +32,13 @@ void Paraformer::InitAsr(const std::string &am_model, const std::string &am_cmvn
     // fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts);
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
 
     try {
-        m_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(am_model).c_str(), session_options_);
+        m_session_ = ModelRegistry::GetSession(am_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << am_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am onnx model: " << e.what();
@@ -47,8 +47,8 @@ void Paraformer::InitAsr(const std::string &am_model, const std::string &am_cmvn
 
     GetInputNames(m_session_.get(), m_strInputNames, m_szInputNames);
     GetOutputNames(m_session_.get(), m_strOutputNames, m_szOutputNames);
-    vocab = new Vocab(token_file.c_str());
-	phone_set_ = new PhoneSet(token_file.c_str());
+    vocab = ModelRegistry::GetVocab(token_file);
+	phone_set_ = ModelRegistry::GetPhoneSet(token_file);
     LoadCmvn(am_cmvn.c_str());
 }
 
@@ -67,13 +67,13 @@ void Paraformer::InitAsr(const std::string &en_model, const std::string &de_mode
     fbank_opts_.mel_opts.debug_mel = false;
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
 
     try {
-        encoder_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(en_model).c_str(), session_options_);
+        encoder_session_ = ModelRegistry::GetSession(en_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << en_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am encoder model: " << e.what();
@@ -81,7 +81,7 @@ void Paraformer::InitAsr(const std::string &en_model, const std::string &de_mode
     }
 
     try {
-        decoder_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(de_model).c_str(), session_options_);
+        decoder_session_ = ModelRegistry::GetSession(de_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << de_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am decoder model: " << e.what();
@@ -125,8 +125,8 @@ void Paraformer::InitAsr(const std::string &en_model, const std::string &de_mode
     for (auto& item : de_strOutputNames)
         de_szOutputNames_.push_back(item.c_str());
 
-    vocab = new Vocab(token_file.c_str());
-    phone_set_ = new PhoneSet(token_file.c_str());
+    vocab = ModelRegistry::GetVocab(token_file);
+    phone_set_ = ModelRegistry::GetPhoneSet(token_file);
     LoadCmvn(am_cmvn.c_str());
 }
 
@@ -138,7 +138,7 @@ void Paraformer::InitAsr(const std::string &am_model, const std::string &en_mode
 
     // offline
     try {
-        m_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(am_model).c_str(), session_options_);
+        m_session_ = ModelRegistry::GetSession(am_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << am_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am onnx model: " << e.what();
@@ -153,10 +153,11 @@ void Paraformer::InitLm(const std::string &lm_file,
                         const std::string &lm_cfg_file, 
                         const std::string &lex_file) {
     try {
-        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(
-            fst::Fst<fst::StdArc>::Read(lm_file));
+        lm_ = ModelRegistry::Get<fst::Fst<fst::StdArc>>(lm_file, [&]() {
+            return ReadFst(lm_file);
+        });
         if (lm_){
-            lm_vocab = new Vocab(lm_cfg_file.c_str(), lex_file.c_str());
+            lm_vocab = ModelRegistry::GetVocab(lm_cfg_file, lex_file);
             LOG(INFO) << "Successfully load lm file " << lm_file;
         }else{
             LOG(ERROR) << "Failed to load lm file " << lm_file;
@@ -171,7 +172,7 @@ void Paraformer::LoadConfigFromYaml(const char* filename){
 
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(ERROR) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -195,7 +196,7 @@ void Paraformer::LoadOnlineConfigFromYaml(const char* filename){
 
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(ERROR) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -233,13 +234,13 @@ void Paraformer::LoadOnlineConfigFromYaml(const char* filename){
 }
 
 void Paraformer::InitHwCompiler(const std::string &hw_model, int thread_num) {
-    hw_session_options.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(hw_session_options, thread_num);
     hw_session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     hw_session_options.DisableCpuMemArena();
 
     try {
-        hw_m_session = std::make_unique<Ort::Session>(hw_env_, ORTSTRING(hw_model).c_str(), hw_session_options);
+        hw_m_session = ModelRegistry::GetSession(hw_model, hw_session_options, thread_num);
         LOG(INFO) << "Successfully load model from " << hw_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load hw compiler onnx model: " << e.what();
@@ -264,23 +265,11 @@ void Paraformer::InitHwCompiler(const std::string &hw_model, int thread_num) {
 }
 
 void Paraformer::InitSegDict(const std::string &seg_dict_model) {
-    seg_dict = new SegDict(seg_dict_model.c_str());
+    seg_dict = ModelRegistry::GetSegDict(seg_dict_model);
 }
 
 Paraformer::~Paraformer()
 {
-    if(vocab){
-        delete vocab;
-    }
-    if(lm_vocab){
-        delete lm_vocab;
-    }
-    if(seg_dict){
-        delete seg_dict;
-    }
-    if(phone_set_){
-        delete phone_set_;
-    }
 }
 
 void Paraformer::StartUtterance()
@@ -295,7 +284,18 @@ void Paraformer::Reset()
 {
 }
 
-void Paraformer::FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats) {
+void Paraformer::SetOnlineBatch(int batch_size, int max_wait_us)
+{
+    // online streams take the batcher when they are created
+    if (batch_size > 1) {
+        online_batcher_ = std::make_shared<SessionBatcher>(
+            batch_size, max_wait_us, std::vector<Ort::Session*>{encoder_session_.get(), decoder_session_.get()});
+    } else {
+        online_batcher_ = nullptr;
+    }
+}
+
+void Paraformer::FbankKaldi(float sample_rate, const float* waves, int len, FeatureMatrix &asr_feats) {
     knf::OnlineFbank fbank_(fbank_opts_);
     std::vector<float> buf(len);
     for (int32_t i = 0; i != len; ++i) {
@@ -304,47 +304,20 @@ void Paraformer::FbankKaldi(float sample_rate, const float* waves, int len, std:
     fbank_.AcceptWaveform(sample_rate, buf.data(), buf.size());
 
     int32_t frames = fbank_.NumFramesReady();
+    int32_t num_bins = fbank_opts_.mel_opts.num_bins;
+    asr_feats.Resize(frames, num_bins);
     for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank_.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        asr_feats.emplace_back(frame_vector);
+        memcpy(asr_feats.Row(i), fbank_.GetFrame(i), num_bins * sizeof(float));
     }
 }
 
 void Paraformer::LoadCmvn(const char *filename)
 {
-    ifstream cmvn_stream(filename);
-    if (!cmvn_stream.is_open()) {
-        LOG(ERROR) << "Failed to open file: " << filename;
+    if (!ModelCache::LoadCmvn(filename, means_list_, vars_list_)) {
         exit(-1);
     }
-    string line;
-
-    while (getline(cmvn_stream, line)) {
-        istringstream iss(line);
-        vector<string> line_item{istream_iterator<string>{iss}, istream_iterator<string>{}};
-        if (line_item[0] == "<AddShift>") {
-            getline(cmvn_stream, line);
-            istringstream means_lines_stream(line);
-            vector<string> means_lines{istream_iterator<string>{means_lines_stream}, istream_iterator<string>{}};
-            if (means_lines[0] == "<LearnRateCoef>") {
-                for (int j = 3; j < means_lines.size() - 1; j++) {
-                    means_list_.push_back(stof(means_lines[j]));
-                }
-                continue;
-            }
-        }
-        else if (line_item[0] == "<Rescale>") {
-            getline(cmvn_stream, line);
-            istringstream vars_lines_stream(line);
-            vector<string> vars_lines{istream_iterator<string>{vars_lines_stream}, istream_iterator<string>{}};
-            if (vars_lines[0] == "<LearnRateCoef>") {
-                for (int j = 3; j < vars_lines.size() - 1; j++) {
-                    vars_list_.push_back(stof(vars_lines[j])*scale);
-                }
-                continue;
-            }
-        }
+    for (auto &var : vars_list_) {
+        var *= scale;
     }
 }
 
@@ -383,74 +356,89 @@ string Paraformer::FinalizeDecode(WfstDecoder* &wfst_decoder,
   return wfst_decoder->FinalizeDecode(is_stamp, us_alphas, us_cif_peak);
 }
 
-void Paraformer::LfrCmvn(std::vector<std::vector<float>> &asr_feats) {
+// Writes LfrFrames(T) rows of lfr_m*num_bins floats to out_feats
+void Paraformer::LfrCmvn(const float *asr_feats, int T, float *out_feats) {
+    // Pad (lfr_m - 1) / 2 frames at start and fill the last window with the last frame
+    ApplyLfrCmvn(asr_feats, T, fbank_opts_.mel_opts.num_bins, lfr_m, lfr_n, (lfr_m - 1) / 2,
+                 means_list_, vars_list_, out_feats, LfrFrames(T));
+}
 
-    std::vector<std::vector<float>> out_feats;
-    int T = asr_feats.size();
-    int T_lrf = ceil(1.0 * T / lfr_n);
+std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in,
+    const FbankCache *fbank_cache)
+{
+    return Forward(din, len, input_finished, FunHotwordEmbedding::FromRows(hw_emb), decoder_handle, batch_in, fbank_cache);
+}
 
-    // Pad frames at start(copy first frame)
-    for (int i = 0; i < (lfr_m - 1) / 2; i++) {
-        asr_feats.insert(asr_feats.begin(), asr_feats[0]);
-    }
-    // Merge lfr_m frames as one,lfr_n frames per window
-    T = T + (lfr_m - 1) / 2;
-    std::vector<float> p;
-    for (int i = 0; i < T_lrf; i++) {
-        if (lfr_m <= T - i * lfr_n) {
-            for (int j = 0; j < lfr_m; j++) {
-                p.insert(p.end(), asr_feats[i * lfr_n + j].begin(), asr_feats[i * lfr_n + j].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        } else {
-            // Fill to lfr_m frames at last window if less than lfr_m frames  (copy last frame)
-            int num_padding = lfr_m - (T - i * lfr_n);
-            for (int j = 0; j < (asr_feats.size() - i * lfr_n); j++) {
-                p.insert(p.end(), asr_feats[i * lfr_n + j].begin(), asr_feats[i * lfr_n + j].end());
-            }
-            for (int j = 0; j < num_padding; j++) {
-                p.insert(p.end(), asr_feats[asr_feats.size() - 1].begin(), asr_feats[asr_feats.size() - 1].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        }
-    }
-    // Apply cmvn
-    for (auto &out_feat: out_feats) {
-        for (int j = 0; j < means_list_.size(); j++) {
-            out_feat[j] = (out_feat[j] + means_list_[j]) * vars_list_[j];
-        }
+std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb, void* decoder_handle, int batch_in,
+    const FbankCache *fbank_cache)
+{
+    std::vector<WfstDecoder*> wfst_decoders(batch_in, (WfstDecoder*)decoder_handle);
+    return ForwardItems(din, len, input_finished, hw_emb, wfst_decoders, false, fbank_cache);
+}
+
+std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb,
+    const std::vector<void*> &wfst_decoders, const FbankCache *fbank_cache)
+{
+    std::vector<WfstDecoder*> decoders;
+    for (void *decoder_handle : wfst_decoders) {
+        decoders.emplace_back((WfstDecoder*)decoder_handle);
     }
-    asr_feats = out_feats;
+    return ForwardItems(din, len, input_finished, hw_emb, decoders, true, fbank_cache);
 }
 
-std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in)
+std::vector<std::string> Paraformer::ForwardItems(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb,
+    const std::vector<WfstDecoder*> &wfst_decoders, bool own_decoders, const FbankCache *fbank_cache)
 {
-    std::vector<std::string> results;
-    string result="";
-    WfstDecoder* wfst_decoder = (WfstDecoder*)decoder_handle;
+    int batch_in = wfst_decoders.size();
+    std::vector<std::string> results(batch_in, "");
     int32_t in_feat_dim = fbank_opts_.mel_opts.num_bins;
+    int32_t feat_dim = lfr_m*in_feat_dim;
 
-    if(batch_in != 1){
-        results.push_back(result);
-        return results;
+    // items without any fbank frame are left out of the batch and keep an empty result.
+    // fbank rows come from the vad's fbank_cache when it holds the segment,
+    // otherwise they are computed here into fbank_owned
+    std::vector<FeatureMatrix> fbank_owned(batch_in);
+    std::vector<const float*> fbank_batch;
+    std::vector<int32_t> fbank_frames;
+    std::vector<int32_t> paraformer_length;
+    std::vector<int> batch_index;
+    int32_t max_frames = 0;
+    for(int index=0; index<batch_in; index++){
+        int32_t frames = 0;
+        const float *fbank = nullptr;
+        if(fbank_cache){
+            fbank = fbank_cache->GetSegment(fbank_opts_, din[index], len[index], frames);
+        }
+        if(fbank == nullptr){
+            FbankKaldi(asr_sample_rate, din[index], len[index], fbank_owned[index]);
+            fbank = fbank_owned[index].Data();
+            frames = fbank_owned[index].NumRows();
+        }
+        if(frames == 0){
+            continue;
+        }
+        int32_t num_frames = LfrFrames(frames);
+        fbank_batch.emplace_back(fbank);
+        fbank_frames.emplace_back(frames);
+        paraformer_length.emplace_back(num_frames);
+        batch_index.emplace_back(index);
+        max_frames = std::max(max_frames, num_frames);
     }
 
-    std::vector<std::vector<float>> asr_feats;
-    FbankKaldi(asr_sample_rate, din[0], len[0], asr_feats);
-    if(asr_feats.size() == 0){
-        results.push_back(result);
+    int32_t real_batch = batch_index.size();
+    if(real_batch == 0){
         return results;
     }
-    LfrCmvn(asr_feats);
-    int32_t feat_dim = lfr_m*in_feat_dim;
-    int32_t num_frames = asr_feats.size();
 
-    std::vector<float> wav_feats;
-    for (const auto &frame_feat: asr_feats) {
-        wav_feats.insert(wav_feats.end(), frame_feat.begin(), frame_feat.end());
+    // lfr/cmvn writes straight into the padded input, masked by paraformer_length
+    FeatureMatrix wav_feats(real_batch * max_frames, feat_dim);
+    for(int index=0; index<real_batch; index++){
+        float *item_feats = wav_feats.Row(index * max_frames);
+        LfrCmvn(fbank_batch[index], fbank_frames[index], item_feats);
+        memset(item_feats + (size_t)paraformer_length[index] * feat_dim, 0,
+               (size_t)(max_frames - paraformer_length[index]) * feat_dim * sizeof(float));
     }
+    fbank_owned.clear();
 
 #ifdef _WIN_X86
         Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
@@ -458,16 +446,14 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
         Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
 #endif
 
-    const int64_t input_shape_[3] = {1, num_frames, feat_dim};
+    const int64_t input_shape_[3] = {real_batch, max_frames, feat_dim};
     Ort::Value onnx_feats = Ort::Value::CreateTensor<float>(m_memoryInfo,
-        wav_feats.data(),
-        wav_feats.size(),
+        wav_feats.Data(),
+        wav_feats.Size(),
         input_shape_,
         3);
 
-    const int64_t paraformer_length_shape[1] = {1};
-    std::vector<int32_t> paraformer_length;
-    paraformer_length.emplace_back(num_frames);
+    const int64_t paraformer_length_shape[1] = {real_batch};
     Ort::Value onnx_feats_len = Ort::Value::CreateTensor<int32_t>(
           m_memoryInfo, paraformer_length.data(), paraformer_length.size(), paraformer_length_shape, 1);
 
@@ -478,27 +464,32 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
     std::vector<float> embedding;
     try{
         if (use_hotword) {
-            if(hw_emb.size()<=0){
+            if(hw_emb.num_hotwords<=0){
                 LOG(ERROR) << "hw_emb is null";
-                results.push_back(result);
                 return results;
             }
-            //PrintMat(hw_emb, "input_clas_emb");
-            const int64_t hotword_shape[3] = {1, static_cast<int64_t>(hw_emb.size()), static_cast<int64_t>(hw_emb[0].size())};
-            embedding.reserve(hw_emb.size() * hw_emb[0].size());
-            for (auto item : hw_emb) {
-                embedding.insert(embedding.end(), item.begin(), item.end());
+            const int64_t hotword_shape[3] = {real_batch, hw_emb.num_hotwords, hw_emb.dim};
+            // a single item reads the shared embedding in place, the items of
+            // a batch share the same hotword list and get a copy each
+            float *hw_emb_data = const_cast<float*>(hw_emb.data.data());
+            size_t hw_emb_size = hw_emb.data.size();
+            if (real_batch > 1) {
+                embedding.reserve(real_batch * hw_emb.data.size());
+                for (int index = 0; index < real_batch; index++) {
+                    embedding.insert(embedding.end(), hw_emb.data.begin(), hw_emb.data.end());
+                }
+                hw_emb_data = embedding.data();
+                hw_emb_size = embedding.size();
             }
-            //LOG(INFO) << "hotword shape " << hotword_shape[0] << " " << hotword_shape[1] << " " << hotword_shape[2] << " size " << embedding.size();
+            //LOG(INFO) << "hotword shape " << hotword_shape[0] << " " << hotword_shape[1] << " " << hotword_shape[2] << " size " << hw_emb_size;
             Ort::Value onnx_hw_emb = Ort::Value::CreateTensor<float>(
-                m_memoryInfo, embedding.data(), embedding.size(), hotword_shape, 3);
+                m_memoryInfo, hw_emb_data, hw_emb_size, hotword_shape, 3);
 
             input_onnx.emplace_back(std::move(onnx_hw_emb));
         }
     }catch (std::exception const &e)
     {
         LOG(ERROR)<<e.what();
-        results.push_back(result);
         return results;
     }
 
@@ -507,41 +498,61 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
         std::vector<int64_t> outputShape = outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
         //LOG(INFO) << "paraformer out shape " << outputShape[0] << " " << outputShape[1] << " " << outputShape[2];
 
-        int64_t outputCount = std::accumulate(outputShape.begin(), outputShape.end(), 1, std::multiplies<int64_t>());
         float* floatData = outputTensor[0].GetTensorMutableData<float>();
         auto encoder_out_lens = outputTensor[1].GetTensorMutableData<int64_t>();
-        // timestamp
+        int64_t token_stride = outputShape[1] * outputShape[2];
+
+        float* us_alphas_data = nullptr;
+        float* us_peaks_data = nullptr;
+        int64_t us_alphas_stride = 0;
+        int64_t us_peaks_stride = 0;
         if(outputTensor.size() == 4){
             std::vector<int64_t> us_alphas_shape = outputTensor[2].GetTensorTypeAndShapeInfo().GetShape();
-            float* us_alphas_data = outputTensor[2].GetTensorMutableData<float>();
-            std::vector<float> us_alphas(us_alphas_shape[1]);
-            for (int i = 0; i < us_alphas_shape[1]; i++) {
-                us_alphas[i] = us_alphas_data[i];
-            }
-
+            us_alphas_data = outputTensor[2].GetTensorMutableData<float>();
+            us_alphas_stride = us_alphas_shape[1];
             std::vector<int64_t> us_peaks_shape = outputTensor[3].GetTensorTypeAndShapeInfo().GetShape();
-            float* us_peaks_data = outputTensor[3].GetTensorMutableData<float>();
-            std::vector<float> us_peaks(us_peaks_shape[1]);
-            for (int i = 0; i < us_peaks_shape[1]; i++) {
-                us_peaks[i] = us_peaks_data[i];
+            us_peaks_data = outputTensor[3].GetTensorMutableData<float>();
+            us_peaks_stride = us_peaks_shape[1];
+        }
+
+        for(int index=0; index<real_batch; index++){
+            string result="";
+            WfstDecoder* wfst_decoder = wfst_decoders[batch_index[index]];
+            if (wfst_decoder && own_decoders) {
+                wfst_decoder->StartUtterance();
             }
-			if (lm_ == nullptr) {
-                result = GreedySearch(floatData, *encoder_out_lens, outputShape[2], true, us_alphas, us_peaks);
-			} else {
-			    result = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
-                if (input_finished) {
-                    result = FinalizeDecode(wfst_decoder, true, us_alphas, us_peaks);
+            float* item_data = floatData + index * token_stride;
+            int item_len = encoder_out_lens[index];
+            // timestamp
+            if(outputTensor.size() == 4){
+                // upsampled cif outputs are padded along with the features, 3 frames per lfr frame
+                int64_t valid_len = paraformer_length[index] * 3;
+                std::vector<float> us_alphas(us_alphas_data + index * us_alphas_stride,
+                    us_alphas_data + index * us_alphas_stride + std::min(valid_len, us_alphas_stride));
+                std::vector<float> us_peaks(us_peaks_data + index * us_peaks_stride,
+                    us_peaks_data + index * us_peaks_stride + std::min(valid_len, us_peaks_stride));
+                if (lm_ == nullptr || wfst_decoder == nullptr) {
+                    result = GreedySearch(item_data, item_len, outputShape[2], true, us_alphas, us_peaks);
+                } else {
+                    result = BeamSearch(wfst_decoder, item_data, item_len, outputShape[2]);
+                    if (input_finished) {
+                        result = FinalizeDecode(wfst_decoder, true, us_alphas, us_peaks);
+                    }
                 }
-			}
-        }else{
-			if (lm_ == nullptr) {
-                result = GreedySearch(floatData, *encoder_out_lens, outputShape[2]);
-			} else {
-			    result = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
-                if (input_finished) {
-                    result = FinalizeDecode(wfst_decoder);
+            }else{
+                if (lm_ == nullptr || wfst_decoder == nullptr) {
+                    result = GreedySearch(item_data, item_len, outputShape[2]);
+                } else {
+                    result = BeamSearch(wfst_decoder, item_data, item_len, outputShape[2]);
+                    if (input_finished) {
+                        result = FinalizeDecode(wfst_decoder);
+                    }
                 }
-			}
+            }
+            results[batch_index[index]] = result;
+            if (wfst_decoder && !own_decoders && real_batch > 1){
+                wfst_decoder->StartUtterance();
+            }
         }
     }
     catch (std::exception const &e)
@@ -549,19 +560,35 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
         LOG(ERROR)<<e.what();
     }
 
-    results.push_back(result);
     return results;
 }
 
 
 std::vector<std::vector<float>> Paraformer::CompileHotwordEmbedding(std::string &hotwords) {
-    int embedding_dim = encoder_size;
-    std::vector<std::vector<float>> hw_emb;
+    FUNASR_HW_EMB hw_emb = CompileSharedHotwordEmbedding(hotwords);
+    return hw_emb ? hw_emb->Rows() : std::vector<std::vector<float>>();
+}
+
+FUNASR_HW_EMB Paraformer::CompileSharedHotwordEmbedding(std::string &hotwords) {
     if (!use_hotword) {
-        std::vector<float> vec(embedding_dim, 0);
+        std::vector<std::vector<float>> hw_emb;
+        std::vector<float> vec(encoder_size, 0);
         hw_emb.push_back(vec);
-        return hw_emb;
-    }
+        return std::make_shared<const FunHotwordEmbedding>(FunHotwordEmbedding::FromRows(hw_emb));
+    }
+    // the words are compiled in sorted order, so every order of a set shares one entry
+    std::string key = NormalizeHotwords(hotwords);
+    return hw_emb_cache_.Get(key, [&]() -> std::shared_ptr<const FunHotwordEmbedding> {
+        std::vector<std::vector<float>> result = BuildHotwordEmbedding(key);
+        if (result.empty()) {
+            return nullptr;
+        }
+        return std::make_shared<const FunHotwordEmbedding>(FunHotwordEmbedding::FromRows(result));
+    });
+}
+
+std::vector<std::vector<float>> Paraformer::BuildHotwordEmbedding(const std::string &hotwords) {
+    int embedding_dim = encoder_size;
     int max_hotword_len = 10;
     std::vector<int32_t> hotword_matrix;
     std::vector<int32_t> lengths;
@@ -659,17 +686,17 @@ std::vector<std::vector<float>> Paraformer::CompileHotwordEmbedding(std::string
 
 Vocab* Paraformer::GetVocab()
 {
-    return vocab;
+    return vocab.get();
 }
 
 Vocab* Paraformer::GetLmVocab()
 {
-    return lm_vocab;
+    return lm_vocab.get();
 }
 
 PhoneSet* Paraformer::GetPhoneSet()
 {
-    return phone_set_;
+    return phone_set_.get();
 }
 
 string Paraformer::Rescoring()
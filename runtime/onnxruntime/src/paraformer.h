@@ -19,25 +19,28 @@ namespace funasr {
      * https://arxiv.org/pdf/2206.08317.pdf
     */
     private:
-        Vocab* vocab = nullptr;
-        Vocab* lm_vocab = nullptr;
-        SegDict* seg_dict = nullptr;
-        PhoneSet* phone_set_ = nullptr;
+        std::shared_ptr<Vocab> vocab = nullptr;
+        std::shared_ptr<Vocab> lm_vocab = nullptr;
+        std::shared_ptr<SegDict> seg_dict = nullptr;
+        std::shared_ptr<PhoneSet> phone_set_ = nullptr;
         //const float scale = 22.6274169979695;
         const float scale = 1.0;
 
         void LoadConfigFromYaml(const char* filename);
         void LoadOnlineConfigFromYaml(const char* filename);
         void LoadCmvn(const char *filename);
-        void LfrCmvn(std::vector<std::vector<float>> &asr_feats);
+        int LfrFrames(int num_frames) { return (num_frames + lfr_n - 1) / lfr_n; };
+        void LfrCmvn(const float *asr_feats, int num_frames, float *out_feats);
 
         std::shared_ptr<Ort::Session> hw_m_session = nullptr;
-        Ort::Env hw_env_;
         Ort::SessionOptions hw_session_options;
         vector<string> hw_m_strInputNames, hw_m_strOutputNames;
         vector<const char*> hw_m_szInputNames;
         vector<const char*> hw_m_szOutputNames;
         bool use_hotword;
+        std::vector<std::vector<float>> BuildHotwordEmbedding(const std::string &hotwords);
+        HotwordCache<const FunHotwordEmbedding> hw_emb_cache_{"hotword embedding", HOTWORD_CACHE_SIZE};
+        HotwordCache<BiasLm> bias_lm_cache_{"bias lm", HOTWORD_CACHE_SIZE};
 
     public:
         Paraformer();
@@ -51,25 +54,39 @@ namespace funasr {
         void InitHwCompiler(const std::string &hw_model, int thread_num);
         void InitSegDict(const std::string &seg_dict_model);
         std::vector<std::vector<float>> CompileHotwordEmbedding(std::string &hotwords);
+        FUNASR_HW_EMB CompileSharedHotwordEmbedding(std::string &hotwords);
         void Reset();
-        void FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats);
-        std::vector<std::string> Forward(float** din, int* len, bool input_finished=true, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1);
+        void FbankKaldi(float sample_rate, const float* waves, int len, FeatureMatrix &asr_feats);
+        std::vector<std::string> Forward(float** din, int* len, bool input_finished=true, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1,
+            const FbankCache *fbank_cache=nullptr);
+        std::vector<std::string> Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb, void* wfst_decoder, int batch_in=1,
+            const FbankCache *fbank_cache=nullptr);
+        std::vector<std::string> Forward(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb,
+            const std::vector<void*> &wfst_decoders, const FbankCache *fbank_cache=nullptr);
         string GreedySearch( float* in, int n_len, int64_t token_nums,
                              bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
 
         string Rescoring();
         string GetLang(){return language;};
         int GetAsrSampleRate() { return asr_sample_rate; };
+        void SetBatchSize(int batch_size) {batch_size_ = batch_size;};
         int GetBatchSize() {return batch_size_;};
+        void SetOnlineBatch(int batch_size, int max_wait_us);
         void StartUtterance();
         void EndUtterance();
         void InitLm(const std::string &lm_file, const std::string &lm_cfg_file, const std::string &lex_file);
         string BeamSearch(WfstDecoder* &wfst_decoder, float* in, int n_len, int64_t token_nums);
+        // one run of the am over batch_in items, item i searched with wfst_decoders[i]. A decoder
+        // shared by the items is restarted after each of them, own ones before each item
+        std::vector<std::string> ForwardItems(float** din, int* len, bool input_finished, const FunHotwordEmbedding &hw_emb,
+            const std::vector<WfstDecoder*> &wfst_decoders, bool own_decoders, const FbankCache *fbank_cache);
         string FinalizeDecode(WfstDecoder* &wfst_decoder,
                           bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
         Vocab* GetVocab();
         Vocab* GetLmVocab();
         PhoneSet* GetPhoneSet();
+        // shared by the wfst decoders of this model
+        HotwordCache<BiasLm>* GetBiasLmCache() { return &bias_lm_cache_; };
 		
         knf::FbankOptions fbank_opts_;
         vector<float> means_list_;
@@ -79,7 +96,6 @@ namespace funasr {
 
         // paraformer-offline
         std::shared_ptr<Ort::Session> m_session_ = nullptr;
-        Ort::Env env_;
         Ort::SessionOptions session_options_;
 
         vector<string> m_strInputNames, m_strOutputNames;
@@ -91,6 +107,8 @@ namespace funasr {
         // paraformer-online
         std::shared_ptr<Ort::Session> encoder_session_ = nullptr;
         std::shared_ptr<Ort::Session> decoder_session_ = nullptr;
+        // shared by the online streams, null when online batching is off
+        std::shared_ptr<SessionBatcher> online_batcher_ = nullptr;
         vector<string> en_strInputNames, en_strOutputNames;
         vector<const char*> en_szInputNames_;
         vector<const char*> en_szOutputNames_;
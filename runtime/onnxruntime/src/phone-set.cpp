@@ -1,4 +1,5 @@
 #include "phone-set.h"
+#include "model-cache.h"
 #include <yaml-cpp/yaml.h>
 #include <glog/logging.h>
 
@@ -36,19 +37,13 @@ void PhoneSet::LoadPhoneSetFromYaml(const char* filename) {
 }
 
 void PhoneSet::LoadPhoneSetFromJson(const char* filename) {
-    nlohmann::json json_array;
-    std::ifstream file(filename);
-    if (file.is_open()) {
-        file >> json_array;
-        file.close();
-    } else {
+    if (!ModelCache::LoadTokens(filename, phone_)) {
         LOG(INFO) << "Error loading token file, token file error or not exist.";
         exit(-1);
     }
 
     int id = 0;
-    for (const auto& element : json_array) {
-        phone_.push_back(element);
+    for (const auto& element : phone_) {
         phn2Id_.emplace(element, id);
         id++;
     }
@@ -0,0 +1,97 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include <map>
+
+namespace funasr {
+
+#define POS_EMB_ALIGN 64
+#define POS_EMB_BLOCK_ROWS 256
+// 8192 rows span about 8 minutes of audio at the 60ms lfr frame rate, and
+// take 8192 * 560 floats, about 18 MB per feat_dim; rows past that are
+// computed on the fly for each chunk.
+#define POS_EMB_MAX_ROWS 8192
+
+PosEmbTable::PosEmbTable(int feat_dim) : feat_dim_(feat_dim)
+{
+    float scale = -0.0330119726594128;
+    for (int i = 0; i < feat_dim_/2; i++) {
+        timescales_.emplace_back(exp(i * scale));
+    }
+}
+
+PosEmbTable::~PosEmbTable()
+{
+    for (auto block : blocks_) {
+        AlignedFree(block);
+    }
+}
+
+std::shared_ptr<PosEmbTable> PosEmbTable::GetInstance(int feat_dim)
+{
+    static std::mutex instances_mutex;
+    static std::map<int, std::shared_ptr<PosEmbTable>> instances;
+    std::lock_guard<std::mutex> lock(instances_mutex);
+    std::shared_ptr<PosEmbTable> &instance = instances[feat_dim];
+    if (!instance) {
+        instance = std::make_shared<PosEmbTable>(feat_dim);
+    }
+    return instance;
+}
+
+void PosEmbTable::ComputeRows(int start, int num_rows, float *out) const
+{
+    int half_dim = feat_dim_/2;
+    for (int j = 0; j < num_rows; j++) {
+        float *row = out + (size_t)j * feat_dim_;
+        for (int i = 0; i < half_dim; i++) {
+            float coe = timescales_[i] * (start + j + 1);
+            row[i] = sin(coe);
+            row[i + half_dim] = cos(coe);
+        }
+    }
+}
+
+const float *PosEmbTable::GetBlock(int block_idx)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (blocks_.size() <= (size_t)block_idx) {
+        size_t block_size = (size_t)POS_EMB_BLOCK_ROWS * feat_dim_;
+        float *block = (float*)AlignedMalloc(POS_EMB_ALIGN, block_size * sizeof(float));
+        ComputeRows(blocks_.size() * POS_EMB_BLOCK_ROWS, POS_EMB_BLOCK_ROWS, block);
+        blocks_.emplace_back(block);
+    }
+    return blocks_[block_idx];
+}
+
+void PosEmbTable::AddTo(float *feats, int start, int num_rows)
+{
+    int end = start + num_rows;
+    int pos = start;
+    // cached rows, added one contiguous block segment at a time
+    while (pos < end && pos < POS_EMB_MAX_ROWS) {
+        int block_idx = pos / POS_EMB_BLOCK_ROWS;
+        int block_end = std::min(std::min(end, (block_idx + 1) * POS_EMB_BLOCK_ROWS), POS_EMB_MAX_ROWS);
+        const float *emb = GetBlock(block_idx) + (size_t)(pos - block_idx * POS_EMB_BLOCK_ROWS) * feat_dim_;
+        float *out = feats + (size_t)(pos - start) * feat_dim_;
+        size_t n = (size_t)(block_end - pos) * feat_dim_;
+        for (size_t k = 0; k < n; k++) {
+            out[k] += emb[k];
+        }
+        pos = block_end;
+    }
+    // very long streams
+    if (pos < end) {
+        std::vector<float> emb((size_t)(end - pos) * feat_dim_);
+        ComputeRows(pos, end - pos, emb.data());
+        float *out = feats + (size_t)(pos - start) * feat_dim_;
+        for (size_t k = 0; k < emb.size(); k++) {
+            out[k] += emb[k];
+        }
+    }
+}
+
+} // namespace funasr
@@ -0,0 +1,44 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef POS_EMB_TABLE_H
+#define POS_EMB_TABLE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace funasr {
+
+// Sinusoidal position embedding of the streaming encoder input, row p holds
+// sin(w_i*(p+1)) in the first half and cos(w_i*(p+1)) in the second half.
+// The table is shared by all online sessions with the same feat_dim and grows
+// lazily in fixed blocks that never move, so readers only lock to look up a block.
+// Positions past POS_EMB_MAX_ROWS are computed on the fly instead of cached.
+class PosEmbTable {
+  public:
+    explicit PosEmbTable(int feat_dim);
+    ~PosEmbTable();
+    PosEmbTable(const PosEmbTable &other) = delete;
+    PosEmbTable &operator=(const PosEmbTable &other) = delete;
+
+    static std::shared_ptr<PosEmbTable> GetInstance(int feat_dim);
+
+    // feats[i] += pos_emb[start + i] for i in [0, num_rows)
+    void AddTo(float *feats, int start, int num_rows);
+    int FeatDim() const { return feat_dim_; }
+
+  private:
+    const float *GetBlock(int block_idx);
+    void ComputeRows(int start, int num_rows, float *out) const;
+
+    int feat_dim_;
+    std::vector<float> timescales_;
+    std::mutex mutex_;
+    std::vector<float*> blocks_;
+};
+
+} // namespace funasr
+#endif
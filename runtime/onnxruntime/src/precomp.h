@@ -45,6 +45,20 @@ using namespace std;
 #include "com-define.h"
 #include "commonfunc.h"
 #include "predefine-coe.h"
+#include "feature-matrix.h"
+#include "fbank-cache.h"
+#include "pos-emb-table.h"
+#include "lfr-cmvn.h"
+#include "cif.h"
+#include "session-batcher.h"
+#include "ort-binding.h"
+#include "runtime-context.h"
+#include "model-bundle.h"
+#include "fst-loader.h"
+#include "model-cache.h"
+#include "model-registry.h"
+#include "load-timer.h"
+#include "hotword-cache.h"
 #include "model.h"
 #include "vad-model.h"
 #include "punc-model.h"
@@ -52,6 +66,7 @@ using namespace std;
 #include "ct-transformer.h"
 #include "ct-transformer-online.h"
 #include "e2e-vad.h"
+#include "fsmn-vad-batcher.h"
 #include "fsmn-vad.h"
 #include "encode_converter.h"
 #include "vocab.h"
@@ -69,6 +84,7 @@ using namespace std;
 #include "paraformer-torch.h"
 #endif
 #include "paraformer-online.h"
+#include "offline-batcher.h"
 #include "offline-stream.h"
 #include "tpass-stream.h"
 #include "tpass-online-stream.h"
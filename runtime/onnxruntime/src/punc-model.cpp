@@ -3,6 +3,7 @@
 namespace funasr {
 PuncModel *CreatePuncModel(std::map<std::string, std::string>& model_path, int thread_num, PUNC_TYPE type)
 {
+    LoadTimer timer("Punc handle");
     PuncModel *mm;
     if (type==PUNC_OFFLINE){
         mm = new CTTransformer();
@@ -24,6 +25,8 @@ PuncModel *CreatePuncModel(std::map<std::string, std::string>& model_path, int t
     token_file = PathAppend(model_path.at(MODEL_DIR), TOKEN_PATH);
 
     mm->InitPunc(punc_model_path, punc_config_path, token_file, thread_num);
+    timer.Mark("punc");
+    timer.Report();
     return mm;
 }
 
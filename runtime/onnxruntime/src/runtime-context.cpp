@@ -0,0 +1,107 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "runtime-context.h"
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace funasr {
+
+RuntimeContext &RuntimeContext::Instance()
+{
+    static RuntimeContext context;
+    return context;
+}
+
+bool RuntimeContext::SetAffinity(const std::string &cpu_affinity)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    std::stringstream ss(cpu_affinity);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                throw std::out_of_range(range);
+            }
+            for (int cpu = first; cpu <= last; cpu++) {
+                CPU_SET(cpu, &cpus);
+            }
+        } catch (std::exception const &) {
+            LOG(ERROR) << "Invalid cpu affinity " << cpu_affinity;
+            return false;
+        }
+    }
+    if (CPU_COUNT(&cpus) == 0 || sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        LOG(ERROR) << "Failed to set cpu affinity " << cpu_affinity;
+        return false;
+    }
+    return true;
+#else
+    LOG(WARNING) << "cpu affinity is only supported on linux, ignore " << cpu_affinity;
+    return false;
+#endif
+}
+
+bool RuntimeContext::Configure(int cpu_budget, const std::string &cpu_affinity)
+{
+    RuntimeContext &context = Instance();
+    std::lock_guard<std::mutex> lock(context.mutex_);
+    if (context.env_) {
+        LOG(ERROR) << "RuntimeContext must be configured before the first model is loaded";
+        return false;
+    }
+    context.cpu_budget_ = std::max(cpu_budget, 0);
+    if (!cpu_affinity.empty() && !SetAffinity(cpu_affinity)) {
+        return false;
+    }
+    if (context.cpu_budget_ > 0) {
+        LOG(INFO) << "All onnx sessions share " << context.cpu_budget_ << " intra-op threads";
+    }
+    return true;
+}
+
+Ort::Env &RuntimeContext::Env()
+{
+    RuntimeContext &context = Instance();
+    std::lock_guard<std::mutex> lock(context.mutex_);
+    if (!context.env_) {
+        if (context.cpu_budget_ > 0) {
+            Ort::ThreadingOptions threading_options;
+            threading_options.SetGlobalIntraOpNumThreads(context.cpu_budget_);
+            threading_options.SetGlobalInterOpNumThreads(1);
+            context.env_ = std::make_unique<Ort::Env>(threading_options, ORT_LOGGING_LEVEL_ERROR, "funasr");
+        } else {
+            context.env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_ERROR, "funasr");
+        }
+    }
+    return *context.env_;
+}
+
+void RuntimeContext::SetThreads(Ort::SessionOptions &options, int thread_num)
+{
+    // the mode is fixed once the env exists
+    Env();
+    if (Instance().cpu_budget_ > 0) {
+        options.DisablePerSessionThreads();
+    } else {
+        options.SetIntraOpNumThreads(thread_num);
+    }
+}
+
+int RuntimeContext::CpuBudget()
+{
+    RuntimeContext &context = Instance();
+    std::lock_guard<std::mutex> lock(context.mutex_);
+    return context.cpu_budget_;
+}
+
+} // namespace funasr
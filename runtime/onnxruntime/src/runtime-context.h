@@ -0,0 +1,44 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef RUNTIME_CONTEXT_H
+#define RUNTIME_CONTEXT_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "onnxruntime_cxx_api.h"
+
+namespace funasr {
+
+// The one Ort::Env of the process, shared by the sessions of all models.
+// Without a cpu budget every session keeps its own intra-op pool of
+// thread_num threads. With a budget all sessions run on one global intra-op
+// pool of that many threads, so the onnx threads of a server no longer add up
+// per model on top of its decoder threads.
+class RuntimeContext {
+  public:
+    // Must run before the first model is loaded, and from the main thread
+    // before any other thread starts if cpu_affinity is set: threads inherit
+    // the affinity of the thread that creates them. cpu_affinity is a cpu
+    // list such as "0-7,16", empty keeps the current one.
+    static bool Configure(int cpu_budget, const std::string &cpu_affinity);
+    static Ort::Env &Env();
+    // thread settings of a session for the configured mode
+    static void SetThreads(Ort::SessionOptions &options, int thread_num);
+    // 0 if every session has its own intra-op pool
+    static int CpuBudget();
+
+  private:
+    static RuntimeContext &Instance();
+    static bool SetAffinity(const std::string &cpu_affinity);
+
+    std::mutex mutex_;
+    std::unique_ptr<Ort::Env> env_ = nullptr;
+    int cpu_budget_ = 0;
+};
+
+} // namespace funasr
+#endif
@@ -18,13 +18,19 @@ using namespace std;
 namespace funasr {
 SegDict::SegDict(const char *filename)
 {
-    ifstream in(filename);
+    ModelBundle::Entry entry;
+    std::shared_ptr<ModelBundle> bundle = ModelBundle::Find(filename, entry);
+    if (bundle && entry.kind == ModelBundle::SEG_DICT) {
+      LoadFromBundle(entry);
+      return;
+    }
+    std::unique_ptr<std::istream> in = ModelBundle::OpenStream(filename);
     if (!in) {
       LOG(ERROR) << filename << " open failed !!";
       return;
     }
     string textline;
-    while (getline(in, textline)) {
+    while (getline(*in, textline)) {
       std::vector<string> line_item = split(textline, '\t');
       //std::cout << textline << std::endl;
       if (line_item.size() > 1) {
@@ -36,6 +42,34 @@ SegDict::SegDict(const char *filename)
     }
     LOG(INFO) << "load seg dict successfully";
 }
+void SegDict::LoadFromBundle(const ModelBundle::Entry &entry)
+{
+    // uint32 num_words, uint32 num_tokens[num_words], then every word and its tokens
+    uint32_t num_words = 0;
+    if (entry.size >= sizeof(num_words)) {
+      memcpy(&num_words, entry.data, sizeof(num_words));
+    }
+    size_t counts_size = sizeof(uint32_t) * ((size_t)num_words + 1);
+    std::vector<string> strings;
+    if (counts_size > entry.size ||
+        !ModelBundle::ReadStrings(entry.data + counts_size, entry.size - counts_size, strings)) {
+      LOG(ERROR) << "Broken seg dict in model bundle";
+      return;
+    }
+    std::vector<uint32_t> num_tokens(num_words);
+    memcpy(num_tokens.data(), entry.data + sizeof(num_words), num_words * sizeof(uint32_t));
+    size_t pos = 0;
+    for (uint32_t i = 0; i < num_words; i++) {
+      if (pos + 1 + num_tokens[i] > strings.size()) {
+        LOG(ERROR) << "Broken seg dict in model bundle";
+        return;
+      }
+      seg_dict[strings[pos]].assign(strings.begin() + pos + 1, strings.begin() + pos + 1 + num_tokens[i]);
+      pos += 1 + num_tokens[i];
+    }
+    LOG(INFO) << "load seg dict successfully";
+}
+
 std::vector<std::string> SegDict::GetTokensByWord(const std::string &word) {
   if (seg_dict.count(word))
     return seg_dict[word];
@@ -9,12 +9,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "model-bundle.h"
 using namespace std;
 
 namespace funasr {
 class SegDict {
   private:
     std::map<string, std::vector<string>> seg_dict;
+    void LoadFromBundle(const ModelBundle::Entry &entry);
 
   public:
     SegDict(const char *filename);
@@ -12,7 +12,7 @@ namespace funasr {
 
 SenseVoiceSmall::SenseVoiceSmall()
 :use_hotword(false),
- env_(ORT_LOGGING_LEVEL_ERROR, "sensevoice"),session_options_{} {
+ session_options_{} {
 }
 
 // offline
@@ -29,13 +29,13 @@ void SenseVoiceSmall::InitAsr(const std::string &am_model, const std::string &am
     fbank_opts_.mel_opts.debug_mel = false;
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
 
     try {
-        m_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(am_model).c_str(), session_options_);
+        m_session_ = ModelRegistry::GetSession(am_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << am_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am onnx model: " << e.what();
@@ -44,7 +44,7 @@ void SenseVoiceSmall::InitAsr(const std::string &am_model, const std::string &am
 
     GetInputNames(m_session_.get(), m_strInputNames, m_szInputNames);
     GetOutputNames(m_session_.get(), m_strOutputNames, m_szOutputNames);
-    vocab = new Vocab(token_file.c_str());
+    vocab = ModelRegistry::GetVocab(token_file);
     LoadCmvn(am_cmvn.c_str());
 }
 
@@ -63,13 +63,13 @@ void SenseVoiceSmall::InitAsr(const std::string &en_model, const std::string &de
     fbank_opts_.mel_opts.debug_mel = false;
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    RuntimeContext::SetThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
 
     try {
-        encoder_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(en_model).c_str(), session_options_);
+        encoder_session_ = ModelRegistry::GetSession(en_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << en_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am encoder model: " << e.what();
@@ -77,7 +77,7 @@ void SenseVoiceSmall::InitAsr(const std::string &en_model, const std::string &de
     }
 
     try {
-        decoder_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(de_model).c_str(), session_options_);
+        decoder_session_ = ModelRegistry::GetSession(de_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << de_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am decoder model: " << e.what();
@@ -121,8 +121,8 @@ void SenseVoiceSmall::InitAsr(const std::string &en_model, const std::string &de
     for (auto& item : de_strOutputNames)
         de_szOutputNames_.push_back(item.c_str());
 
-    online_vocab = new Vocab(token_file.c_str());
-    phone_set_ = new PhoneSet(token_file.c_str());
+    online_vocab = ModelRegistry::GetVocab(token_file);
+    phone_set_ = ModelRegistry::GetPhoneSet(token_file);
     LoadCmvn(am_cmvn.c_str());
 }
 
@@ -134,7 +134,7 @@ void SenseVoiceSmall::InitAsr(const std::string &am_model, const std::string &en
 
     // offline
     try {
-        m_session_ = std::make_unique<Ort::Session>(env_, ORTSTRING(am_model).c_str(), session_options_);
+        m_session_ = ModelRegistry::GetSession(am_model, session_options_, thread_num);
         LOG(INFO) << "Successfully load model from " << am_model;
     } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load am onnx model: " << e.what();
@@ -143,14 +143,14 @@ void SenseVoiceSmall::InitAsr(const std::string &am_model, const std::string &en
 
     GetInputNames(m_session_.get(), m_strInputNames, m_szInputNames);
     GetOutputNames(m_session_.get(), m_strOutputNames, m_szOutputNames);
-    vocab = new Vocab(token_file.c_str());
+    vocab = ModelRegistry::GetVocab(token_file);
 }
 
 void SenseVoiceSmall::LoadOnlineConfigFromYaml(const char* filename){
 
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(ERROR) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -191,7 +191,7 @@ void SenseVoiceSmall::LoadConfigFromYaml(const char* filename){
 
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(ERROR) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -220,21 +220,6 @@ void SenseVoiceSmall::LoadConfigFromYaml(const char* filename){
 
 SenseVoiceSmall::~SenseVoiceSmall()
 {
-    if(vocab){
-        delete vocab;
-    }
-    if(online_vocab){
-        delete online_vocab;
-    }
-    if(lm_vocab){
-        delete lm_vocab;
-    }
-    if(seg_dict){
-        delete seg_dict;
-    }
-    if(phone_set_){
-        delete phone_set_;
-    }
 }
 
 void SenseVoiceSmall::StartUtterance()
@@ -249,7 +234,18 @@ void SenseVoiceSmall::Reset()
 {
 }
 
-void SenseVoiceSmall::FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats) {
+void SenseVoiceSmall::SetOnlineBatch(int batch_size, int max_wait_us)
+{
+    // online streams take the batcher when they are created
+    if (batch_size > 1) {
+        online_batcher_ = std::make_shared<SessionBatcher>(
+            batch_size, max_wait_us, std::vector<Ort::Session*>{encoder_session_.get(), decoder_session_.get()});
+    } else {
+        online_batcher_ = nullptr;
+    }
+}
+
+void SenseVoiceSmall::FbankKaldi(float sample_rate, const float* waves, int len, FeatureMatrix &asr_feats) {
     knf::OnlineFbank fbank_(fbank_opts_);
     std::vector<float> buf(len);
     for (int32_t i = 0; i != len; ++i) {
@@ -258,47 +254,20 @@ void SenseVoiceSmall::FbankKaldi(float sample_rate, const float* waves, int len,
     fbank_.AcceptWaveform(sample_rate, buf.data(), buf.size());
 
     int32_t frames = fbank_.NumFramesReady();
+    int32_t num_bins = fbank_opts_.mel_opts.num_bins;
+    asr_feats.Resize(frames, num_bins);
     for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank_.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        asr_feats.emplace_back(frame_vector);
+        memcpy(asr_feats.Row(i), fbank_.GetFrame(i), num_bins * sizeof(float));
     }
 }
 
 void SenseVoiceSmall::LoadCmvn(const char *filename)
 {
-    ifstream cmvn_stream(filename);
-    if (!cmvn_stream.is_open()) {
-        LOG(ERROR) << "Failed to open file: " << filename;
+    if (!ModelCache::LoadCmvn(filename, means_list_, vars_list_)) {
         exit(-1);
     }
-    string line;
-
-    while (getline(cmvn_stream, line)) {
-        istringstream iss(line);
-        vector<string> line_item{istream_iterator<string>{iss}, istream_iterator<string>{}};
-        if (line_item[0] == "<AddShift>") {
-            getline(cmvn_stream, line);
-            istringstream means_lines_stream(line);
-            vector<string> means_lines{istream_iterator<string>{means_lines_stream}, istream_iterator<string>{}};
-            if (means_lines[0] == "<LearnRateCoef>") {
-                for (int j = 3; j < means_lines.size() - 1; j++) {
-                    means_list_.push_back(stof(means_lines[j]));
-                }
-                continue;
-            }
-        }
-        else if (line_item[0] == "<Rescale>") {
-            getline(cmvn_stream, line);
-            istringstream vars_lines_stream(line);
-            vector<string> vars_lines{istream_iterator<string>{vars_lines_stream}, istream_iterator<string>{}};
-            if (vars_lines[0] == "<LearnRateCoef>") {
-                for (int j = 3; j < vars_lines.size() - 1; j++) {
-                    vars_list_.push_back(stof(vars_lines[j])*scale);
-                }
-                continue;
-            }
-        }
+    for (auto &var : vars_list_) {
+        var *= scale;
     }
 }
 
@@ -378,46 +347,11 @@ string SenseVoiceSmall::GreedySearch(float * in, int n_len,  int64_t token_nums,
     }
 }
 
-void SenseVoiceSmall::LfrCmvn(std::vector<std::vector<float>> &asr_feats) {
-
-    std::vector<std::vector<float>> out_feats;
-    int T = asr_feats.size();
-    int T_lrf = ceil(1.0 * T / lfr_n);
-
-    // Pad frames at start(copy first frame)
-    for (int i = 0; i < (lfr_m - 1) / 2; i++) {
-        asr_feats.insert(asr_feats.begin(), asr_feats[0]);
-    }
-    // Merge lfr_m frames as one,lfr_n frames per window
-    T = T + (lfr_m - 1) / 2;
-    std::vector<float> p;
-    for (int i = 0; i < T_lrf; i++) {
-        if (lfr_m <= T - i * lfr_n) {
-            for (int j = 0; j < lfr_m; j++) {
-                p.insert(p.end(), asr_feats[i * lfr_n + j].begin(), asr_feats[i * lfr_n + j].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        } else {
-            // Fill to lfr_m frames at last window if less than lfr_m frames  (copy last frame)
-            int num_padding = lfr_m - (T - i * lfr_n);
-            for (int j = 0; j < (asr_feats.size() - i * lfr_n); j++) {
-                p.insert(p.end(), asr_feats[i * lfr_n + j].begin(), asr_feats[i * lfr_n + j].end());
-            }
-            for (int j = 0; j < num_padding; j++) {
-                p.insert(p.end(), asr_feats[asr_feats.size() - 1].begin(), asr_feats[asr_feats.size() - 1].end());
-            }
-            out_feats.emplace_back(p);
-            p.clear();
-        }
-    }
-    // Apply cmvn
-    for (auto &out_feat: out_feats) {
-        for (int j = 0; j < means_list_.size(); j++) {
-            out_feat[j] = (out_feat[j] + means_list_[j]) * vars_list_[j];
-        }
-    }
-    asr_feats = out_feats;
+// Writes LfrFrames(T) rows of lfr_m*num_bins floats to out_feats
+void SenseVoiceSmall::LfrCmvn(const float *asr_feats, int T, float *out_feats) {
+    // Pad (lfr_m - 1) / 2 frames at start and fill the last window with the last frame
+    ApplyLfrCmvn(asr_feats, T, fbank_opts_.mel_opts.num_bins, lfr_m, lfr_n, (lfr_m - 1) / 2,
+                 means_list_, vars_list_, out_feats, LfrFrames(T));
 }
 
 std::vector<std::vector<float>> SenseVoiceSmall::CompileHotwordEmbedding(std::string &hotwords) {
@@ -428,7 +362,8 @@ std::vector<std::vector<float>> SenseVoiceSmall::CompileHotwordEmbedding(std::st
     return hw_emb;
 }
 
-std::vector<std::string> SenseVoiceSmall::Forward(float** din, int* len, bool input_finished, std::string svs_lang, bool svs_itn, int batch_in)
+std::vector<std::string> SenseVoiceSmall::Forward(float** din, int* len, bool input_finished, std::string svs_lang, bool svs_itn, int batch_in,
+    const FbankCache *fbank_cache)
 {
     std::vector<std::string> results;
     string result="";
@@ -439,20 +374,27 @@ std::vector<std::string> SenseVoiceSmall::Forward(float** din, int* len, bool in
         return results;
     }
 
-    std::vector<std::vector<float>> asr_feats;
-    FbankKaldi(asr_sample_rate, din[0], len[0], asr_feats);
-    if(asr_feats.size() == 0){
+    // fbank rows of the segment from the vad's fbank_cache, computed here if it does not hold them
+    FeatureMatrix asr_feats;
+    int32_t fbank_frames = 0;
+    const float *fbank = nullptr;
+    if(fbank_cache){
+        fbank = fbank_cache->GetSegment(fbank_opts_, din[0], len[0], fbank_frames);
+    }
+    if(fbank == nullptr){
+        FbankKaldi(asr_sample_rate, din[0], len[0], asr_feats);
+        fbank = asr_feats.Data();
+        fbank_frames = asr_feats.NumRows();
+    }
+    if(fbank_frames == 0){
         results.push_back(result);
         return results;
     }
-    LfrCmvn(asr_feats);
     int32_t feat_dim = lfr_m*in_feat_dim;
-    int32_t num_frames = asr_feats.size();
+    int32_t num_frames = LfrFrames(fbank_frames);
 
-    std::vector<float> wav_feats;
-    for (const auto &frame_feat: asr_feats) {
-        wav_feats.insert(wav_feats.end(), frame_feat.begin(), frame_feat.end());
-    }
+    FeatureMatrix wav_feats(num_frames, feat_dim);
+    LfrCmvn(fbank, fbank_frames, wav_feats.Data());
 
     //lid textnorm
     int svs_lid = 0;
@@ -472,8 +414,8 @@ std::vector<std::string> SenseVoiceSmall::Forward(float** din, int* len, bool in
 
     const int64_t input_shape_[3] = {1, num_frames, feat_dim};
     Ort::Value onnx_feats = Ort::Value::CreateTensor<float>(m_memoryInfo,
-        wav_feats.data(),
-        wav_feats.size(),
+        wav_feats.Data(),
+        wav_feats.Size(),
         input_shape_,
         3);
 
@@ -11,20 +11,20 @@ namespace funasr {
 
     class SenseVoiceSmall : public Model {
     private:
-        Vocab* vocab = nullptr;
-        Vocab* online_vocab = nullptr;
-        Vocab* lm_vocab = nullptr;
-        SegDict* seg_dict = nullptr;
-        PhoneSet* phone_set_ = nullptr;
+        std::shared_ptr<Vocab> vocab = nullptr;
+        std::shared_ptr<Vocab> online_vocab = nullptr;
+        std::shared_ptr<Vocab> lm_vocab = nullptr;
+        std::shared_ptr<SegDict> seg_dict = nullptr;
+        std::shared_ptr<PhoneSet> phone_set_ = nullptr;
         const float scale = 1.0;
 
         void LoadConfigFromYaml(const char* filename);
         void LoadOnlineConfigFromYaml(const char* filename);
         void LoadCmvn(const char *filename);
-        void LfrCmvn(std::vector<std::vector<float>> &asr_feats);
+        int LfrFrames(int num_frames) { return (num_frames + lfr_n - 1) / lfr_n; };
+        void LfrCmvn(const float *asr_feats, int num_frames, float *out_feats);
 
         std::shared_ptr<Ort::Session> hw_m_session = nullptr;
-        Ort::Env hw_env_;
         Ort::SessionOptions hw_session_options;
         vector<string> hw_m_strInputNames, hw_m_strOutputNames;
         vector<const char*> hw_m_szInputNames;
@@ -44,8 +44,9 @@ namespace funasr {
         // void InitSegDict(const std::string &seg_dict_model);
         std::vector<std::vector<float>> CompileHotwordEmbedding(std::string &hotwords);
         void Reset();
-        void FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats);
-        std::vector<std::string> Forward(float** din, int* len, bool input_finished=true, std::string svs_lang="auto", bool svs_itn=true, int batch_in=1);
+        void FbankKaldi(float sample_rate, const float* waves, int len, FeatureMatrix &asr_feats);
+        std::vector<std::string> Forward(float** din, int* len, bool input_finished=true, std::string svs_lang="auto", bool svs_itn=true, int batch_in=1,
+            const FbankCache *fbank_cache=nullptr);
         string CTCSearch( float * in, std::vector<int32_t> paraformer_length, std::vector<int64_t> outputShape);
         string GreedySearch( float* in, int n_len, int64_t token_nums,
                              bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
@@ -53,6 +54,7 @@ namespace funasr {
         string GetLang(){return language;};
         int GetAsrSampleRate() { return asr_sample_rate; };
         int GetBatchSize() {return batch_size_;};
+        void SetOnlineBatch(int batch_size, int max_wait_us);
         void StartUtterance();
         void EndUtterance();
         // void InitLm(const std::string &lm_file, const std::string &lm_cfg_file, const std::string &lex_file);
@@ -71,7 +73,6 @@ namespace funasr {
 
         // paraformer-offline
         std::shared_ptr<Ort::Session> m_session_ = nullptr;
-        Ort::Env env_;
         Ort::SessionOptions session_options_;
 
         vector<string> m_strInputNames, m_strOutputNames;
@@ -83,6 +84,8 @@ namespace funasr {
         // paraformer-online
         std::shared_ptr<Ort::Session> encoder_session_ = nullptr;
         std::shared_ptr<Ort::Session> decoder_session_ = nullptr;
+        // shared by the online streams, null when online batching is off
+        std::shared_ptr<SessionBatcher> online_batcher_ = nullptr;
         vector<string> en_strInputNames, en_strOutputNames;
         vector<const char*> en_szInputNames_;
         vector<const char*> en_szOutputNames_;
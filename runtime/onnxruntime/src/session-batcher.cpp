@@ -0,0 +1,173 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#include "precomp.h"
+#include "session-batcher.h"
+
+namespace funasr {
+
+static size_t ElementSize(ONNXTensorElementDataType type)
+{
+    switch (type) {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            return 4;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static bool TypeHasBatchDim(const Ort::TypeInfo &type_info)
+{
+    if (type_info.GetONNXType() != ONNX_TYPE_TENSOR) {
+        return false;
+    }
+    // dynamic and symbolic dims are -1, a model exported with batch 1 has 1
+    std::vector<int64_t> shape = type_info.GetTensorTypeAndShapeInfo().GetShape();
+    return !shape.empty() && shape[0] < 0;
+}
+
+bool HasBatchDim(Ort::Session *session)
+{
+    for (size_t i = 0; i < session->GetInputCount(); i++) {
+        if (!TypeHasBatchDim(session->GetInputTypeInfo(i))) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < session->GetOutputCount(); i++) {
+        if (!TypeHasBatchDim(session->GetOutputTypeInfo(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SessionBatcher::SessionBatcher(int max_batch, int max_wait_us, const std::vector<Ort::Session*> &sessions)
+    : queue_(max_batch, max_wait_us)
+{
+    for (auto session : sessions) {
+        if (!session) {
+            continue;
+        }
+        if (HasBatchDim(session)) {
+            batch_sessions_.insert(session);
+        } else {
+            LOG(WARNING) << "Onnx model has a fixed batch dim, its online streams are run one by one";
+        }
+    }
+}
+
+bool SessionBatcher::MakeKey(Ort::Session *session, const Ort::Value *inputs, size_t input_count, std::vector<int64_t> &key)
+{
+    key.clear();
+    key.emplace_back((int64_t)(intptr_t)session);
+    for (size_t i = 0; i < input_count; i++) {
+        auto info = inputs[i].GetTensorTypeAndShapeInfo();
+        std::vector<int64_t> shape = info.GetShape();
+        if (shape.empty() || shape[0] != 1 || ElementSize(info.GetElementType()) == 0) {
+            return false;
+        }
+        key.emplace_back(info.GetElementType());
+        key.emplace_back(shape.size());
+        key.insert(key.end(), shape.begin(), shape.end());
+    }
+    return true;
+}
+
+std::vector<Ort::Value> SessionBatcher::Run(Ort::Session *session,
+                                            const char *const *input_names, Ort::Value *inputs, size_t input_count,
+                                            const char *const *output_names, size_t output_count)
+{
+    Request req = {session, input_names, inputs, input_count, output_names, output_count};
+    req.done = false;
+    if (queue_.MaxBatch() <= 1 || !batch_sessions_.count(session) || !MakeKey(session, inputs, input_count, req.key)) {
+        return session->Run(Ort::RunOptions{nullptr}, input_names, inputs, input_count, output_names, output_count);
+    }
+
+    queue_.Submit({&req}, req.key, [this](const std::vector<Request*> &batch) { RunBatch(batch); });
+    if (req.error) {
+        std::rethrow_exception(req.error);
+    }
+    return std::move(req.outputs);
+}
+
+void SessionBatcher::RunOne(Request *req)
+{
+    try {
+        req->outputs = req->session->Run(Ort::RunOptions{nullptr}, req->input_names, req->inputs, req->input_count,
+                                         req->output_names, req->output_count);
+    } catch (...) {
+        req->error = std::current_exception();
+    }
+}
+
+void SessionBatcher::RunBatch(const std::vector<Request*> &batch)
+{
+    int64_t batch_size = batch.size();
+    if (batch_size == 1) {
+        RunOne(batch[0]);
+        return;
+    }
+
+    // stack every input along the batch dim
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+    size_t input_count = batch[0]->input_count;
+    std::vector<std::vector<char>> buffers(input_count);
+    std::vector<Ort::Value> batch_inputs;
+    for (size_t i = 0; i < input_count; i++) {
+        auto info = batch[0]->inputs[i].GetTensorTypeAndShapeInfo();
+        std::vector<int64_t> shape = info.GetShape();
+        size_t item_bytes = info.GetElementCount() * ElementSize(info.GetElementType());
+        buffers[i].resize(batch_size * item_bytes);
+        for (int64_t b = 0; b < batch_size; b++) {
+            memcpy(buffers[i].data() + b * item_bytes, batch[b]->inputs[i].GetTensorRawData(), item_bytes);
+        }
+        shape[0] = batch_size;
+        batch_inputs.emplace_back(Ort::Value::CreateTensor(
+            memory_info, buffers[i].data(), buffers[i].size(), shape.data(), shape.size(), info.GetElementType()));
+    }
+
+    std::vector<Ort::Value> batch_outputs;
+    std::string error;
+    try {
+        batch_outputs = batch[0]->session->Run(Ort::RunOptions{nullptr}, batch[0]->input_names, batch_inputs.data(),
+                                               batch_inputs.size(), batch[0]->output_names, batch[0]->output_count);
+        for (auto &output : batch_outputs) {
+            auto info = output.GetTensorTypeAndShapeInfo();
+            std::vector<int64_t> shape = info.GetShape();
+            if (shape.empty() || shape[0] != batch_size || ElementSize(info.GetElementType()) == 0) {
+                error = "output is not batched along the first dim";
+            }
+        }
+    } catch (std::exception const &e) {
+        error = e.what();
+    }
+    if (!error.empty()) {
+        LOG(WARNING) << "Batched onnx run failed, running its streams one by one: " << error;
+        for (auto req : batch) {
+            RunOne(req);
+        }
+        return;
+    }
+
+    // split the outputs back to the callers
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (auto &output : batch_outputs) {
+        auto info = output.GetTensorTypeAndShapeInfo();
+        std::vector<int64_t> shape = info.GetShape();
+        size_t item_bytes = info.GetElementCount() / batch_size * ElementSize(info.GetElementType());
+        const char *data = static_cast<const char*>(output.GetTensorRawData());
+        shape[0] = 1;
+        for (int64_t b = 0; b < batch_size; b++) {
+            Ort::Value item = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), info.GetElementType());
+            memcpy(item.GetTensorMutableRawData(), data + b * item_bytes, item_bytes);
+            batch[b]->outputs.emplace_back(std::move(item));
+        }
+    }
+}
+
+} // namespace funasr
@@ -0,0 +1,62 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef SESSION_BATCHER_H
+#define SESSION_BATCHER_H
+
+#include <exception>
+#include <set>
+#include <vector>
+#include "onnxruntime_cxx_api.h"
+#include "batch-queue.h"
+
+namespace funasr {
+
+// Runs a batch-1 onnx call of many streams as one batched run. Run() has the
+// contract of Ort::Session::Run for inputs and outputs whose first dim is the
+// batch: the first caller waits up to max_wait_us for calls of other threads
+// with the same session and the same input shapes (nothing is padded, the fsmn
+// caches of the streaming models are taken from the last frames), stacks their
+// inputs, runs them once and hands every caller a copy of its own outputs.
+// Calls with no company, or of a session that was not given to the constructor
+// or has no batch dim, go straight to the session.
+class SessionBatcher {
+  public:
+    SessionBatcher(int max_batch, int max_wait_us, const std::vector<Ort::Session*> &sessions);
+
+    std::vector<Ort::Value> Run(Ort::Session *session,
+                                const char *const *input_names, Ort::Value *inputs, size_t input_count,
+                                const char *const *output_names, size_t output_count);
+
+  private:
+    struct Request {
+        Ort::Session *session;
+        const char *const *input_names;
+        Ort::Value *inputs;
+        size_t input_count;
+        const char *const *output_names;
+        size_t output_count;
+        // session and input shapes, requests with equal keys can be stacked
+        std::vector<int64_t> key;
+        std::vector<Ort::Value> outputs;
+        std::exception_ptr error;
+        bool done;
+    };
+
+    static bool MakeKey(Ort::Session *session, const Ort::Value *inputs, size_t input_count, std::vector<int64_t> &key);
+    void RunBatch(const std::vector<Request*> &batch);
+    static void RunOne(Request *req);
+
+    // sessions of the constructor whose inputs and outputs have a batch dim
+    std::set<Ort::Session*> batch_sessions_;
+    BatchQueue<Request, std::vector<int64_t>> queue_;
+};
+
+// true if the first dim of every input and output of the session is dynamic,
+// false for e.g. a model exported with batch 1
+bool HasBatchDim(Ort::Session *session);
+
+} // namespace funasr
+#endif
@@ -17,12 +17,6 @@ CTokenizer::CTokenizer():m_ready(false)
 
 CTokenizer::~CTokenizer()
 {
-	if (jieba_dict_trie_){
-		delete jieba_dict_trie_;
-	}
-	if (jieba_model_){
-    	delete jieba_model_;
-	}
 }
 
 void CTokenizer::SetJiebaRes(cppjieba::DictTrie *dict, cppjieba::HMMModel *hmm) {
@@ -32,26 +26,37 @@ void CTokenizer::SetJiebaRes(cppjieba::DictTrie *dict, cppjieba::HMMModel *hmm)
 void CTokenizer::JiebaInit(std::string punc_config){
     if (seg_jieba){
         std::string model_path = punc_config.substr(0, punc_config.length() - (sizeof(PUNC_CONFIG_NAME)-1));
+        ModelBundle::Entry entry;
+        if (ModelBundle::Find(punc_config, entry)) {
+            // the jieba dicts are not bundled, they sit next to the bundle file
+            std::string bundle_file = punc_config.substr(0, punc_config.find_last_of("/\\"));
+            size_t slash = bundle_file.find_last_of("/\\");
+            model_path = slash == std::string::npos ? "." : bundle_file.substr(0, slash);
+        }
         std::string jieba_dict_file = PathAppend(model_path, JIEBA_DICT);
         std::string jieba_hmm_file = PathAppend(model_path, JIEBA_HMM_MODEL);
         std::string jieba_userdict_file = PathAppend(model_path, JIEBA_USERDICT);
 		try{
-        	jieba_dict_trie_ = new cppjieba::DictTrie(jieba_dict_file, jieba_userdict_file);
+        	jieba_dict_trie_ = ModelRegistry::Get<cppjieba::DictTrie>(jieba_dict_file + "|" + jieba_userdict_file, [&]() {
+        		return new cppjieba::DictTrie(jieba_dict_file, jieba_userdict_file);
+        	});
 			LOG(INFO) << "Successfully load file from " << jieba_dict_file << ", " << jieba_userdict_file;
 		}catch(exception const &e){
-			LOG(ERROR) << "Error loading file, Jieba dict file error or not exist.";
+			LOG(ERROR) << "Error loading file, Jieba dict file error or not exist: " << jieba_dict_file;
 			exit(-1);
 		}
 
 		try{
-        	jieba_model_ = new cppjieba::HMMModel(jieba_hmm_file);
+        	jieba_model_ = ModelRegistry::Get<cppjieba::HMMModel>(jieba_hmm_file, [&]() {
+        		return new cppjieba::HMMModel(jieba_hmm_file);
+        	});
 			LOG(INFO) << "Successfully load model from " << jieba_hmm_file;
 		}catch(exception const &e){
-			LOG(ERROR) << "Error loading file, Jieba hmm file error or not exist.";
+			LOG(ERROR) << "Error loading file, Jieba hmm file error or not exist: " << jieba_hmm_file;
 			exit(-1);
 		}
 
-        SetJiebaRes(jieba_dict_trie_, jieba_model_);
+        SetJiebaRes(jieba_dict_trie_.get(), jieba_model_.get());
     }else {
         jieba_dict_trie_ = nullptr;
         jieba_model_ = nullptr;
@@ -81,7 +86,7 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile)
 {
 	YAML::Node m_Config;
 	try{
-		m_Config = YAML::LoadFile(sz_yamlfile);
+		m_Config = ModelBundle::LoadYaml(sz_yamlfile);
 	}catch(exception const &e){
         LOG(INFO) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -131,7 +136,7 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile, const char* token_file)
 {
 	YAML::Node m_Config;
 	try{
-		m_Config = YAML::LoadFile(sz_yamlfile);
+		m_Config = ModelBundle::LoadYaml(sz_yamlfile);
 	}catch(exception const &e){
         LOG(INFO) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -157,19 +162,13 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile, const char* token_file)
 			}
 		}
 
-		nlohmann::json json_array;
-		std::ifstream file(token_file);
-		if (file.is_open()) {
-			file >> json_array;
-			file.close();
-		} else {
+		if (!ModelCache::LoadTokens(token_file, m_id2token)) {
 			LOG(INFO) << "Error loading token file, token file error or not exist.";
 			return  false;
 		}
 
 		int i = 0;
-		for (const auto& element : json_array) {
-			m_id2token.push_back(element);
+		for (const auto& element : m_id2token) {
 			m_token2id[element] = i;
 			i++;
 		}
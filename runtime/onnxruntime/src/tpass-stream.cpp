@@ -3,6 +3,7 @@
 namespace funasr {
 TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thread_num)
 {
+    LoadTimer timer("2pass handle");
     // VAD model
     if(model_path.find(VAD_DIR) != model_path.end()){
         string vad_model_path;
@@ -15,15 +16,16 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         }
         vad_cmvn_path = PathAppend(model_path.at(VAD_DIR), VAD_CMVN_NAME);
         vad_config_path = PathAppend(model_path.at(VAD_DIR), VAD_CONFIG_NAME);
-        if (access(vad_model_path.c_str(), F_OK) != 0 ||
-            access(vad_cmvn_path.c_str(), F_OK) != 0 ||
-            access(vad_config_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(vad_model_path) ||
+            !ModelBundle::Exists(vad_cmvn_path) ||
+            !ModelBundle::Exists(vad_config_path) )
         {
             LOG(INFO) << "VAD model file is not exist, skip load vad model.";
         }else{
             vad_handle = make_unique<FsmnVad>();
             vad_handle->InitVad(vad_model_path, vad_cmvn_path, vad_config_path, thread_num);
             use_vad = true;
+            timer.Mark("vad");
         }
     }
 
@@ -51,11 +53,12 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         bool enable_hotword = false;
         hw_compile_model_path = PathAppend(model_path.at(MODEL_DIR), MODEL_EB_NAME);
         seg_dict_path = PathAppend(model_path.at(MODEL_DIR), MODEL_SEG_DICT);
-        if ((access(hw_compile_model_path.c_str(), F_OK) == 0) && 
-            (access(seg_dict_path.c_str(), F_OK) == 0)) { // if model_eb.onnx exist, hotword enabled
+        if ((ModelBundle::Exists(hw_compile_model_path)) && 
+            (ModelBundle::Exists(seg_dict_path))) { // if model_eb.onnx exist, hotword enabled
           enable_hotword = true;
           asr_handle->InitHwCompiler(hw_compile_model_path, thread_num);
           asr_handle->InitSegDict(seg_dict_path);
+          timer.Mark("hotword");
         }
 
         am_model_path = PathAppend(model_path.at(OFFLINE_MODEL_DIR), MODEL_NAME);
@@ -72,6 +75,7 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         token_path = PathAppend(model_path.at(MODEL_DIR), TOKEN_PATH);
 
         asr_handle->InitAsr(am_model_path, en_model_path, de_model_path, am_cmvn_path, am_config_path, token_path, online_token_path, thread_num);
+        timer.Mark("asr");
     }else{
         LOG(ERROR) <<"Can not find offline-model-dir or online-model-dir";
         exit(-1);
@@ -83,11 +87,12 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         fst_path = PathAppend(model_path.at(LM_DIR), LM_FST_RES);
         lm_config_path = PathAppend(model_path.at(LM_DIR), LM_CONFIG_NAME);
         lex_path = PathAppend(model_path.at(LM_DIR), LEX_PATH);
-        if (access(lex_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(lex_path) )
         {
             LOG(ERROR) << "Lexicon.txt file is not exist, please use the latest version. Skip load LM model.";
         }else{
             asr_handle->InitLm(fst_path, lm_config_path, lex_path);
+            timer.Mark("lm");
         }
     }
 
@@ -104,15 +109,16 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         punc_config_path = PathAppend(model_path.at(PUNC_DIR), PUNC_CONFIG_NAME);
         token_path = PathAppend(model_path.at(PUNC_DIR), TOKEN_PATH);
 
-        if (access(punc_model_path.c_str(), F_OK) != 0 ||
-            access(punc_config_path.c_str(), F_OK) != 0 ||
-            access(token_path.c_str(), F_OK) != 0)
+        if (!ModelBundle::Exists(punc_model_path) ||
+            !ModelBundle::Exists(punc_config_path) ||
+            !ModelBundle::Exists(token_path))
         {
             LOG(INFO) << "PUNC model file is not exist, skip load punc model.";
         }else{
             punc_online_handle = make_unique<CTTransformerOnline>();
             punc_online_handle->InitPunc(punc_model_path, punc_config_path, token_path, thread_num);
             use_punc = true;
+            timer.Mark("punc");
         }
     }
 #if !defined(__APPLE__)
@@ -121,18 +127,19 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
         string itn_tagger_path = PathAppend(model_path.at(ITN_DIR), ITN_TAGGER_NAME);
         string itn_verbalizer_path = PathAppend(model_path.at(ITN_DIR), ITN_VERBALIZER_NAME);
 
-        if (access(itn_tagger_path.c_str(), F_OK) != 0 ||
-            access(itn_verbalizer_path.c_str(), F_OK) != 0 )
+        if (!ModelBundle::Exists(itn_tagger_path) ||
+            !ModelBundle::Exists(itn_verbalizer_path) )
         {
             LOG(INFO) << "ITN model file is not exist, skip load ITN model.";
         }else{
             itn_handle = make_unique<ITNProcessor>();
             itn_handle->InitITN(itn_tagger_path, itn_verbalizer_path, thread_num);
             use_itn = true;
+            timer.Mark("itn");
         }
     }
 #endif
-      
+    timer.Report();
 }
 
 TpassStream *CreateTpassStream(std::map<std::string, std::string>& model_path, int thread_num)
@@ -3,6 +3,7 @@
 namespace funasr {
 VadModel *CreateVadModel(std::map<std::string, std::string>& model_path, int thread_num)
 {
+    LoadTimer timer("Vad handle");
     VadModel *mm;
     mm = new FsmnVad();
 
@@ -18,6 +19,8 @@ VadModel *CreateVadModel(std::map<std::string, std::string>& model_path, int thr
     vad_config_path = PathAppend(model_path.at(MODEL_DIR), VAD_CONFIG_NAME);
 
     mm->InitVad(vad_model_path, vad_cmvn_path, vad_config_path, thread_num);
+    timer.Mark("vad");
+    timer.Report();
     return mm;
 }
 
@@ -1,4 +1,6 @@
 #include "vocab.h"
+#include "model-bundle.h"
+#include "model-cache.h"
 #include <yaml-cpp/yaml.h>
 #include <glog/logging.h>
 
@@ -29,7 +31,7 @@ Vocab::~Vocab()
 void Vocab::LoadVocabFromYaml(const char* filename){
     YAML::Node config;
     try{
-        config = YAML::LoadFile(filename);
+        config = ModelBundle::LoadYaml(filename);
     }catch(exception const &e){
         LOG(INFO) << "Error loading file, yaml file error or not exist.";
         exit(-1);
@@ -44,28 +46,26 @@ void Vocab::LoadVocabFromYaml(const char* filename){
 }
 
 void Vocab::LoadVocabFromJson(const char* filename){
-    nlohmann::json json_array;
-    std::ifstream file(filename);
-    if (file.is_open()) {
-        file >> json_array;
-        file.close();
-    } else {
+    if (!ModelCache::LoadTokens(filename, vocab)) {
         LOG(INFO) << "Error loading token file, token file error or not exist.";
         exit(-1);
     }
 
     int i = 0;
-    for (const auto& element : json_array) {
-        vocab.push_back(element);
+    for (const auto& element : vocab) {
         token_id[element] = i;
         i++;
     }
 }
 
 void Vocab::LoadLex(const char* filename){
-    std::ifstream file(filename);
+    std::unique_ptr<std::istream> file = ModelBundle::OpenStream(filename);
+    if (!file) {
+        LOG(ERROR) << "Failed to open lexicon " << filename;
+        return;
+    }
     std::string line;
-    while (std::getline(file, line)) {
+    while (std::getline(*file, line)) {
         std::string key, value;
         std::istringstream iss(line);
         std::getline(iss, key, '\t');
@@ -75,8 +75,6 @@ void Vocab::LoadLex(const char* filename){
             lex_map[key] = value;
         }
     }
-
-    file.close();
 }
 
 string Vocab::Word2Lex(const std::string &word) const {
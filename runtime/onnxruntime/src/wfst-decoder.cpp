@@ -2,9 +2,10 @@
 namespace funasr {
 WfstDecoder::WfstDecoder(fst::Fst<fst::StdArc>* lm,
                          PhoneSet* phone_set, Vocab* vocab,
-                         float glob_beam, float lat_beam, float am_scale)
+                         float glob_beam, float lat_beam, float am_scale,
+                         HotwordCache<BiasLm>* bias_lm_cache)
 :dec_opts_(glob_beam, lat_beam, am_scale), decodable_(dec_opts_.acoustic_scale),
- lm_(lm), phone_set_(phone_set), vocab_(vocab) {
+ lm_(lm), phone_set_(phone_set), vocab_(vocab), bias_lm_cache_(bias_lm_cache) {
   decoder_ = std::shared_ptr<kaldi::LatticeFasterOnlineDecoder>(
              new kaldi::LatticeFasterOnlineDecoder(*lm_, dec_opts_));
 }
@@ -94,8 +95,14 @@ string WfstDecoder::FinalizeDecode(bool is_stamp, std::vector<float> us_alphas,
 void WfstDecoder::LoadHwsRes(int inc_bias, unordered_map<string, int> &hws_map) {
   try {
     if (!hws_map.empty()) {
-      bias_lm_ = std::make_shared<BiasLm>(hws_map, inc_bias,
-                                          *phone_set_, *vocab_);
+      auto build = [&]() {
+        return std::make_shared<BiasLm>(hws_map, inc_bias, *phone_set_, *vocab_);
+      };
+      if (bias_lm_cache_) {
+        bias_lm_ = bias_lm_cache_->Get(NormalizeHotwords(hws_map, inc_bias), build);
+      } else {
+        bias_lm_ = build();
+      }
       decoder_->SetBiasLm(bias_lm_);
     }
   } catch (std::exception const &e) {
@@ -0,0 +1,117 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+// Checks that every inner loop of ApplyLfrCmvn this cpu can run gives
+// bit-identical results to the scalar one, and that the scalar one matches a
+// frame by frame lfr + cmvn, over odd dims, partial cmvn and the edge padding
+// of the first and last frames.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lfr-cmvn.h"
+
+using namespace funasr;
+
+struct LfrCase {
+    int num_frames;
+    int in_dim;
+    int lfr_m;
+    int lfr_n;
+    int left_pad;
+    int cmvn_dim;
+    int num_out;
+};
+
+static std::vector<float> Reference(const std::vector<float> &in, const LfrCase &c,
+                                    const std::vector<float> &means, const std::vector<float> &vars)
+{
+    int out_dim = c.lfr_m * c.in_dim;
+    std::vector<float> out((size_t)c.num_out * out_dim);
+    for (int i = 0; i < c.num_out; i++) {
+        for (int j = 0; j < c.lfr_m; j++) {
+            int idx = std::min(std::max(i * c.lfr_n + j - c.left_pad, 0), c.num_frames - 1);
+            for (int k = 0; k < c.in_dim; k++) {
+                float x = in[(size_t)idx * c.in_dim + k];
+                int col = j * c.in_dim + k;
+                if (col < c.cmvn_dim) {
+                    x = (x + means[col]) * vars[col];
+                }
+                out[(size_t)i * out_dim + col] = x;
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<float> Apply(const std::vector<float> &in, const LfrCase &c,
+                                const std::vector<float> &means, const std::vector<float> &vars)
+{
+    std::vector<float> out((size_t)c.num_out * c.lfr_m * c.in_dim, NAN);
+    ApplyLfrCmvn(in.data(), c.num_frames, c.in_dim, c.lfr_m, c.lfr_n, c.left_pad,
+                 means, vars, out.data(), c.num_out);
+    return out;
+}
+
+int main()
+{
+    std::vector<LfrCase> cases;
+    for (int in_dim : {80, 1, 7, 15, 16, 17, 33}) {
+        for (int num_frames : {1, 2, 5, 37}) {
+            // paraformer (7, 6, 3), no lfr, and a left pad past the first frame
+            cases.push_back({num_frames, in_dim, 7, 6, 3, 7 * in_dim, (num_frames + 5) / 6});
+            cases.push_back({num_frames, in_dim, 1, 1, 0, in_dim, num_frames});
+            cases.push_back({num_frames, in_dim, 5, 3, 9, 5 * in_dim, num_frames / 3 + 4});
+            // cmvn over part of the columns, ending inside a frame
+            cases.push_back({num_frames, in_dim, 7, 6, 3, 3 * in_dim + in_dim / 2, (num_frames + 5) / 6 + 2});
+            cases.push_back({num_frames, in_dim, 3, 2, 1, 0, num_frames / 2 + 1});
+        }
+    }
+
+    std::vector<std::string> isas;
+    for (const char *isa : {"avx512f", "avx2", "neon"}) {
+        if (SetLfrCmvnIsa(isa)) {
+            isas.emplace_back(isa);
+        } else {
+            std::cout << isa << " not supported, skipped" << std::endl;
+        }
+    }
+
+    int ret = 0;
+    for (size_t n = 0; n < cases.size(); n++) {
+        const LfrCase &c = cases[n];
+        std::vector<float> in((size_t)c.num_frames * c.in_dim);
+        for (size_t i = 0; i < in.size(); i++) {
+            in[i] = 17 * std::sin(i * 0.37f + n) + (i % 11) * 0.125f;
+        }
+        std::vector<float> means(c.cmvn_dim), vars(c.cmvn_dim);
+        for (int k = 0; k < c.cmvn_dim; k++) {
+            means[k] = -3 * std::cos(k * 0.11f) - 8.5f;
+            vars[k] = 0.31f + 0.07f * std::sin(k * 0.23f);
+        }
+
+        SetLfrCmvnIsa("scalar");
+        std::vector<float> expected = Apply(in, c, means, vars);
+        if (expected != Reference(in, c, means, vars)) {
+            std::cerr << "case " << n << ": scalar differs from the reference" << std::endl;
+            ret = 1;
+        }
+        for (const std::string &isa : isas) {
+            SetLfrCmvnIsa(isa);
+            std::vector<float> out = Apply(in, c, means, vars);
+            if (memcmp(out.data(), expected.data(), out.size() * sizeof(float)) != 0) {
+                std::cerr << "case " << n << ": " << isa << " is not bit-identical to scalar" << std::endl;
+                ret = 1;
+            }
+        }
+    }
+    SetLfrCmvnIsa("");
+    std::cout << cases.size() << " cases, runtime pick " << LfrCmvnIsa() << std::endl;
+    return ret;
+}
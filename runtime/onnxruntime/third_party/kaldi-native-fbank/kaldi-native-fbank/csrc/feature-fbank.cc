@@ -117,4 +117,76 @@ void FbankComputer::Compute(float signal_raw_log_energy, float vtln_warp,
   }
 }
 
+void FbankComputer::ComputeFrames(int32_t num_frames,
+                                  const float *signal_raw_log_energy,
+                                  float vtln_warp, float *signal_frames,
+                                  float *const *features) {
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+  const int32_t block_size = MelBanks::kBlockSize;
+  int32_t padded_size = opts_.frame_opts.PaddedWindowSize();
+  int32_t half_dim = padded_size / 2;
+  int32_t num_bins = opts_.mel_opts.num_bins;
+  int32_t mel_offset = ((opts_.use_energy && !opts_.htk_compat) ? 1 : 0);
+  int32_t energy_index = opts_.htk_compat ? num_bins : 0;
+
+  block_power_.resize((half_dim + 1) * block_size);
+  float *power = block_power_.data();
+  float *mel_energies[block_size];
+
+  for (int32_t start = 0; start < num_frames; start += block_size) {
+    int32_t n = std::min(block_size, num_frames - start);
+
+    for (int32_t f = 0; f != n; ++f) {
+      float *frame = signal_frames + (start + f) * padded_size;
+      float *feature = features[start + f];
+      mel_energies[f] = feature + mel_offset;
+
+      if (opts_.use_energy) {
+        float log_energy = 0;
+        if (opts_.raw_energy) {
+          log_energy = signal_raw_log_energy[start + f];
+        } else {
+          // Compute energy after window function (not the raw one).
+          log_energy = std::log(
+              std::max<float>(InnerProduct(frame, frame, padded_size),
+                              std::numeric_limits<float>::epsilon()));
+        }
+        if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_) {
+          log_energy = log_energy_floor_;
+        }
+        feature[energy_index] = log_energy;
+      }
+
+      // The fft stays per frame: fftsg transforms one sequence at a time,
+      // and a multi-frame fft would have to replace it.
+      rfft_.Compute(frame);  // frame is modified in-place
+
+      // Power spectrum as in ComputePowerSpectrum(), stored as column f
+      power[f] = frame[0] * frame[0];
+      power[half_dim * block_size + f] = frame[1] * frame[1];
+      for (int32_t i = 1; i < half_dim; ++i) {
+        float real = frame[i * 2];
+        float im = frame[i * 2 + 1];
+        power[i * block_size + f] = real * real + im * im;
+      }
+    }
+
+    // Use magnitude instead of power if requested, the columns past n hold
+    // the spectra of the previous block and are ignored.
+    if (!opts_.use_power) {
+      Sqrt(power, (half_dim + 1) * block_size);
+    }
+
+    // Sum with mel filter banks over the power spectrum
+    mel_banks.ComputeBlock(power, n, mel_energies);
+
+    if (opts_.use_log_fbank) {
+      // Avoid log of zero (which should be prevented anyway by dithering).
+      for (int32_t f = 0; f != n; ++f) {
+        LogWithFloor(mel_energies[f], num_bins);
+      }
+    }
+  }
+}
+
 }  // namespace knf
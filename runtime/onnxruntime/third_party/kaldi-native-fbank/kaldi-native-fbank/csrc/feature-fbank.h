@@ -120,6 +120,26 @@ class FbankComputer {
   void Compute(float signal_raw_log_energy, float vtln_warp,
                std::vector<float> *signal_frame, float *feature);
 
+  /**
+     Same as Compute(), for num_frames frames at once. The frames are
+     transformed one at a time, and the mel banks and log are applied to a
+     block of MelBanks::kBlockSize frames at once with the WeightedSum8() and
+     LogWithFloor() variants of this cpu. The mel energies are bit-identical
+     to Compute(), the log is within 1e-7 relative of std::log.
+
+     @param [in] num_frames  Number of frames
+     @param [in] signal_raw_log_energy  Array of size num_frames, may be
+         nullptr if this->NeedRawLogEnergy() is false.
+     @param [in] vtln_warp  See Compute().
+     @param [in] signal_frames  2-D array of size num_frames x
+         PaddedWindowSize(), used as a workspace.
+     @param [out] features  features[f] is the array of size this->Dim() of
+         frame f.
+  */
+  void ComputeFrames(int32_t num_frames, const float *signal_raw_log_energy,
+                     float vtln_warp, float *signal_frames,
+                     float *const *features);
+
  private:
   const MelBanks *GetMelBanks(float vtln_warp);
 
@@ -127,6 +147,8 @@ class FbankComputer {
   float log_energy_floor_;
   std::map<float, MelBanks *> mel_banks_;  // float is VTLN coefficient.
   Rfft rfft_;
+  // power spectra of one block, (num_fft_bins/2+1) x MelBanks::kBlockSize
+  std::vector<float> block_power_;
 };
 
 }  // namespace knf
@@ -20,9 +20,30 @@
 
 #include "kaldi-native-fbank/csrc/feature-functions.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KNF_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KNF_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The variants of WeightedSum8() and LogWithFloor() must round the same, so
+// the compiler may not fuse their multiplies and adds into fma, which the
+// avx512f target and -march builds would allow.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
 namespace knf {
 
 void ComputePowerSpectrum(std::vector<float> *complex_fft) {
@@ -46,4 +67,293 @@ void ComputePowerSpectrum(std::vector<float> *complex_fft) {
   // if the signal has been bandlimited sensibly this should be zero.
 }
 
+// Constants of the cephes logf. Every variant below runs the same operations
+// in the same order, without fma, so they give the same bits.
+static const float kSqrtHalf = 0.707106781186547524f;
+static const float kLogP0 = 7.0376836292e-2f;
+static const float kLogP1 = -1.1514610310e-1f;
+static const float kLogP2 = 1.1676998740e-1f;
+static const float kLogP3 = -1.2420140846e-1f;
+static const float kLogP4 = 1.4249322787e-1f;
+static const float kLogP5 = -1.6668057665e-1f;
+static const float kLogP6 = 2.0000714765e-1f;
+static const float kLogP7 = -2.4999993993e-1f;
+static const float kLogP8 = 3.3333331174e-1f;
+static const float kLogQ1 = -2.12194440e-4f;
+static const float kLogQ2 = 0.693359375f;
+
+static float LogWithFloorScalar(float x) {
+  float floor = std::numeric_limits<float>::epsilon();
+  x = x > floor ? x : floor;
+
+  // x = m * 2^e with m in [0.5, 1)
+  int32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  float e = static_cast<float>((bits >> 23) - 126);
+  bits = (bits & 0x807fffff) | 0x3f000000;
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+
+  // m in [sqrt(0.5), sqrt(2)) - 1
+  bool below = m < kSqrtHalf;
+  e = e - (below ? 1.0f : 0.0f);
+  m = (m - 1.0f) + (below ? m : 0.0f);
+
+  float z = m * m;
+  float y = kLogP0;
+  y = y * m + kLogP1;
+  y = y * m + kLogP2;
+  y = y * m + kLogP3;
+  y = y * m + kLogP4;
+  y = y * m + kLogP5;
+  y = y * m + kLogP6;
+  y = y * m + kLogP7;
+  y = y * m + kLogP8;
+  y = y * m;
+  y = y * z;
+  y = y + e * kLogQ1;
+  y = y - z * 0.5f;
+  float r = m + y;
+  return r + e * kLogQ2;
+}
+
+static void WeightedSum8Scalar(const float *weights, int32_t size,
+                               const float *columns, float *sums) {
+  float acc[8] = {0};
+  for (int32_t k = 0; k != size; ++k) {
+    const float *col = columns + k * 8;
+    for (int32_t f = 0; f != 8; ++f) {
+      acc[f] += weights[k] * col[f];
+    }
+  }
+  std::copy(acc, acc + 8, sums);
+}
+
+static void LogWithFloorScalar(float *x, int32_t n) {
+  for (int32_t i = 0; i != n; ++i) {
+    x[i] = LogWithFloorScalar(x[i]);
+  }
+}
+
+#if defined(KNF_X86)
+__attribute__((target("avx2"))) static void WeightedSum8Avx2(
+    const float *weights, int32_t size, const float *columns, float *sums) {
+  __m256 acc = _mm256_setzero_ps();
+  for (int32_t k = 0; k != size; ++k) {
+    __m256 prod = _mm256_mul_ps(_mm256_set1_ps(weights[k]),
+                                _mm256_loadu_ps(columns + k * 8));
+    acc = _mm256_add_ps(acc, prod);
+  }
+  _mm256_storeu_ps(sums, acc);
+}
+
+__attribute__((target("avx2"))) static inline __m256 LogWithFloorAvx2(
+    __m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  x = _mm256_max_ps(x, _mm256_set1_ps(std::numeric_limits<float>::epsilon()));
+
+  __m256i bits = _mm256_castps_si256(x);
+  __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+      _mm256_srai_epi32(bits, 23), _mm256_set1_epi32(126)));
+  bits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)),
+                         _mm256_set1_epi32(0x3f000000));
+  __m256 m = _mm256_castsi256_ps(bits);
+
+  __m256 below = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(one, below));
+  m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(m, below));
+
+  __m256 z = _mm256_mul_ps(m, m);
+  __m256 y = _mm256_set1_ps(kLogP0);
+  for (float p : {kLogP1, kLogP2, kLogP3, kLogP4, kLogP5, kLogP6, kLogP7,
+                  kLogP8}) {
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(p));
+  }
+  y = _mm256_mul_ps(y, m);
+  y = _mm256_mul_ps(y, z);
+  y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(kLogQ1)));
+  y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  __m256 r = _mm256_add_ps(m, y);
+  return _mm256_add_ps(r, _mm256_mul_ps(e, _mm256_set1_ps(kLogQ2)));
+}
+
+__attribute__((target("avx2"))) static void LogWithFloorAvx2(float *x,
+                                                              int32_t n) {
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(x + i, LogWithFloorAvx2(_mm256_loadu_ps(x + i)));
+  }
+  for (; i < n; ++i) {
+    x[i] = LogWithFloorScalar(x[i]);
+  }
+}
+
+__attribute__((target("avx512f"))) static void LogWithFloorAvx512(float *x,
+                                                                  int32_t n) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  for (int32_t i = 0; i < n; i += 16) {
+    __mmask16 mask =
+        n - i >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (n - i)) - 1);
+    // the maskz forms zero the lanes past n, the plain ones leave them
+    // undefined, which gcc reports as maybe uninitialized
+    __m512 v = _mm512_maskz_loadu_ps(mask, x + i);
+    v = _mm512_maskz_max_ps(
+        mask, v, _mm512_set1_ps(std::numeric_limits<float>::epsilon()));
+
+    __m512i bits = _mm512_castps_si512(v);
+    __m512 e = _mm512_maskz_cvtepi32_ps(
+        mask, _mm512_sub_epi32(_mm512_maskz_srai_epi32(mask, bits, 23),
+                               _mm512_set1_epi32(126)));
+    bits = _mm512_or_si512(
+        _mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)),
+        _mm512_set1_epi32(0x3f000000));
+    __m512 m = _mm512_castsi512_ps(bits);
+
+    __mmask16 below =
+        _mm512_cmp_ps_mask(m, _mm512_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+    e = _mm512_mask_sub_ps(e, below, e, one);
+    m = _mm512_mask_add_ps(_mm512_sub_ps(m, one), below, _mm512_sub_ps(m, one),
+                           m);
+
+    __m512 z = _mm512_mul_ps(m, m);
+    __m512 y = _mm512_set1_ps(kLogP0);
+    for (float p : {kLogP1, kLogP2, kLogP3, kLogP4, kLogP5, kLogP6, kLogP7,
+                    kLogP8}) {
+      y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(p));
+    }
+    y = _mm512_mul_ps(y, m);
+    y = _mm512_mul_ps(y, z);
+    y = _mm512_add_ps(y, _mm512_mul_ps(e, _mm512_set1_ps(kLogQ1)));
+    y = _mm512_sub_ps(y, _mm512_mul_ps(z, _mm512_set1_ps(0.5f)));
+    __m512 r = _mm512_add_ps(m, y);
+    r = _mm512_add_ps(r, _mm512_mul_ps(e, _mm512_set1_ps(kLogQ2)));
+    _mm512_mask_storeu_ps(x + i, mask, r);
+  }
+}
+#endif
+
+#if defined(KNF_NEON)
+static void WeightedSum8Neon(const float *weights, int32_t size,
+                             const float *columns, float *sums) {
+  float32x4_t acc0 = vdupq_n_f32(0);
+  float32x4_t acc1 = vdupq_n_f32(0);
+  for (int32_t k = 0; k != size; ++k) {
+    float32x4_t w = vdupq_n_f32(weights[k]);
+    acc0 = vaddq_f32(acc0, vmulq_f32(w, vld1q_f32(columns + k * 8)));
+    acc1 = vaddq_f32(acc1, vmulq_f32(w, vld1q_f32(columns + k * 8 + 4)));
+  }
+  vst1q_f32(sums, acc0);
+  vst1q_f32(sums + 4, acc1);
+}
+
+static inline float32x4_t LogWithFloorNeon(float32x4_t x) {
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  float32x4_t floor = vdupq_n_f32(std::numeric_limits<float>::epsilon());
+  x = vbslq_f32(vcgtq_f32(x, floor), x, floor);
+
+  int32x4_t bits = vreinterpretq_s32_f32(x);
+  float32x4_t e = vcvtq_f32_s32(vsubq_s32(vshrq_n_s32(bits, 23),
+                                          vdupq_n_s32(126)));
+  bits = vorrq_s32(vandq_s32(bits, vdupq_n_s32(0x807fffff)),
+                   vdupq_n_s32(0x3f000000));
+  float32x4_t m = vreinterpretq_f32_s32(bits);
+
+  uint32x4_t below = vcltq_f32(m, vdupq_n_f32(kSqrtHalf));
+  e = vsubq_f32(e, vreinterpretq_f32_u32(
+                       vandq_u32(vreinterpretq_u32_f32(one), below)));
+  m = vaddq_f32(vsubq_f32(m, one),
+                vreinterpretq_f32_u32(
+                    vandq_u32(vreinterpretq_u32_f32(m), below)));
+
+  float32x4_t z = vmulq_f32(m, m);
+  float32x4_t y = vdupq_n_f32(kLogP0);
+  for (float p : {kLogP1, kLogP2, kLogP3, kLogP4, kLogP5, kLogP6, kLogP7,
+                  kLogP8}) {
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(p));
+  }
+  y = vmulq_f32(y, m);
+  y = vmulq_f32(y, z);
+  y = vaddq_f32(y, vmulq_f32(e, vdupq_n_f32(kLogQ1)));
+  y = vsubq_f32(y, vmulq_f32(z, vdupq_n_f32(0.5f)));
+  float32x4_t r = vaddq_f32(m, y);
+  return vaddq_f32(r, vmulq_f32(e, vdupq_n_f32(kLogQ2)));
+}
+
+static void LogWithFloorNeon(float *x, int32_t n) {
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(x + i, LogWithFloorNeon(vld1q_f32(x + i)));
+  }
+  for (; i < n; ++i) {
+    x[i] = LogWithFloorScalar(x[i]);
+  }
+}
+#endif
+
+namespace {
+
+struct FeatureFunctionsImpl {
+  void (*weighted_sum8)(const float *, int32_t, const float *, float *);
+  void (*log_with_floor)(float *, int32_t);
+  const char *name;
+};
+
+// the variants this cpu can run, best first, scalar last
+std::vector<FeatureFunctionsImpl> SupportedImpls() {
+  std::vector<FeatureFunctionsImpl> impls;
+#if defined(KNF_X86)
+  __builtin_cpu_init();
+  // a block of 8 frames is one avx2 register, avx512f only widens the log
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")) {
+    impls.push_back({WeightedSum8Avx2, LogWithFloorAvx512, "avx512f"});
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    impls.push_back({WeightedSum8Avx2, LogWithFloorAvx2, "avx2"});
+  }
+#elif defined(KNF_NEON)
+  impls.push_back({WeightedSum8Neon, LogWithFloorNeon, "neon"});
+#endif
+  impls.push_back({WeightedSum8Scalar, LogWithFloorScalar, "scalar"});
+  return impls;
+}
+
+const std::vector<FeatureFunctionsImpl> &Impls() {
+  static const std::vector<FeatureFunctionsImpl> impls = SupportedImpls();
+  return impls;
+}
+
+// set by SetFeatureFunctionsIsa(), nullptr for the runtime pick
+std::atomic<const FeatureFunctionsImpl *> forced_impl(nullptr);
+
+const FeatureFunctionsImpl &GetImpl() {
+  const FeatureFunctionsImpl *forced =
+      forced_impl.load(std::memory_order_acquire);
+  return forced ? *forced : Impls()[0];
+}
+
+}  // namespace
+
+void WeightedSum8(const float *weights, int32_t size, const float *columns,
+                  float *sums) {
+  GetImpl().weighted_sum8(weights, size, columns, sums);
+}
+
+void LogWithFloor(float *x, int32_t n) { GetImpl().log_with_floor(x, n); }
+
+const char *FeatureFunctionsIsa() { return GetImpl().name; }
+
+bool SetFeatureFunctionsIsa(const std::string &isa) {
+  if (isa.empty()) {
+    forced_impl.store(nullptr, std::memory_order_release);
+    return true;
+  }
+  for (const FeatureFunctionsImpl &impl : Impls()) {
+    if (isa == impl.name) {
+      forced_impl.store(&impl, std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace knf
@@ -20,6 +20,8 @@
 #ifndef KALDI_NATIVE_FBANK_CSRC_FEATURE_FUNCTIONS_H_
 #define KALDI_NATIVE_FBANK_CSRC_FEATURE_FUNCTIONS_H_
 
+#include <cstdint>
+#include <string>
 #include <vector>
 namespace knf {
 
@@ -33,6 +35,25 @@ namespace knf {
 
 void ComputePowerSpectrum(std::vector<float> *complex_fft);
 
+// sums[f] = sum_k weights[k] * columns[k * 8 + f] for f in [0, 8), every sum
+// accumulated in order of k with a separate multiply and add, so it is
+// bit-identical to a scalar loop over one column.
+void WeightedSum8(const float *weights, int32_t size, const float *columns,
+                  float *sums);
+
+// x[i] = log(max(x[i], epsilon)) for i in [0, n). Uses the cephes
+// polynomial, within 1e-7 relative of std::log, the same in every variant.
+void LogWithFloor(float *x, int32_t n);
+
+// WeightedSum8() and LogWithFloor() are picked at runtime
+// (avx512f/avx2/neon/scalar). Name of the selected variant, for logging.
+const char *FeatureFunctionsIsa();
+
+// Forces the variant to isa ("avx512f", "avx2", "neon" or "scalar") so they
+// can be compared, "" goes back to the runtime pick. false if this cpu can
+// not run isa.
+bool SetFeatureFunctionsIsa(const std::string &isa);
+
 }  // namespace knf
 
 #endif  // KALDI_NATIVE_FBANK_CSRC_FEATURE_FUNCTIONS_H_
@@ -123,6 +123,18 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
                    const FeatureWindowFunction &window_function,
                    std::vector<float> *window,
                    float *log_energy_pre_window /*= nullptr*/) {
+  int32_t frame_length_padded = opts.PaddedWindowSize();
+  if (window->size() != frame_length_padded) {
+    window->resize(frame_length_padded);
+  }
+  ExtractWindow(sample_offset, wave, f, opts, window_function, window->data(),
+                log_energy_pre_window);
+}
+
+void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
+                   int32_t f, const FrameExtractionOptions &opts,
+                   const FeatureWindowFunction &window_function, float *window,
+                   float *log_energy_pre_window /*= nullptr*/) {
   KNF_CHECK(sample_offset >= 0 && wave.size() != 0);
 
   int32_t frame_length = opts.WindowSize();
@@ -138,9 +150,7 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
     KNF_CHECK(sample_offset == 0 || start_sample >= sample_offset);
   }
 
-  if (window->size() != frame_length_padded) {
-    window->resize(frame_length_padded);
-  }
+  std::fill(window + frame_length, window + frame_length_padded, 0);
 
   // wave_start and wave_end are start and end indexes into 'wave', for the
   // piece of wave that we're trying to extract.
@@ -150,7 +160,7 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
   if (wave_start >= 0 && wave_end <= wave.size()) {
     // the normal case-- no edge effects to consider.
     std::copy(wave.begin() + wave_start,
-              wave.begin() + wave_start + frame_length, window->data());
+              wave.begin() + wave_start + frame_length, window);
   } else {
     // Deal with any end effects by reflection, if needed.  This code will only
     // be reached for about two frames per utterance, so we don't concern
@@ -169,11 +179,11 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
         else
           s_in_wave = 2 * wave_dim - 1 - s_in_wave;
       }
-      (*window)[s] = wave[s_in_wave];
+      window[s] = wave[s_in_wave];
     }
   }
 
-  ProcessWindow(opts, window_function, window->data(), log_energy_pre_window);
+  ProcessWindow(opts, window_function, window, log_energy_pre_window);
 }
 
 static void RemoveDcOffset(float *d, int32_t n) {
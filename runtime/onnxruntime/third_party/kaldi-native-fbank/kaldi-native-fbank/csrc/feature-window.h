@@ -149,6 +149,13 @@ void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
                    std::vector<float> *window,
                    float *log_energy_pre_window = nullptr);
 
+// Same as above, writes the window to window[0, opts.PaddedWindowSize()),
+// the samples past opts.WindowSize() are set to zero.
+void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
+                   int32_t f, const FrameExtractionOptions &opts,
+                   const FeatureWindowFunction &window_function, float *window,
+                   float *log_energy_pre_window = nullptr);
+
 /**
   This function does all the windowing steps after actually
   extracting the windowed signal: depending on the
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <vector>
 
+#include "kaldi-native-fbank/csrc/feature-functions.h"
 #include "kaldi-native-fbank/csrc/feature-window.h"
 
 namespace knf {
@@ -209,6 +210,14 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
     }
   }  // for (int32_t bin = 0; bin < num_bins; ++bin) {
 
+  band_starts_.resize(num_bins + 1, 0);
+  for (int32_t bin = 0; bin < num_bins; ++bin) {
+    band_starts_[bin] = band_weights_.size();
+    band_weights_.insert(band_weights_.end(), bins_[bin].second.begin(),
+                         bins_[bin].second.end());
+  }
+  band_starts_[num_bins] = band_weights_.size();
+
   if (debug_) {
     std::ostringstream os;
     for (size_t i = 0; i < bins_.size(); i++) {
@@ -254,4 +263,38 @@ void MelBanks::Compute(const float *power_spectrum,
   }
 }
 
+constexpr int32_t MelBanks::kBlockSize;
+
+void MelBanks::ComputeBlock(const float *power_spectra, int32_t num_frames,
+                            float *const *mel_energies_out) const {
+  static_assert(kBlockSize == 8, "WeightedSum8() sums blocks of 8 frames");
+  int32_t num_bins = bins_.size();
+
+  for (int32_t i = 0; i < num_bins; i++) {
+    const float *v = band_weights_.data() + band_starts_[i];
+    int32_t size = band_starts_[i + 1] - band_starts_[i];
+    float energy[kBlockSize];
+    WeightedSum8(v, size, power_spectra + bins_[i].first * kBlockSize, energy);
+
+    for (int32_t f = 0; f != num_frames; ++f) {
+      // HTK-like flooring- for testing purposes (we prefer dither)
+      if (htk_mode_ && energy[f] < 1.0) {
+        energy[f] = 1.0;
+      }
+      mel_energies_out[f][i] = energy[f];
+    }
+  }
+
+#if KNF_ENABLE_CHECK
+  // once per block instead of per bin, a nan anywhere makes the sum nan
+  float sum = 0;
+  for (int32_t f = 0; f != num_frames; ++f) {
+    for (int32_t i = 0; i < num_bins; i++) {
+      sum += mel_energies_out[f][i];
+    }
+  }
+  KNF_CHECK_EQ(sum, sum);  // check that energy is not nan
+#endif
+}
+
 }  // namespace knf
@@ -96,6 +96,23 @@ class MelBanks {
   /// @param mel_energies_out  1-D array of size num_mel_bins
   void Compute(const float *fft_energies, float *mel_energies_out) const;
 
+  // Number of frames handled together by ComputeBlock()
+  static constexpr int32_t kBlockSize = 8;
+
+  /// Compute Mel energies (note: not log energies) of up to kBlockSize frames.
+  /// The bands are stored packed and summed over the whole block by
+  /// WeightedSum8(), which every frame accumulates in the same order as
+  /// Compute(), so the result is bit-identical.
+  ///
+  /// @param fft_energies 2-D array of size (num_fft_bins/2+1) x kBlockSize,
+  ///                     column f is the power spectrum of frame f.
+  ///                     Columns >= num_frames are ignored.
+  /// @param num_frames  Number of frames in the block, <= kBlockSize
+  /// @param mel_energies_out  mel_energies_out[f] is the 1-D array of size
+  ///                          num_mel_bins of frame f
+  void ComputeBlock(const float *fft_energies, int32_t num_frames,
+                    float *const *mel_energies_out) const;
+
   int32_t NumBins() const { return bins_.size(); }
 
  private:
@@ -107,6 +124,11 @@ class MelBanks {
   // (the first nonzero fft-bin), (the vector of weights).
   std::vector<std::pair<int32_t, std::vector<float>>> bins_;
 
+  // bins_ packed for ComputeBlock(): the weights of bin i are
+  // band_weights_[band_starts_[i], band_starts_[i+1])
+  std::vector<int32_t> band_starts_;
+  std::vector<float> band_weights_;
+
   // TODO(fangjun): Remove debug_ and htk_mode_
   bool debug_;
   bool htk_mode_;
@@ -116,20 +116,35 @@ void OnlineGenericBaseFeature<C>::ComputeFeatures() {
   // note: this online feature-extraction code does not support VTLN.
   float vtln_warp = 1.0;
 
-  std::vector<float> window;
-  bool need_raw_log_energy = computer_.NeedRawLogEnergy();
-
-  for (int32_t frame = num_frames_old; frame < num_frames_new; ++frame) {
-    std::fill(window.begin(), window.end(), 0);
-    float raw_log_energy = 0.0;
-    ExtractWindow(waveform_offset_, waveform_remainder_, frame, frame_opts,
-                  window_function_, &window,
-                  need_raw_log_energy ? &raw_log_energy : nullptr);
+  int32_t num_frames = num_frames_new - num_frames_old;
+  if (num_frames > 0) {
+    int32_t padded_size = frame_opts.PaddedWindowSize();
+    int32_t dim = computer_.Dim();
+    bool need_raw_log_energy = computer_.NeedRawLogEnergy();
+
+    // extract all the new windows first, then compute them as one batch
+    // straight into the feature vectors that are kept
+    frames_.resize(num_frames * padded_size);
+    std::vector<float> raw_log_energies(num_frames, 0.0);
+    for (int32_t f = 0; f != num_frames; ++f) {
+      ExtractWindow(waveform_offset_, waveform_remainder_, num_frames_old + f,
+                    frame_opts, window_function_,
+                    frames_.data() + f * padded_size,
+                    need_raw_log_energy ? &raw_log_energies[f] : nullptr);
+    }
 
-    std::vector<float> this_feature(computer_.Dim());
+    std::vector<std::vector<float>> features(num_frames,
+                                             std::vector<float>(dim));
+    std::vector<float *> rows(num_frames);
+    for (int32_t f = 0; f != num_frames; ++f) {
+      rows[f] = features[f].data();
+    }
+    computer_.ComputeFrames(num_frames, raw_log_energies.data(), vtln_warp,
+                            frames_.data(), rows.data());
 
-    computer_.Compute(raw_log_energy, vtln_warp, &window, this_feature.data());
-    features_.PushBack(std::move(this_feature));
+    for (int32_t f = 0; f != num_frames; ++f) {
+      features_.PushBack(std::move(features[f]));
+    }
   }
 
   // OK, we will now discard any portion of the signal that will not be
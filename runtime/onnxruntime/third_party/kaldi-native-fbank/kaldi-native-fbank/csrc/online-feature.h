@@ -133,6 +133,10 @@ class OnlineGenericBaseFeature {
   // will be required for the next phase of computation).
   // It is a 1-D tensor
   std::vector<float> waveform_remainder_;
+
+  // windows of the frames computed by one ComputeFeatures() call, kept to
+  // reuse the allocation
+  std::vector<float> frames_;
 };
 
 using OnlineFbank = OnlineGenericBaseFeature<FbankComputer>;
@@ -16,10 +16,64 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
+#include "kaldi-native-fbank/csrc/feature-functions.h"
+#include "kaldi-native-fbank/csrc/feature-window.h"
 #include "kaldi-native-fbank/csrc/online-feature.h"
 
+// OnlineFbank computes its frames with FbankComputer::ComputeFrames(), this
+// is the max relative difference to FbankComputer::Compute() applied frame by
+// frame.
+static float MaxRelativeDiff(const knf::FbankOptions &opts,
+                             const std::vector<float> &samples,
+                             int32_t chunk_size) {
+  // reference, one frame at a time
+  knf::FbankComputer computer(opts);
+  knf::FeatureWindowFunction window_function(opts.frame_opts);
+  int32_t num_frames = knf::NumFrames(samples.size(), opts.frame_opts);
+  std::vector<std::vector<float>> expected(num_frames);
+  std::vector<float> window;
+  for (int32_t f = 0; f != num_frames; ++f) {
+    std::fill(window.begin(), window.end(), 0);
+    float raw_log_energy = 0.0;
+    knf::ExtractWindow(0, samples, f, opts.frame_opts, window_function,
+                       &window,
+                       computer.NeedRawLogEnergy() ? &raw_log_energy : nullptr);
+    expected[f].resize(computer.Dim());
+    computer.Compute(raw_log_energy, 1.0, &window, expected[f].data());
+  }
+
+  knf::OnlineFbank fbank(opts);
+  for (size_t i = 0; i < samples.size(); i += chunk_size) {
+    int32_t n = std::min<int32_t>(chunk_size, samples.size() - i);
+    fbank.AcceptWaveform(opts.frame_opts.samp_freq, samples.data() + i, n);
+  }
+  fbank.InputFinished();
+
+  if (fbank.NumFramesReady() != num_frames) {
+    std::cerr << "num frames " << fbank.NumFramesReady() << " vs "
+              << num_frames << "\n";
+    return 1e10;
+  }
+
+  float max_diff = 0;
+  for (int32_t f = 0; f != num_frames; ++f) {
+    const float *frame = fbank.GetFrame(f);
+    for (int32_t k = 0; k != computer.Dim(); ++k) {
+      float diff = std::abs(frame[k] - expected[f][k]) /
+                   std::max(1.0f, std::abs(expected[f][k]));
+      max_diff = std::max(max_diff, diff);
+    }
+  }
+  return max_diff;
+}
+
 int main() {
   knf::FbankOptions opts;
   opts.frame_opts.dither = 0;
@@ -44,5 +98,58 @@ int main() {
 
   std::cout << os.str() << "\n";
 
-  return 0;
+  // ComputeFrames() against Compute(), with each variant of the feature
+  // functions this cpu can run
+  std::vector<float> samples(16000 * 3);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = 10000 * std::sin(i * 0.01f) * std::cos(i * 0.0007f) +
+                 (i * i % 1013) - 506;
+  }
+
+  knf::FbankOptions block_opts;
+  block_opts.frame_opts.dither = 0;
+  block_opts.mel_opts.num_bins = 80;
+
+  std::vector<knf::FbankOptions> all_opts;
+  all_opts.push_back(block_opts);
+
+  block_opts.frame_opts.window_type = "hamming";
+  all_opts.push_back(block_opts);
+
+  block_opts.use_energy = true;
+  all_opts.push_back(block_opts);
+
+  block_opts.raw_energy = false;
+  block_opts.htk_compat = true;
+  all_opts.push_back(block_opts);
+
+  block_opts.use_power = false;
+  block_opts.mel_opts.htk_mode = true;
+  block_opts.mel_opts.num_bins = 23;
+  all_opts.push_back(block_opts);
+
+  std::vector<std::string> isas = {"scalar"};
+  for (const char *isa : {"avx512f", "avx2", "neon"}) {
+    if (knf::SetFeatureFunctionsIsa(isa)) {
+      isas.emplace_back(isa);
+    }
+  }
+
+  const float tolerance = 1e-5;
+  int32_t ret = 0;
+  for (const std::string &isa : isas) {
+    knf::SetFeatureFunctionsIsa(isa);
+    for (size_t i = 0; i != all_opts.size(); ++i) {
+      for (int32_t chunk_size : {160, 1600, 9600, 48000}) {
+        float diff = MaxRelativeDiff(all_opts[i], samples, chunk_size);
+        std::cout << isa << ", opts " << i << ", chunk " << chunk_size
+                  << ", max diff " << diff << "\n";
+        if (diff > tolerance) {
+          ret = 1;
+        }
+      }
+    }
+  }
+  knf::SetFeatureFunctionsIsa("");
+  return ret;
 }
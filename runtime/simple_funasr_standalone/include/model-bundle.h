@@ -0,0 +1,35 @@
+#pragma once
+#include "precomp.h"
+
+namespace funasr {
+
+// Reader of the single file model bundles written by funasr-pack-bundle of the
+// onnxruntime runtime: a header "FUNASRMB", version 1, the entry table of
+// {name[48], kind, offset, size} and the 64 byte aligned entry data. The file
+// is mapped read only, which saves reading it, but onnxruntime still copies
+// the weights of the model entry into the session it creates.
+class ModelBundle {
+  public:
+    enum Kind { RAW = 0, CMVN = 1, TOKENS = 2, SEG_DICT = 3 };
+    struct Entry {
+        const char* data;
+        size_t size;
+        Kind kind;
+    };
+
+    ~ModelBundle();
+    // nullptr if file is not a model bundle
+    static std::unique_ptr<ModelBundle> Open(const std::string& file);
+    bool Lookup(const std::string& name, Entry& entry) const;
+    // strings of a string table entry, false if it is broken
+    static bool ReadStrings(const Entry& entry, std::vector<std::string>& strings);
+
+  private:
+    ModelBundle() = default;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<std::pair<std::string, Entry>> entries_;
+};
+
+} // namespace funasr
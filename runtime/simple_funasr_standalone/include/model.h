@@ -1,6 +1,7 @@
 #pragma once
 #include "precomp.h"
 #include "vocab.h"
+#include "model-bundle.h"
 #include "feature-fbank.h"
 #include "online-feature.h"
 
@@ -22,8 +23,11 @@ public:
     std::string Forward(float* speech_data, int len) override;
 
 private:
-    void InitOnnx(const std::string& model_file, int thread_num);
+    // model_entry holds the model bytes when it is read from a bundle
+    void InitOnnx(const std::string& model_file, int thread_num, const ModelBundle::Entry* model_entry = nullptr);
     void InitFbank();
+    // model_dir may also be a bundle file of funasr-pack-bundle
+    bool InitFromBundle(const std::string& bundle_file, int thread_num);
 
     // ONNX Runtime objects
     // TODO: When porting to NPU, replace these with NPU engine handles
@@ -37,6 +41,9 @@ private:
 
     // Vocab
     std::unique_ptr<Vocab> vocab_;
+
+    // mapped bundle the model was loaded from
+    std::unique_ptr<ModelBundle> bundle_;
     
     // Model metadata
     int64_t lfr_m_ = 7;
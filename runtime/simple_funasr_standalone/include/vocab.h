@@ -6,6 +6,7 @@ namespace funasr {
 class Vocab {
   public:
     Vocab(const std::string& filename);
+    Vocab(const std::vector<std::string>& tokens);
     ~Vocab();
     std::string Vector2String(const std::vector<int>& v);
     int Size() const;
@@ -0,0 +1,103 @@
+#include "model-bundle.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace funasr {
+
+static const char BUNDLE_MAGIC[8] = {'F', 'U', 'N', 'A', 'S', 'R', 'M', 'B'};
+static const uint32_t BUNDLE_VERSION = 1;
+static const size_t BUNDLE_NAME_LEN = 48;
+
+ModelBundle::~ModelBundle() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+std::unique_ptr<ModelBundle> ModelBundle::Open(const std::string& file) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return nullptr;
+    }
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Failed to map model bundle " << file << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<ModelBundle> bundle(new ModelBundle());
+    bundle->data_ = (const char*)addr;
+    bundle->size_ = st.st_size;
+
+    const size_t header_size = 8 + 4 + 4 + 8;
+    const size_t entry_size = BUNDLE_NAME_LEN + 4 + 4 + 8 + 8;
+    if (bundle->size_ < header_size || memcmp(bundle->data_, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0) {
+        return nullptr;
+    }
+    uint32_t version, num_entries;
+    memcpy(&version, bundle->data_ + 8, sizeof(version));
+    memcpy(&num_entries, bundle->data_ + 12, sizeof(num_entries));
+    if (version != BUNDLE_VERSION || header_size + (size_t)num_entries * entry_size > bundle->size_) {
+        std::cerr << "Unsupported model bundle " << file << std::endl;
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < num_entries; i++) {
+        const char* record = bundle->data_ + header_size + i * entry_size;
+        std::string name(record, strnlen(record, BUNDLE_NAME_LEN));
+        uint32_t kind;
+        uint64_t offset, size;
+        memcpy(&kind, record + BUNDLE_NAME_LEN, sizeof(kind));
+        memcpy(&offset, record + BUNDLE_NAME_LEN + 8, sizeof(offset));
+        memcpy(&size, record + BUNDLE_NAME_LEN + 16, sizeof(size));
+        if (offset > bundle->size_ || size > bundle->size_ - offset || kind > SEG_DICT) {
+            std::cerr << "Model bundle " << file << " has a broken entry " << name << std::endl;
+            return nullptr;
+        }
+        Entry entry = {bundle->data_ + offset, (size_t)size, (Kind)kind};
+        bundle->entries_.emplace_back(name, entry);
+    }
+    return bundle;
+}
+
+bool ModelBundle::Lookup(const std::string& name, Entry& entry) const {
+    for (auto& item : entries_) {
+        if (item.first == name) {
+            entry = item.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ModelBundle::ReadStrings(const Entry& entry, std::vector<std::string>& strings) {
+    uint32_t count;
+    if (entry.size < sizeof(count)) {
+        return false;
+    }
+    memcpy(&count, entry.data, sizeof(count));
+    size_t table_size = sizeof(uint32_t) * ((size_t)count + 2);
+    if (table_size > entry.size) {
+        return false;
+    }
+    std::vector<uint32_t> offsets(count + 1);
+    memcpy(offsets.data(), entry.data + sizeof(count), offsets.size() * sizeof(uint32_t));
+    const char* bytes = entry.data + table_size;
+    size_t bytes_size = entry.size - table_size;
+    strings.clear();
+    strings.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > bytes_size) {
+            return false;
+        }
+        strings.emplace_back(bytes + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return true;
+}
+
+} // namespace funasr
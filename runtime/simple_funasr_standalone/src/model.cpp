@@ -92,6 +92,9 @@ void Paraformer::ApplyCmvn(std::vector<float>& feats, int dim) {
 }
 
 void Paraformer::Init(const std::string& model_dir, int thread_num) {
+    if (InitFromBundle(model_dir, thread_num)) {
+        return;
+    }
     std::string model_file = model_dir + "/" + QUANT_MODEL_NAME;
     std::ifstream f(model_file.c_str());
     if (!f.good()) {
@@ -115,6 +118,53 @@ void Paraformer::Init(const std::string& model_dir, int thread_num) {
     InitOnnx(model_file, thread_num);
 }
 
+bool Paraformer::InitFromBundle(const std::string& bundle_file, int thread_num) {
+    bundle_ = ModelBundle::Open(bundle_file);
+    if (!bundle_) {
+        return false;
+    }
+    ModelBundle::Entry model_entry, token_entry, cmvn_entry;
+    std::string model_name = QUANT_MODEL_NAME;
+    if (!bundle_->Lookup(model_name, model_entry)) {
+        model_name = MODEL_NAME;
+        if (!bundle_->Lookup(model_name, model_entry)) {
+            std::cerr << "Error: No model in bundle " << bundle_file << std::endl;
+            exit(-1);
+        }
+    }
+
+    // 1. Load Vocab, stored as a string table
+    std::vector<std::string> tokens;
+    if (!bundle_->Lookup(TOKEN_PATH, token_entry) || token_entry.kind != ModelBundle::TOKENS ||
+        !ModelBundle::ReadStrings(token_entry, tokens)) {
+        std::cerr << "Error: Failed to load tokens.json from bundle " << bundle_file << std::endl;
+        exit(-1);
+    }
+    vocab_ = std::make_unique<Vocab>(tokens);
+
+    // 2. Init Feature Extractor
+    InitFbank();
+
+    // Load CMVN, stored as uint32 num_means, uint32 num_vars and the two float arrays
+    if (bundle_->Lookup(AM_CMVN_NAME, cmvn_entry) && cmvn_entry.kind == ModelBundle::CMVN &&
+        cmvn_entry.size >= 2 * sizeof(uint32_t)) {
+        uint32_t sizes[2];
+        memcpy(sizes, cmvn_entry.data, sizeof(sizes));
+        if (cmvn_entry.size == sizeof(sizes) + ((size_t)sizes[0] + sizes[1]) * sizeof(float)) {
+            const float* values = (const float*)(cmvn_entry.data + sizeof(sizes));
+            means_.assign(values, values + sizes[0]);
+            vars_.assign(values + sizes[0], values + sizes[0] + sizes[1]);
+            std::cout << "Loaded CMVN: dim=" << means_.size() << std::endl;
+        }
+    } else {
+        std::cerr << "Warning: Failed to load am.mvn from bundle " << bundle_file << std::endl;
+    }
+
+    // 3. Init Inference Engine from the mapped model bytes
+    InitOnnx(bundle_file + "/" + model_name, thread_num, &model_entry);
+    return true;
+}
+
 void Paraformer::InitFbank() {
     fbank_opts_ = std::make_unique<knf::FbankOptions>();
     fbank_opts_->frame_opts.dither = 0.0f;
@@ -124,7 +174,7 @@ void Paraformer::InitFbank() {
     fbank_computer_ = std::make_unique<knf::FbankComputer>(*fbank_opts_);
 }
 
-void Paraformer::InitOnnx(const std::string& model_file, int thread_num) {
+void Paraformer::InitOnnx(const std::string& model_file, int thread_num, const ModelBundle::Entry* model_entry) {
     // ======================================================================
     // TODO: NPU Porting Point - Initialization
     // Replace the following ONNX Runtime code with NPU model loading code
@@ -136,7 +186,11 @@ void Paraformer::InitOnnx(const std::string& model_file, int thread_num) {
         session_options_->SetIntraOpNumThreads(thread_num);
         session_options_->SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
         
-        session_ = std::make_shared<Ort::Session>(*env_, model_file.c_str(), *session_options_);
+        if (model_entry) {
+            session_ = std::make_shared<Ort::Session>(*env_, model_entry->data, model_entry->size, *session_options_);
+        } else {
+            session_ = std::make_shared<Ort::Session>(*env_, model_file.c_str(), *session_options_);
+        }
         std::cout << "Successfully loaded model: " << model_file << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Error initializing ONNX session: " << e.what() << std::endl;
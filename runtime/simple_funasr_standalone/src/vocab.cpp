@@ -38,6 +38,10 @@ Vocab::Vocab(const std::string& filename) {
     loaded_ = !vocab_.empty();
 }
 
+Vocab::Vocab(const std::vector<std::string>& tokens) : vocab_(tokens) {
+    loaded_ = !vocab_.empty();
+}
+
 Vocab::~Vocab() {}
 
 std::string Vocab::Vector2String(const std::vector<int>& v) {
@@ -109,6 +109,33 @@ int main(int argc, char* argv[]) {
         "", "decoder-thread-num", "decoder thread num", false, 8, "int");
     TCLAP::ValueArg<int> model_thread_num("", "model-thread-num",
                                           "model thread num", false, 2, "int");
+    TCLAP::ValueArg<int> cpu_budget("", CPU_BUDGET,
+        "total onnx intra-op threads shared by all models, 0 gives every model its own model-thread-num threads",
+        false, 0, "int");
+    TCLAP::ValueArg<std::string> cpu_affinity("", CPU_AFFINITY,
+        "cpu list the server is pinned to, e.g. 0-7,16; empty does not pin",
+        false, "", "string");
+    TCLAP::ValueArg<std::string> model_cache_dir("", MODEL_CACHE_DIR,
+        "dir for the optimized onnx graphs and binary model files reused by the next start; empty disables the cache",
+        false, "", "string");
+    TCLAP::ValueArg<int> vad_batch_size("", VAD_BATCHSIZE,
+        "max number of sessions whose online vad chunks run as one batch, 1 disables batching",
+        false, 1, "int");
+    TCLAP::ValueArg<int> online_batch_size("", ONLINE_BATCHSIZE,
+        "max number of sessions whose online asr chunks run as one batch, 1 disables batching",
+        false, 1, "int");
+    TCLAP::ValueArg<int> online_batch_wait("", ONLINE_BATCH_WAIT,
+        "max microseconds an online asr chunk waits for chunks of other sessions",
+        false, ONLINE_BATCH_WAIT_US, "int");
+    TCLAP::ValueArg<int> max_connections("", MAX_CONNECTIONS,
+        "max open connections, more are refused with 503 and Retry-After, 0 is unlimited",
+        false, 0, "int");
+    TCLAP::ValueArg<int> max_decode_queue("", MAX_DECODE_QUEUE,
+        "max decode tasks waiting for a decoder thread before new connections are refused, 0 is unlimited",
+        false, 0, "int");
+    TCLAP::ValueArg<int> max_session_queue("", MAX_SESSION_QUEUE,
+        "max chunks an online or 2pass stream may have waiting for its decoder before it is closed, 0 is unlimited",
+        false, 0, "int");
 
     TCLAP::ValueArg<std::string> certfile(
         "", "certfile",
@@ -167,6 +194,15 @@ int main(int argc, char* argv[]) {
     cmd.add(io_thread_num);
     cmd.add(decoder_thread_num);
     cmd.add(model_thread_num);
+    cmd.add(cpu_budget);
+    cmd.add(cpu_affinity);
+    cmd.add(model_cache_dir);
+    cmd.add(vad_batch_size);
+    cmd.add(online_batch_size);
+    cmd.add(online_batch_wait);
+    cmd.add(max_connections);
+    cmd.add(max_decode_queue);
+    cmd.add(max_session_queue);
     cmd.parse(argc, argv);
 
     std::map<std::string, std::string> model_path;
@@ -508,6 +544,11 @@ int main(int argc, char* argv[]) {
 
     int s_model_thread_num = model_thread_num.getValue();
 
+    if (!FunRuntimeInit(cpu_budget.getValue(), cpu_affinity.getValue(), model_cache_dir.getValue())) {
+      LOG(ERROR) << "Failed to set " << CPU_BUDGET << "/" << CPU_AFFINITY << "/" << MODEL_CACHE_DIR;
+      exit(-1);
+    }
+
     asio::io_context io_decoder;  // context for decoding
     asio::io_context io_server;   // context for server
 
@@ -566,11 +607,20 @@ int main(int argc, char* argv[]) {
     WebSocketServer websocket_srv(
         io_decoder, is_ssl, server, wss_server, s_certfile,
         s_keyfile);  // websocket server for asr engine
-    websocket_srv.initAsr(model_path, s_model_thread_num);  // init asr model
+    websocket_srv.initAsr(model_path, s_model_thread_num, vad_batch_size.getValue(),
+                          online_batch_size.getValue(), online_batch_wait.getValue());  // init asr model
+    websocket_srv.set_admission(max_connections.getValue(), max_decode_queue.getValue(),
+                                max_session_queue.getValue());
 
     LOG(INFO) << "decoder-thread-num: " << s_decoder_thread_num;
     LOG(INFO) << "io-thread-num: " << s_io_thread_num;
     LOG(INFO) << "model-thread-num: " << s_model_thread_num;
+    LOG(INFO) << "cpu-budget: " << cpu_budget.getValue();
+    LOG(INFO) << "vad-batch-size: " << vad_batch_size.getValue();
+    LOG(INFO) << "online-batch-size: " << online_batch_size.getValue();
+    LOG(INFO) << "max-connections: " << max_connections.getValue()
+              << ", max-decode-queue: " << max_decode_queue.getValue()
+              << ", max-session-queue: " << max_session_queue.getValue();
     LOG(INFO) << "asr model init finished. listen on port:" << s_port;
 
     // Start the ASIO network io_service run loop
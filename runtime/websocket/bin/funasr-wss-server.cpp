@@ -104,6 +104,15 @@ int main(int argc, char* argv[]) {
         "", "decoder-thread-num", "decoder thread num", false, 8, "int");
     TCLAP::ValueArg<int> model_thread_num("", "model-thread-num",
                                           "model thread num", false, 1, "int");
+    TCLAP::ValueArg<int> cpu_budget("", CPU_BUDGET,
+        "total onnx intra-op threads shared by all models, 0 gives every model its own model-thread-num threads",
+        false, 0, "int");
+    TCLAP::ValueArg<std::string> cpu_affinity("", CPU_AFFINITY,
+        "cpu list the server is pinned to, e.g. 0-7,16; empty does not pin",
+        false, "", "string");
+    TCLAP::ValueArg<std::string> model_cache_dir("", MODEL_CACHE_DIR,
+        "dir for the optimized onnx graphs and binary model files reused by the next start; empty disables the cache",
+        false, "", "string");
 
     TCLAP::ValueArg<std::string> certfile("", "certfile", 
         "default: ../../../ssl_key/server.crt, path of certficate for WSS connection. if it is empty, it will be in WS mode.",
@@ -126,7 +135,19 @@ int main(int argc, char* argv[]) {
     TCLAP::ValueArg<std::int32_t> fst_inc_wts("", FST_INC_WTS, 
         "the fst hotwords incremental bias", false, 20, "int32_t");
     TCLAP::SwitchArg use_gpu("", INFER_GPU, "Whether to use GPU, default is false", false);
-    TCLAP::ValueArg<std::int32_t> batch_size("", BATCHSIZE, "batch_size for ASR model when using GPU", false, 4, "int32_t");
+    TCLAP::ValueArg<std::int32_t> batch_size("", BATCHSIZE, "batch_size for ASR model", false, 4, "int32_t");
+    TCLAP::ValueArg<int> offline_batch_size("", OFFLINE_BATCHSIZE,
+        "max number of vad segments of concurrent requests that run as one batch, 1 disables batching",
+        false, 1, "int");
+    TCLAP::ValueArg<int> offline_batch_wait("", OFFLINE_BATCH_WAIT,
+        "max microseconds a vad segment waits for segments of other requests",
+        false, OFFLINE_BATCH_WAIT_US, "int");
+    TCLAP::ValueArg<int> max_connections("", MAX_CONNECTIONS,
+        "max open connections, more are refused with 503 and Retry-After, 0 is unlimited",
+        false, 0, "int");
+    TCLAP::ValueArg<int> max_decode_queue("", MAX_DECODE_QUEUE,
+        "max requests waiting for a decoder thread, more are refused, 0 is unlimited",
+        false, 0, "int");
 
     // add file
     cmd.add(hotword);
@@ -158,8 +179,15 @@ int main(int argc, char* argv[]) {
     cmd.add(io_thread_num);
     cmd.add(decoder_thread_num);
     cmd.add(model_thread_num);
+    cmd.add(cpu_budget);
+    cmd.add(cpu_affinity);
+    cmd.add(model_cache_dir);
     cmd.add(use_gpu);
     cmd.add(batch_size);
+    cmd.add(offline_batch_size);
+    cmd.add(offline_batch_wait);
+    cmd.add(max_connections);
+    cmd.add(max_decode_queue);
     cmd.parse(argc, argv);
 
     std::map<std::string, std::string> model_path;
@@ -451,6 +479,11 @@ int main(int argc, char* argv[]) {
 
     int s_model_thread_num = model_thread_num.getValue();
 
+    if (!FunRuntimeInit(cpu_budget.getValue(), cpu_affinity.getValue(), model_cache_dir.getValue())) {
+      LOG(ERROR) << "Failed to set " << CPU_BUDGET << "/" << CPU_AFFINITY << "/" << MODEL_CACHE_DIR;
+      exit(-1);
+    }
+
     asio::io_context io_decoder;  // context for decoding
     asio::io_context io_server;   // context for server
 
@@ -508,11 +541,17 @@ int main(int argc, char* argv[]) {
     WebSocketServer websocket_srv(
         io_decoder, is_ssl, server, wss_server, s_certfile,
         s_keyfile);  // websocket server for asr engine
-    websocket_srv.initAsr(model_path, s_model_thread_num, use_gpu_, batch_size_);  // init asr model
+    websocket_srv.initAsr(model_path, s_model_thread_num, use_gpu_, batch_size_,
+                          offline_batch_size.getValue(), offline_batch_wait.getValue());  // init asr model
+    websocket_srv.set_admission(max_connections.getValue(), max_decode_queue.getValue());
 
     LOG(INFO) << "decoder-thread-num: " << s_decoder_thread_num;
     LOG(INFO) << "io-thread-num: " << s_io_thread_num;
     LOG(INFO) << "model-thread-num: " << s_model_thread_num;
+    LOG(INFO) << "cpu-budget: " << cpu_budget.getValue();
+    LOG(INFO) << "offline-batch-size: " << offline_batch_size.getValue();
+    LOG(INFO) << "max-connections: " << max_connections.getValue()
+              << ", max-decode-queue: " << max_decode_queue.getValue();
     LOG(INFO) << "asr model init finished. listen on port:" << s_port;
 
     // Start the ASIO network io_service run loop
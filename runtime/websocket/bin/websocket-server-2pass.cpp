@@ -20,6 +20,88 @@ extern std::unordered_map<std::string, int> hws_map_;
 extern int fst_inc_wts_;
 extern float global_beam_, lattice_beam_, am_scale_;
 
+size_t ChunkBuffer::ModelChunkBytes(int chunk_frames, int audio_fs) {
+  size_t bytes = (size_t)chunk_frames * 60 * audio_fs / 1000 * 2;
+  return bytes > 0 ? bytes : 800 * 2;
+}
+
+void ChunkBuffer::SetChunkBytes(size_t chunk_bytes) {
+  chunk_bytes_ = chunk_bytes;
+  // pcm that came before the client said its chunk_size goes out as it is
+  if (head_.size() >= chunk_bytes_) {
+    full_.emplace_back(std::move(head_));
+    head_ = std::vector<char>();
+  }
+}
+
+std::vector<char> ChunkBuffer::NewChunk() {
+  std::vector<char> chunk;
+  if (!free_.empty()) {
+    chunk = std::move(free_.back());
+    free_.pop_back();
+  }
+  chunk.reserve(chunk_bytes_);
+  return chunk;
+}
+
+int ChunkBuffer::Append(const char* data, size_t len) {
+  int filled = 0;
+  while (len > 0) {
+    if (head_.capacity() < chunk_bytes_) {
+      std::vector<char> chunk = NewChunk();
+      chunk.insert(chunk.end(), head_.begin(), head_.end());
+      head_.swap(chunk);
+    }
+    size_t n = std::min(len, chunk_bytes_ - head_.size());
+    head_.insert(head_.end(), data, data + n);
+    data += n;
+    len -= n;
+    if (head_.size() >= chunk_bytes_) {
+      full_.emplace_back(std::move(head_));
+      head_ = std::vector<char>();
+      filled++;
+    }
+  }
+  return filled;
+}
+
+std::vector<char> ChunkBuffer::PopFull() {
+  std::vector<char> chunk;
+  if (!full_.empty()) {
+    chunk = std::move(full_.front());
+    full_.pop_front();
+  }
+  if (!full_.empty()) {
+    chunk.reserve(chunk.size() * (full_.size() + 1));
+    for (auto& next : full_) {
+      chunk.insert(chunk.end(), next.begin(), next.end());
+      Recycle(std::move(next));
+    }
+    full_.clear();
+  }
+  return chunk;
+}
+
+std::vector<char> ChunkBuffer::PopPartial() {
+  std::vector<char> chunk = std::move(head_);
+  head_ = std::vector<char>();
+  return chunk;
+}
+
+void ChunkBuffer::Recycle(std::vector<char>&& chunk) {
+  // a few blocks are enough for a decoder that keeps up with the client
+  if (free_.size() < 4 && chunk.capacity() >= chunk_bytes_) {
+    chunk.clear();
+    free_.emplace_back(std::move(chunk));
+  }
+}
+
+void ChunkBuffer::Clear() {
+  std::vector<char>().swap(head_);
+  std::deque<std::vector<char>>().swap(full_);
+  std::vector<std::vector<char>>().swap(free_);
+}
+
 context_ptr WebSocketServer::on_tls_init(tls_mode mode,
                                          websocketpp::connection_hdl hdl,
                                          std::string& s_certfile,
@@ -97,69 +179,52 @@ nlohmann::json handle_result(FUNASR_RESULT result) {
   return jsonresult;
 }
 // feed buffer to asr engine for decoder
-void WebSocketServer::do_decoder(
-    std::vector<char>& buffer, 
-    websocketpp::connection_hdl& hdl,
-    nlohmann::json& msg, 
-    std::vector<std::vector<std::string>>& punc_cache,
-    std::vector<std::vector<float>> &hotwords_embedding,
-    websocketpp::lib::mutex& thread_lock, 
-    bool& is_final, 
-    std::string wav_name,
-    std::string modetype,
-    bool itn,
-    int audio_fs,
-    std::string wav_format,
-    FUNASR_HANDLE& tpass_online_handle,
-    FUNASR_DEC_HANDLE& decoder_handle,
-    std::string svs_lang,
-    bool sys_itn) {
+void WebSocketServer::do_decoder(FUNASR_DECODE_TASK& task) {
+  FUNASR_MESSAGE& session = *task.session;
+  const FUNASR_SESSION_CONFIG& config = *task.config;
+  websocketpp::connection_hdl& hdl = task.hdl;
+  FUNASR_HANDLE& tpass_online_handle = session.tpass_online_handle;
+  std::vector<std::vector<std::string>>& punc_cache = *session.punc_cache;
+  start_decoder(task);
   // lock for each connection
   if(!tpass_online_handle){
-    scoped_lock guard(thread_lock);
-	  LOG(INFO) << "tpass_online_handle  is free, return";
-	  msg["access_num"]=(int)msg["access_num"]-1;
-	  return;
+    LOG(INFO) << "tpass_online_handle  is free, return";
+    return;
   }
   try {
     FUNASR_RESULT Result = nullptr;
-    int asr_mode_ = 2;
-    if (modetype == "offline") {
-      asr_mode_ = 0;
-    } else if (modetype == "online") {
-      asr_mode_ = 1;
-    } else if (modetype == "2pass") {
-      asr_mode_ = 2;
-    }
 
-    while (buffer.size() >= 800 * 2 && !msg["is_eof"]) {
-      std::vector<char> subvector = {buffer.begin(), buffer.begin() + 800 * 2};
-      buffer.erase(buffer.begin(), buffer.begin() + 800 * 2);
+    while (!session.is_eof) {
+      std::vector<char> chunk;
+      {
+        scoped_lock guard_samples(*session.thread_lock);
+        chunk = session.samples->PopFull();
+      }
+      if (chunk.empty()) {
+        break;
+      }
 
       try {
         if (tpass_online_handle) {
           Result = FunTpassInferBuffer(tpass_handle, tpass_online_handle,
-                                       subvector.data(), subvector.size(),
-                                       punc_cache, false, audio_fs,
-                                       wav_format, (ASR_TYPE)asr_mode_,
-                                       hotwords_embedding, itn, decoder_handle,
-                                       svs_lang, sys_itn);
+                                       chunk.data(), chunk.size(),
+                                       punc_cache, false, config.audio_fs,
+                                       config.wav_format, config.mode,
+                                       session.hotwords_embedding, config.itn,
+                                       session.decoder_handle,
+                                       config.svs_lang, config.svs_itn);
 
         } else {
-          scoped_lock guard(thread_lock);
-          msg["access_num"]=(int)msg["access_num"]-1;
           return;
         }
       } catch (std::exception const& e) {
-        scoped_lock guard(thread_lock);
         LOG(ERROR) << e.what();
-        msg["access_num"]=(int)msg["access_num"]-1;
         return;
       }
       if (Result) {
         websocketpp::lib::error_code ec;
         nlohmann::json jsonresult = handle_result(Result);
-        jsonresult["wav_name"] = wav_name;
+        jsonresult["wav_name"] = config.wav_name;
         jsonresult["is_final"] = false;
         if (jsonresult["text"] != "") {
           if (is_ssl) {
@@ -172,25 +237,29 @@ void WebSocketServer::do_decoder(
         }
         FunASRFreeResult(Result);
       }
+      scoped_lock guard_samples(*session.thread_lock);
+      session.samples->Recycle(std::move(chunk));
     }
-    if (is_final && !msg["is_eof"]) {
+    if (task.is_final && !session.is_eof) {
+      std::vector<char> buffer;
+      {
+        scoped_lock guard_samples(*session.thread_lock);
+        buffer = session.samples->PopPartial();
+      }
       try {
         if (tpass_online_handle) {
           Result = FunTpassInferBuffer(tpass_handle, tpass_online_handle,
                                        buffer.data(), buffer.size(), punc_cache,
-                                       is_final, audio_fs,
-                                       wav_format, (ASR_TYPE)asr_mode_,
-                                       hotwords_embedding, itn, decoder_handle,
-                                       svs_lang, sys_itn);
+                                       task.is_final, config.audio_fs,
+                                       config.wav_format, config.mode,
+                                       session.hotwords_embedding, config.itn,
+                                       session.decoder_handle,
+                                       config.svs_lang, config.svs_itn);
         } else {
-          scoped_lock guard(thread_lock);
-          msg["access_num"]=(int)msg["access_num"]-1;	 
           return;
         }
       } catch (std::exception const& e) {
-        scoped_lock guard(thread_lock);
         LOG(ERROR) << e.what();
-        msg["access_num"]=(int)msg["access_num"]-1;
         return;
       }
       if(punc_cache.size()>0){
@@ -201,7 +270,7 @@ void WebSocketServer::do_decoder(
       if (Result) {
         websocketpp::lib::error_code ec;
         nlohmann::json jsonresult = handle_result(Result);
-        jsonresult["wav_name"] = wav_name;
+        jsonresult["wav_name"] = config.wav_name;
         jsonresult["is_final"] = true;
         if (is_ssl) {
           wss_server_->send(hdl, jsonresult.dump(),
@@ -212,11 +281,11 @@ void WebSocketServer::do_decoder(
         }
         FunASRFreeResult(Result);
       }else{
-        if(wav_format != "pcm" && wav_format != "PCM"){
+        if(config.wav_format != "pcm" && config.wav_format != "PCM"){
           websocketpp::lib::error_code ec;
           nlohmann::json jsonresult;
           jsonresult["text"] = "ERROR. Real-time transcription service ONLY SUPPORT PCM stream.";
-          jsonresult["wav_name"] = wav_name;
+          jsonresult["wav_name"] = config.wav_name;
           jsonresult["is_final"] = true;
           if (is_ssl) {
             wss_server_->send(hdl, jsonresult.dump(),
@@ -232,9 +301,132 @@ void WebSocketServer::do_decoder(
   } catch (std::exception const& e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
-  scoped_lock guard(thread_lock);
-  msg["access_num"]=(int)msg["access_num"]-1;
- 
+}
+
+void WebSocketServer::post_decoder(const std::shared_ptr<FUNASR_MESSAGE>& msg_data,
+                                   websocketpp::connection_hdl hdl,
+                                   bool is_final) {
+  // the queued task takes the new chunks too
+  if (!is_final && msg_data->decode_queued) {
+    return;
+  }
+  std::shared_ptr<FUNASR_DECODE_TASK> task =
+      std::make_shared<FUNASR_DECODE_TASK>();
+  task->session = msg_data;
+  task->config = msg_data->config;
+  task->hdl = hdl;
+  task->is_final = is_final;
+  task->post_time = std::chrono::steady_clock::now();
+  msg_data->decode_queued = true;
+  msg_data->access_num++;
+  queued_decodes_++;
+  msg_data->strand_->post([this, task]() {
+    do_decoder(*task);
+    end_decoder(task->session);
+  });
+}
+
+void WebSocketServer::start_decoder(FUNASR_DECODE_TASK& task) {
+  queued_decodes_--;
+  int64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - task.post_time)
+                        .count();
+  int64_t smoothed = decode_wait_us_;
+  decode_wait_us_ = smoothed + (wait_us - smoothed) / 8;
+  scoped_lock guard(*task.session->thread_lock);
+  task.session->decode_queued = false;
+}
+
+int WebSocketServer::retry_after_s() const {
+  return std::max<int64_t>(1, (decode_wait_us_ + 999999) / 1000000);
+}
+
+void WebSocketServer::set_admission(int max_connections, int max_decode_queue,
+                                    int max_session_chunks) {
+  max_connections_ = max_connections;
+  max_decode_queue_ = max_decode_queue;
+  max_session_chunks_ = max_session_chunks;
+}
+
+bool WebSocketServer::on_validate(websocketpp::connection_hdl hdl) {
+  size_t connections = active_sessions();
+  int queued = queued_decodes_;
+  if ((max_connections_ <= 0 || connections < (size_t)max_connections_) &&
+      (max_decode_queue_ <= 0 || queued < max_decode_queue_)) {
+    return true;
+  }
+  std::string retry_after = std::to_string(retry_after_s());
+  if (is_ssl) {
+    wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
+    con->set_status(websocketpp::http::status_code::service_unavailable);
+    con->append_header("Retry-After", retry_after);
+  } else {
+    server::connection_ptr con = server_->get_con_from_hdl(hdl);
+    con->set_status(websocketpp::http::status_code::service_unavailable);
+    con->append_header("Retry-After", retry_after);
+  }
+  LOG(WARNING) << "refused connection, active connections: " << connections
+               << ", queued decodes: " << queued
+               << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
+  return false;
+}
+
+void WebSocketServer::end_decoder(const std::shared_ptr<FUNASR_MESSAGE>& session) {
+  scoped_lock guard_decoder(*session->thread_lock);
+  session->access_num--;
+  // the last task of a closed connection frees it
+  if (session->access_num == 0 && session->closed) {
+    release_session(*session);
+    closing_sessions_--;
+  }
+}
+
+void WebSocketServer::release_session(FUNASR_MESSAGE& session) {
+  FunWfstDecoderUnloadHwsRes(session.decoder_handle);
+  FunASRWfstDecoderUninit(session.decoder_handle);
+  session.decoder_handle = nullptr;
+  FunTpassOnlineUninit(session.tpass_online_handle);
+  session.tpass_online_handle = nullptr;
+  session.hotwords_embedding = nullptr;
+  session.samples->Clear();
+  session.punc_cache->clear();
+}
+
+size_t WebSocketServer::active_sessions() {
+  scoped_lock guard(m_lock);
+  return data_map.size();
+}
+
+void WebSocketServer::parse_config(const nlohmann::json& jsonresult,
+                                   FUNASR_SESSION_CONFIG& config) {
+  if (jsonresult.contains("wav_name")) {
+    config.wav_name = jsonresult["wav_name"].get<std::string>();
+  }
+  if (jsonresult.contains("mode")) {
+    std::string mode = jsonresult["mode"].get<std::string>();
+    if (mode == "offline") {
+      config.mode = ASR_OFFLINE;
+    } else if (mode == "online") {
+      config.mode = ASR_ONLINE;
+    } else {
+      config.mode = ASR_TWO_PASS;
+    }
+  }
+  if (jsonresult.contains("wav_format")) {
+    config.wav_format = jsonresult["wav_format"].get<std::string>();
+  }
+  if (jsonresult.contains("audio_fs")) {
+    config.audio_fs = jsonresult["audio_fs"].get<int>();
+  }
+  if (jsonresult.contains("itn")) {
+    config.itn = jsonresult["itn"].get<bool>();
+  }
+  if (jsonresult.contains("svs_lang")) {
+    config.svs_lang = jsonresult["svs_lang"].get<std::string>();
+  }
+  if (jsonresult.contains("svs_itn")) {
+    config.svs_itn = jsonresult["svs_itn"].get<bool>();
+  }
 }
 
 void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
@@ -243,19 +435,10 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
     std::shared_ptr<FUNASR_MESSAGE> data_msg =
         std::make_shared<FUNASR_MESSAGE>();  // put a new data vector for new
                                             // connection
-    data_msg->samples = std::make_shared<std::vector<char>>();
+    data_msg->samples = std::make_shared<ChunkBuffer>();
     data_msg->thread_lock = std::make_shared<websocketpp::lib::mutex>();  
 
-    data_msg->msg = nlohmann::json::parse("{}");
-    data_msg->msg["wav_format"] = "pcm";
-    data_msg->msg["wav_name"] = "wav-default-id";
-    data_msg->msg["mode"] = "2pass";
-    data_msg->msg["itn"] = true;
-    data_msg->msg["audio_fs"] = 16000; // default is 16k
-    data_msg->msg["access_num"] = 0; // the number of access for this object, when it is 0, we can free it saftly
-    data_msg->msg["is_eof"]=false; // if this connection is closed
-    data_msg->msg["svs_lang"]="auto";
-    data_msg->msg["svs_itn"]=true;
+    data_msg->config = std::make_shared<const FUNASR_SESSION_CONFIG>();
     FUNASR_DEC_HANDLE decoder_handle =
       FunASRWfstDecoderInit(tpass_handle, ASR_TWO_PASS, global_beam_, lattice_beam_, am_scale_);
     data_msg->decoder_handle = decoder_handle;
@@ -264,38 +447,15 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
   	data_msg->strand_ =	std::make_shared<asio::io_context::strand>(io_decoder_);
 
     data_map.emplace(hdl, data_msg);
+    LOG(INFO) << "on_open, active connections: " << data_map.size()
+              << ", closing: " << closing_sessions_
+              << ", queued decodes: " << queued_decodes_
+              << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
   }catch (std::exception const& e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
 }
 
-void remove_hdl(
-    websocketpp::connection_hdl hdl,
-    std::map<websocketpp::connection_hdl, std::shared_ptr<FUNASR_MESSAGE>,
-             std::owner_less<websocketpp::connection_hdl>>& data_map) {
- 
-  std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
-  auto it_data = data_map.find(hdl);
-  if (it_data != data_map.end()) {
-    data_msg = it_data->second;
-  } else {
-    return;
-  }
-  // scoped_lock guard_decoder(*(data_msg->thread_lock));  //wait for do_decoder
-  // finished and avoid access freed tpass_online_handle
-  unique_lock guard_decoder(*(data_msg->thread_lock));
-  if (data_msg->msg["access_num"]==0 && data_msg->msg["is_eof"]==true) {
-    FunWfstDecoderUnloadHwsRes(data_msg->decoder_handle);
-    FunASRWfstDecoderUninit(data_msg->decoder_handle);
-    data_msg->decoder_handle = nullptr;
-    FunTpassOnlineUninit(data_msg->tpass_online_handle);
-    data_msg->tpass_online_handle = nullptr;
-	  data_map.erase(hdl);
-  }
- 
-  guard_decoder.unlock();
-}
-
 void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
   scoped_lock guard(m_lock);
   std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
@@ -305,59 +465,23 @@ void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
   } else {
     return;
   }
+  data_map.erase(it_data);
+  // the queued tasks hold the session, the last one frees it
   unique_lock guard_decoder(*(data_msg->thread_lock));
-  data_msg->msg["is_eof"]=true;
-  guard_decoder.unlock();
-}
- 
-// remove closed connection
-void WebSocketServer::check_and_clean_connection() {
-  while(true){
-    std::this_thread::sleep_for(std::chrono::milliseconds(5000));
-    std::vector<websocketpp::connection_hdl> to_remove;  // remove list
-    auto iter = data_map.begin();
-    while (iter != data_map.end()) {  // loop to find closed connection
-      websocketpp::connection_hdl hdl = iter->first;
-      try{
-        if (is_ssl) {
-          wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
-          if (con->get_state() != 1) {  // session::state::open ==1
-            to_remove.push_back(hdl);
-          }
-        } else {
-          server::connection_ptr con = server_->get_con_from_hdl(hdl);
-          if (con->get_state() != 1) {  // session::state::open ==1
-            to_remove.push_back(hdl);
-          }
-        }
-      }
-      catch (std::exception const &e)
-      {
-        // if connection is close, we set is_eof = true
-        std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
-        auto it_data = data_map.find(hdl);
-        if (it_data != data_map.end()) {
-          data_msg = it_data->second;
-        } else {
-            continue;
-        }
-        unique_lock guard_decoder(*(data_msg->thread_lock));
-        data_msg->msg["is_eof"]=true;
-        guard_decoder.unlock();
-        to_remove.push_back(hdl);
-        LOG(INFO)<<"connection is closed.";
-        
-      }
-      iter++;
-    }
-    for (auto hdl : to_remove) {
-      {
-        unique_lock lock(m_lock);
-        remove_hdl(hdl, data_map);
-      }
-    }
+  data_msg->is_eof = true;
+  data_msg->closed = true;
+  if (data_msg->access_num == 0) {
+    release_session(*data_msg);
+  } else {
+    closing_sessions_++;
   }
+  guard_decoder.unlock();
+  LOG(INFO) << "on_close, active connections: " << data_map.size()
+            << ", closing: " << closing_sessions_
+            << ", queued decodes: " << queued_decodes_
+            << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
 }
+
 void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
                                  message_ptr msg) {
   unique_lock lock(m_lock);
@@ -368,7 +492,7 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
   auto it_data = data_map.find(hdl);
   if (it_data != data_map.end()) {
     msg_data = it_data->second;
-    if(msg_data->msg["is_eof"]){
+    if(msg_data->is_eof){
       lock.unlock();
       return;
     }
@@ -377,9 +501,7 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
     return;
   }
 
-  std::shared_ptr<std::vector<char>> sample_data_p = msg_data->samples;
-  std::shared_ptr<std::vector<std::vector<std::string>>> punc_cache_p =
-      msg_data->punc_cache;
+  std::shared_ptr<ChunkBuffer> sample_data_p = msg_data->samples;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock_p = msg_data->thread_lock;
 
   lock.unlock();
@@ -399,19 +521,20 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
       }catch (std::exception const &e)
       {
         LOG(ERROR)<<e.what();
-        msg_data->msg["is_eof"]=true;
+        msg_data->is_eof = true;
         guard_decoder.unlock();
         return;
       }
 
-      if (jsonresult.contains("wav_name")) {
-        msg_data->msg["wav_name"] = jsonresult["wav_name"];
-      }
-      if (jsonresult.contains("mode")) {
-        msg_data->msg["mode"] = jsonresult["mode"];
-      }
-      if (jsonresult.contains("wav_format")) {
-        msg_data->msg["wav_format"] = jsonresult["wav_format"];
+      // the binary frames reuse the config parsed here
+      std::shared_ptr<FUNASR_SESSION_CONFIG> config =
+          std::make_shared<FUNASR_SESSION_CONFIG>(*msg_data->config);
+      try{
+        parse_config(jsonresult, *config);
+        msg_data->config = config;
+      }catch (std::exception const &e)
+      {
+        LOG(ERROR) << "Wrong config: " << e.what();
       }
 
       // hotwords: fst/nn
@@ -455,14 +578,9 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
         FunWfstDecoderLoadHwsRes(msg_data->decoder_handle, fst_inc_wts_, merged_hws_map);
 
         // nn
-        std::vector<std::vector<float>> new_hotwords_embedding = CompileHotwordEmbedding(tpass_handle, nn_hotwords, ASR_TWO_PASS);
-        msg_data->hotwords_embedding =
-            std::make_shared<std::vector<std::vector<float>>>(new_hotwords_embedding);
+        msg_data->hotwords_embedding = CompileSharedHotwordEmbedding(tpass_handle, nn_hotwords, ASR_TWO_PASS);
       }
 
-      if (jsonresult.contains("audio_fs")) {
-        msg_data->msg["audio_fs"] = jsonresult["audio_fs"];
-      }
       if (jsonresult.contains("chunk_size")) {
         if (msg_data->tpass_online_handle == nullptr) {
           std::vector<int> chunk_size_vec =
@@ -472,49 +590,25 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
             FUNASR_HANDLE tpass_online_handle =
                 FunTpassOnlineInit(tpass_handle, chunk_size_vec);
             msg_data->tpass_online_handle = tpass_online_handle;
+            // decode once per chunk of the online model
+            sample_data_p->SetChunkBytes(ChunkBuffer::ModelChunkBytes(
+                chunk_size_vec[1], msg_data->config->audio_fs));
           }else{
             LOG(ERROR) << "Wrong chunk_size!";
             break;
           }
         }
       }
-      if (jsonresult.contains("itn")) {
-        msg_data->msg["itn"] = jsonresult["itn"];
-      }
-      if (jsonresult.contains("svs_lang")) {
-        msg_data->msg["svs_lang"] = jsonresult["svs_lang"];
-      }
-      if (jsonresult.contains("svs_itn")) {
-        msg_data->msg["svs_itn"] = jsonresult["svs_itn"];
-      }
-      LOG(INFO) << "jsonresult=" << jsonresult
-                << ", msg_data->msg=" << msg_data->msg;
+      LOG(INFO) << "jsonresult=" << jsonresult;
       if ((jsonresult["is_speaking"] == false ||
           jsonresult["is_finished"] == true) && 
-          msg_data->msg["is_eof"] != true &&
+          !msg_data->is_eof &&
           msg_data->hotwords_embedding != nullptr) {
         LOG(INFO) << "client done";
 
         // if it is in final message, post the sample_data to decode
         try{
-		  
-          std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
-          msg_data->strand_->post(
-              std::bind(&WebSocketServer::do_decoder, this,
-                        std::move(*(sample_data_p.get())), std::move(hdl),
-                        std::ref(msg_data->msg), std::ref(*(punc_cache_p.get())),
-                        std::move(hotwords_embedding_),
-                        std::ref(*thread_lock_p), std::move(true),
-                        msg_data->msg["wav_name"],
-                        msg_data->msg["mode"],
-                        msg_data->msg["itn"],
-                        msg_data->msg["audio_fs"],
-                        msg_data->msg["wav_format"],
-                        std::ref(msg_data->tpass_online_handle),
-                        std::ref(msg_data->decoder_handle),
-                        msg_data->msg["svs_lang"],
-                        msg_data->msg["svs_itn"]));
-		      msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
+          post_decoder(msg_data, hdl, true);
         }
         catch (std::exception const &e)
         {
@@ -528,53 +622,43 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
       const auto* pcm_data = static_cast<const char*>(payload.data());
       int32_t num_samples = payload.size();
 
-      if (isonline) {
-        sample_data_p->insert(sample_data_p->end(), pcm_data,
-                              pcm_data + num_samples);
-        int setpsize =
-            800 * 2;  // TODO, need get from client
-                      // if sample_data size > setpsize, we post data to decode
-        if (sample_data_p->size() > setpsize) {
-          int chunksize = floor(sample_data_p->size() / setpsize);
-          // make sure the subvector size is an integer multiple of setpsize
-          std::vector<char> subvector = {
-              sample_data_p->begin(),
-              sample_data_p->begin() + chunksize * setpsize};
-          // keep remain in sample_data
-          sample_data_p->erase(sample_data_p->begin(),
-                               sample_data_p->begin() + chunksize * setpsize);
-
-          try{
-            // post to decode
-            if (msg_data->msg["is_eof"] != true && msg_data->hotwords_embedding != nullptr) {
-              std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
-              msg_data->strand_->post(
-                        std::bind(&WebSocketServer::do_decoder, this,
-                                  std::move(subvector), std::move(hdl),
-                                  std::ref(msg_data->msg),
-                                  std::ref(*(punc_cache_p.get())),
-                                  std::move(hotwords_embedding_),
-                                  std::ref(*thread_lock_p), std::move(false),
-                                  msg_data->msg["wav_name"],
-                                  msg_data->msg["mode"],
-                                  msg_data->msg["itn"],
-                                  msg_data->msg["audio_fs"],
-                                  msg_data->msg["wav_format"],
-                                  std::ref(msg_data->tpass_online_handle),
-                                  std::ref(msg_data->decoder_handle),
-                                  msg_data->msg["svs_lang"],
-                                  msg_data->msg["svs_itn"]));
-              msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
-            }
-          }
-          catch (std::exception const &e)
-          {
-            LOG(ERROR)<<e.what();
+      // post to decode when a chunk is full, the chunks stay queued until
+      // the hotwords are ready
+      int filled = sample_data_p->Append(pcm_data, num_samples);
+      // only chunks a decoder is consuming count, the ones of a stream
+      // without an online handle or hotwords yet just wait, and an offline
+      // mode stream is decoded at its end anyway
+      if (max_session_chunks_ > 0 &&
+          msg_data->tpass_online_handle != nullptr &&
+          msg_data->hotwords_embedding != nullptr &&
+          msg_data->config->mode != ASR_OFFLINE &&
+          sample_data_p->FullChunks() > (size_t)max_session_chunks_) {
+        // the decoder can not keep up with this stream, drop it rather than
+        // queue without bound, on_close frees the session
+        LOG(WARNING) << "decode queue of " << msg_data->config->wav_name
+                     << " is full, closing the connection";
+        sample_data_p->Clear();
+        guard_decoder.unlock();
+        websocketpp::lib::error_code ec;
+        if (is_ssl) {
+          wss_server_->close(hdl, websocketpp::close::status::try_again_later,
+                             "decode queue full", ec);
+        } else {
+          server_->close(hdl, websocketpp::close::status::try_again_later,
+                         "decode queue full", ec);
+        }
+        return;
+      }
+      if (isonline && filled > 0) {
+        try{
+          if (!msg_data->is_eof && msg_data->hotwords_embedding != nullptr) {
+            post_decoder(msg_data, hdl, false);
           }
         }
-      } else {
-        sample_data_p->insert(sample_data_p->end(), pcm_data,
-                              pcm_data + num_samples);
+        catch (std::exception const &e)
+        {
+          LOG(ERROR)<<e.what();
+        }
       }
       break;
     }
@@ -586,18 +670,15 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
 
 // init asr model
 void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
-                              int thread_num) {
+                              int thread_num, int vad_batch_size,
+                              int online_batch_size, int online_batch_wait_us) {
   try {
-    tpass_handle = FunTpassInit(model_path, thread_num);
+    tpass_handle = FunTpassInit(model_path, thread_num, vad_batch_size,
+                                online_batch_size, online_batch_wait_us);
     if (!tpass_handle) {
       LOG(ERROR) << "FunTpassInit init failed";
       exit(-1);
     }
-    LOG(INFO) << "initAsr run check_and_clean_connection";
-    std::thread clean_thread(&WebSocketServer::check_and_clean_connection,this);  
-    clean_thread.detach();
-    LOG(INFO) << "initAsr run check_and_clean_connection finished";
-
   } catch (const std::exception& e) {
     LOG(INFO) << e.what();
   }
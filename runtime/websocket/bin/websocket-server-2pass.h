@@ -13,6 +13,9 @@
 #ifndef WEBSOCKET_SERVER_H_
 #define WEBSOCKET_SERVER_H_
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -51,19 +54,83 @@ typedef struct {
   float snippet_time;
 } FUNASR_RECOG_RESULT;
 
+// pcm bytes of a connection in chunks of ChunkBytes(), the decode cadence.
+// on_message copies the payloads into the chunk at the head, the decoder
+// takes the full chunks, reads them in place and hands them back for reuse,
+// so the blocks go round instead of the bytes being moved to the front.
+class ChunkBuffer {
+ public:
+  // 16 bit pcm bytes of chunk_frames frames of 60 ms, one chunk of the online
+  // model, at audio_fs
+  static size_t ModelChunkBytes(int chunk_frames, int audio_fs);
+
+  size_t ChunkBytes() const { return chunk_bytes_; }
+  void SetChunkBytes(size_t chunk_bytes);
+  // copies data into the chunks, returns the number of chunks it filled
+  int Append(const char* data, size_t len);
+  size_t FullChunks() const { return full_.size(); }
+  // the full chunks joined into one, empty if there are none. A stream
+  // whose decoder fell behind catches up in one call instead of one per chunk
+  std::vector<char> PopFull();
+  // the rest after the full chunks, shorter than a chunk
+  std::vector<char> PopPartial();
+  void Recycle(std::vector<char>&& chunk);
+  void Clear();
+
+ private:
+  std::vector<char> NewChunk();
+
+  size_t chunk_bytes_ = 800 * 2;  // until the client sends its chunk_size
+  std::vector<char> head_;
+  std::deque<std::vector<char>> full_;
+  std::vector<std::vector<char>> free_;
+};
+
+// decoding options of a connection, parsed from its text frames. A text frame
+// replaces the whole config, the chunks already posted keep the one they
+// were posted with.
+typedef struct {
+  std::string wav_name = "wav-default-id";
+  std::string wav_format = "pcm";
+  ASR_TYPE mode = ASR_TWO_PASS;
+  bool itn = true;
+  int audio_fs = 16000;  // default is 16k
+  std::string svs_lang = "auto";
+  bool svs_itn = true;
+} FUNASR_SESSION_CONFIG;
+
 typedef struct {
-  nlohmann::json msg;
-  std::shared_ptr<std::vector<char>> samples;
+  std::shared_ptr<const FUNASR_SESSION_CONFIG> config;
+  std::shared_ptr<ChunkBuffer> samples;
   std::shared_ptr<std::vector<std::vector<std::string>>> punc_cache;
-  std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding=nullptr;
+  FUNASR_HW_EMB hotwords_embedding=nullptr;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock; // lock for each connection
   FUNASR_HANDLE tpass_online_handle=nullptr;
   std::string online_res = "";
   std::string tpass_res = "";
   std::shared_ptr<asio::io_context::strand>  strand_; // for data execute in order
   FUNASR_DEC_HANDLE decoder_handle=nullptr; 
+  // the number of posted decode tasks, when it is 0 we can free it safely
+  std::atomic<int> access_num{0};
+  // a posted task has not started yet, it will take the chunks that come
+  // in until it does, guarded by thread_lock
+  bool decode_queued = false;
+  std::atomic<bool> is_eof{false};  // if this connection takes no more data
+  // set by on_close only, the session is released once it is closed and
+  // its last task is done, guarded by thread_lock
+  bool closed = false;
 } FUNASR_MESSAGE;
 
+// a wakeup of the decoder of a connection posted to its strand, it decodes
+// the full chunks of session->samples, and the rest too if is_final
+typedef struct {
+  std::shared_ptr<FUNASR_MESSAGE> session;
+  std::shared_ptr<const FUNASR_SESSION_CONFIG> config;
+  websocketpp::connection_hdl hdl;
+  bool is_final;
+  std::chrono::steady_clock::time_point post_time;
+} FUNASR_DECODE_TASK;
+
 // See https://wiki.mozilla.org/Security/Server_Side_TLS for more details about
 // the TLS modes. The code below demonstrates how to implement both the modern
 enum tls_mode { MOZILLA_INTERMEDIATE = 1, MOZILLA_MODERN = 2 };
@@ -85,6 +152,9 @@ class WebSocketServer {
           [this](websocketpp::connection_hdl hdl, message_ptr msg) {
             on_message(hdl, msg);
           });
+      // reject connections while the decoder is saturated
+      wss_server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) { return on_validate(hdl); });
       // set open handle
       wss_server_->set_open_handler(
           [this](websocketpp::connection_hdl hdl) { on_open(hdl); });
@@ -102,6 +172,9 @@ class WebSocketServer {
           [this](websocketpp::connection_hdl hdl, message_ptr msg) {
             on_message(hdl, msg);
           });
+      // reject connections while the decoder is saturated
+      server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) { return on_validate(hdl); });
       // set open handle
       server_->set_open_handler(
           [this](websocketpp::connection_hdl hdl) { on_open(hdl); });
@@ -114,30 +187,47 @@ class WebSocketServer {
       server_->clear_access_channels(websocketpp::log::alevel::all);
     }
   }
-  void do_decoder(std::vector<char>& buffer, websocketpp::connection_hdl& hdl,
-                  nlohmann::json& msg,
-                  std::vector<std::vector<std::string>>& punc_cache,
-                  std::vector<std::vector<float>> &hotwords_embedding,
-                  websocketpp::lib::mutex& thread_lock, bool& is_final,
-                  std::string wav_name,
-                  std::string modetype,
-                  bool itn,
-                  int audio_fs,
-                  std::string wav_format,
-                  FUNASR_HANDLE& tpass_online_handle,
-                  FUNASR_DEC_HANDLE& decoder_handle,
-                  std::string svs_lang,
-                  bool sys_itn);
-
-  void initAsr(std::map<std::string, std::string>& model_path, int thread_num);
+  void do_decoder(FUNASR_DECODE_TASK& task);
+
+  void initAsr(std::map<std::string, std::string>& model_path, int thread_num,
+               int vad_batch_size = 1, int online_batch_size = 1,
+               int online_batch_wait_us = ONLINE_BATCH_WAIT_US);
   void on_message(websocketpp::connection_hdl hdl, message_ptr msg);
+  bool on_validate(websocketpp::connection_hdl hdl);
   void on_open(websocketpp::connection_hdl hdl);
   void on_close(websocketpp::connection_hdl hdl);
   context_ptr on_tls_init(tls_mode mode, websocketpp::connection_hdl hdl,
                           std::string& s_certfile, std::string& s_keyfile);
+  // open connections, and closed ones whose decode tasks are still queued
+  size_t active_sessions();
+  int closing_sessions() const { return closing_sessions_; }
+  // admission limits, 0 is unlimited. New connections are refused with 503
+  // and a Retry-After while max_connections are open or max_decode_queue
+  // decode tasks wait for a decoder thread; an online or 2pass stream with
+  // more than max_session_chunks chunks waiting for its decoder is closed
+  // with 1013 try again later.
+  void set_admission(int max_connections, int max_decode_queue,
+                     int max_session_chunks);
+  // decode tasks waiting for a decoder thread, and the smoothed time they
+  // wait for it
+  int queued_decodes() const { return queued_decodes_; }
+  int64_t decode_wait_us() const { return decode_wait_us_; }
 
  private:
-  void check_and_clean_connection();
+  // books a task that got a decoder thread
+  void start_decoder(FUNASR_DECODE_TASK& task);
+  // seconds a refused client should wait, the current decode wait
+  int retry_after_s() const;
+  // drops a finished task, the last task of a closed connection frees it
+  void end_decoder(const std::shared_ptr<FUNASR_MESSAGE>& session);
+  // frees the decoder handles and buffers of a closed connection, called
+  // with its lock held
+  static void release_session(FUNASR_MESSAGE& session);
+  // called with the lock of the connection held
+  void post_decoder(const std::shared_ptr<FUNASR_MESSAGE>& msg_data,
+                    websocketpp::connection_hdl hdl, bool is_final);
+  static void parse_config(const nlohmann::json& jsonresult,
+                           FUNASR_SESSION_CONFIG& config);
   asio::io_context& io_decoder_;  // threads for asr decoder
   // std::ofstream fout;
   // FUNASR_HANDLE asr_handle;  // asr engine handle
@@ -154,6 +244,12 @@ class WebSocketServer {
            std::owner_less<websocketpp::connection_hdl>>
       data_map;
   websocketpp::lib::mutex m_lock;  // mutex for sample_map
+  std::atomic<int> closing_sessions_{0};
+  int max_connections_ = 0;
+  int max_decode_queue_ = 0;
+  int max_session_chunks_ = 0;
+  std::atomic<int> queued_decodes_{0};
+  std::atomic<int64_t> decode_wait_us_{0};
 };
 
 #endif  // WEBSOCKET_SERVER_H_
@@ -58,29 +58,27 @@ context_ptr WebSocketServer::on_tls_init(tls_mode mode,
 }
 
 // feed buffer to asr engine for decoder
-void WebSocketServer::do_decoder(const std::vector<char>& buffer,
+void WebSocketServer::do_decoder(std::shared_ptr<FUNASR_MESSAGE> msg_data,
+                                 const std::vector<char>& buffer,
                                  websocketpp::connection_hdl& hdl,
-                                 nlohmann::json& msg,
-                                 websocketpp::lib::mutex& thread_lock,
-                                 std::vector<std::vector<float>> &hotwords_embedding,
+                                 const FUNASR_HW_EMB &hotwords_embedding,
                                  std::string wav_name,
                                  bool itn,
                                  int audio_fs,
                                  std::string wav_format,
-                                 FUNASR_DEC_HANDLE& decoder_handle,
                                  std::string svs_lang,
                                  bool sys_itn) {
   try {
     int num_samples = buffer.size();  // the size of the buf
 
-    if (!buffer.empty() && hotwords_embedding.size() > 0) {
+    if (!buffer.empty() && hotwords_embedding->num_hotwords > 0) {
       std::string asr_result="";
       std::string stamp_res="";
       std::string stamp_sents="";
       try{
         FUNASR_RESULT Result = FunOfflineInferBuffer(
             asr_handle, buffer.data(), buffer.size(), RASR_NONE, nullptr, 
-            hotwords_embedding, audio_fs, wav_format, itn, decoder_handle,
+            hotwords_embedding, audio_fs, wav_format, itn, msg_data->decoder_handle,
             svs_lang, sys_itn);
         if (Result != nullptr){
           asr_result = FunASRGetResult(Result, 0);  // get decode result
@@ -147,8 +145,68 @@ void WebSocketServer::do_decoder(const std::vector<char>& buffer,
   } catch (std::exception const& e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
-  scoped_lock guard(thread_lock);
-  msg["access_num"]=(int)msg["access_num"]-1;
+  scoped_lock guard(*msg_data->thread_lock);
+  msg_data->msg["access_num"]=(int)msg_data->msg["access_num"]-1;
+  // the last task of a closed connection frees it
+  if (msg_data->msg["access_num"]==0 && msg_data->msg["closed"]==true) {
+    release_session(*msg_data);
+    closing_sessions_--;
+  }
+}
+
+void WebSocketServer::start_decoder(
+    std::chrono::steady_clock::time_point post_time) {
+  queued_decodes_--;
+  int64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - post_time)
+                        .count();
+  int64_t smoothed = decode_wait_us_;
+  decode_wait_us_ = smoothed + (wait_us - smoothed) / 8;
+}
+
+int WebSocketServer::retry_after_s() const {
+  return std::max<int64_t>(1, (decode_wait_us_ + 999999) / 1000000);
+}
+
+void WebSocketServer::set_admission(int max_connections, int max_decode_queue) {
+  max_connections_ = max_connections;
+  max_decode_queue_ = max_decode_queue;
+}
+
+bool WebSocketServer::on_validate(websocketpp::connection_hdl hdl) {
+  size_t connections = active_sessions();
+  int queued = queued_decodes_;
+  if ((max_connections_ <= 0 || connections < (size_t)max_connections_) &&
+      (max_decode_queue_ <= 0 || queued < max_decode_queue_)) {
+    return true;
+  }
+  std::string retry_after = std::to_string(retry_after_s());
+  if (is_ssl) {
+    wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
+    con->set_status(websocketpp::http::status_code::service_unavailable);
+    con->append_header("Retry-After", retry_after);
+  } else {
+    server::connection_ptr con = server_->get_con_from_hdl(hdl);
+    con->set_status(websocketpp::http::status_code::service_unavailable);
+    con->append_header("Retry-After", retry_after);
+  }
+  LOG(WARNING) << "refused connection, active connections: " << connections
+               << ", queued decodes: " << queued
+               << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
+  return false;
+}
+
+void WebSocketServer::close_busy(websocketpp::connection_hdl hdl) {
+  std::string reason =
+      "decode queue full, retry after " + std::to_string(retry_after_s()) + " s";
+  websocketpp::lib::error_code ec;
+  if (is_ssl) {
+    wss_server_->close(hdl, websocketpp::close::status::try_again_later,
+                       reason, ec);
+  } else {
+    server_->close(hdl, websocketpp::close::status::try_again_later, reason,
+                   ec);
+  }
 }
 
 void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
@@ -165,13 +223,17 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
   data_msg->msg["audio_fs"] = 16000; // default is 16k
   data_msg->msg["access_num"] = 0; // the number of access for this object, when it is 0, we can free it saftly
   data_msg->msg["is_eof"]=false;
+  data_msg->msg["closed"]=false; // set by on_close only, a closed session is released once
   data_msg->msg["svs_lang"]="auto";
   data_msg->msg["svs_itn"]=true;
   FUNASR_DEC_HANDLE decoder_handle =
     FunASRWfstDecoderInit(asr_handle, ASR_OFFLINE, global_beam_, lattice_beam_, am_scale_);
   data_msg->decoder_handle = decoder_handle;
   data_map.emplace(hdl, data_msg);
-  LOG(INFO) << "on_open, active connections: " << data_map.size();
+  LOG(INFO) << "on_open, active connections: " << data_map.size()
+            << ", closing: " << closing_sessions_
+            << ", queued decodes: " << queued_decodes_
+            << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
 }
 
 void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
@@ -184,81 +246,36 @@ void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
   } else {
     return;
   }
+  data_map.erase(it_data);
+  // a queued task holds the session, it frees it when done
   unique_lock guard_decoder(*(data_msg->thread_lock));
   data_msg->msg["is_eof"]=true;
+  data_msg->msg["closed"]=true;
+  if (data_msg->msg["access_num"]==0) {
+    release_session(*data_msg);
+  } else {
+    closing_sessions_++;
+  }
   guard_decoder.unlock();
 
-  LOG(INFO) << "on_close, active connections: " << data_map.size();
+  LOG(INFO) << "on_close, active connections: " << data_map.size()
+            << ", closing: " << closing_sessions_
+            << ", queued decodes: " << queued_decodes_
+            << ", decode wait: " << decode_wait_us_ / 1000 << " ms";
 }
 
-void remove_hdl(
-    websocketpp::connection_hdl hdl,
-    std::map<websocketpp::connection_hdl, std::shared_ptr<FUNASR_MESSAGE>,
-             std::owner_less<websocketpp::connection_hdl>>& data_map) {
-  std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
-  auto it_data = data_map.find(hdl);
-  if (it_data != data_map.end()) {
-    data_msg = it_data->second;
-  } else {
-    return;
-  }
-  unique_lock guard_decoder(*(data_msg->thread_lock));
-  if (data_msg->msg["access_num"]==0 && data_msg->msg["is_eof"]==true) {
-    FunWfstDecoderUnloadHwsRes(data_msg->decoder_handle);
-    FunASRWfstDecoderUninit(data_msg->decoder_handle);
-    data_msg->decoder_handle = nullptr;
-	  data_map.erase(hdl);
-    LOG(INFO) << "remove one connection";
-  }
-  guard_decoder.unlock();
+void WebSocketServer::release_session(FUNASR_MESSAGE& session) {
+  FunWfstDecoderUnloadHwsRes(session.decoder_handle);
+  FunASRWfstDecoderUninit(session.decoder_handle);
+  session.decoder_handle = nullptr;
+  session.hotwords_embedding = nullptr;
+  session.samples->clear();
+  session.samples->shrink_to_fit();
 }
 
-void WebSocketServer::check_and_clean_connection() {
-  while(true){
-    std::this_thread::sleep_for(std::chrono::milliseconds(5000));
-    std::vector<websocketpp::connection_hdl> to_remove;  // remove list
-    auto iter = data_map.begin();
-    while (iter != data_map.end()) {  // loop to find closed connection
-      websocketpp::connection_hdl hdl = iter->first;
-      try{
-        if (is_ssl) {
-          wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
-          if (con->get_state() != 1) {  // session::state::open ==1
-            to_remove.push_back(hdl);
-          }
-        } else {
-          server::connection_ptr con = server_->get_con_from_hdl(hdl);
-          if (con->get_state() != 1) {  // session::state::open ==1
-            to_remove.push_back(hdl);
-          }
-        }
-      }
-      catch (std::exception const &e)
-      {
-        // if connection is close, we set is_eof = true
-        std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
-        auto it_data = data_map.find(hdl);
-        if (it_data != data_map.end()) {
-          data_msg = it_data->second;
-        } else {
-            continue;
-        }
-        unique_lock guard_decoder(*(data_msg->thread_lock));
-        data_msg->msg["is_eof"]=true;
-        guard_decoder.unlock();
-        to_remove.push_back(hdl);
-        LOG(INFO)<<"connection is closed.";
-        
-      }
-      iter++;
-    }
-    for (auto hdl : to_remove) {
-      {
-        unique_lock lock(m_lock);
-        remove_hdl(hdl, data_map);
-      }
-    }
-  }
+size_t WebSocketServer::active_sessions() {
+  scoped_lock guard(m_lock);
+  return data_map.size();
 }
 
 void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
@@ -352,9 +369,7 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
         FunWfstDecoderLoadHwsRes(msg_data->decoder_handle, fst_inc_wts_, merged_hws_map);
 
         // nn
-        std::vector<std::vector<float>> new_hotwords_embedding= CompileHotwordEmbedding(asr_handle, nn_hotwords);
-        msg_data->hotwords_embedding =
-            std::make_shared<std::vector<std::vector<float>>>(new_hotwords_embedding);
+        msg_data->hotwords_embedding = CompileSharedHotwordEmbedding(asr_handle, nn_hotwords);
       }
       if (jsonresult.contains("audio_fs")) {
         msg_data->msg["audio_fs"] = jsonresult["audio_fs"];
@@ -373,22 +388,35 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
           msg_data->msg["is_eof"] != true && 
           msg_data->hotwords_embedding != nullptr) {
         LOG(INFO) << "client done";
+        if (max_decode_queue_ > 0 && queued_decodes_ >= max_decode_queue_) {
+          // refuse the request rather than queue its audio without bound
+          LOG(WARNING) << "decode queue is full, refused "
+                       << msg_data->msg["wav_name"];
+          sample_data_p->clear();
+          guard_decoder.unlock();
+          close_busy(hdl);
+          return;
+        }
         // for offline, send all receive data to decoder engine
-        std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
+        std::chrono::steady_clock::time_point post_time =
+            std::chrono::steady_clock::now();
+        queued_decodes_++;
+        auto decode = std::bind(&WebSocketServer::do_decoder, this,
+                                msg_data,
+                                std::move(*(sample_data_p.get())),
+                                std::move(hdl),
+                                msg_data->hotwords_embedding,
+                                msg_data->msg["wav_name"],
+                                msg_data->msg["itn"],
+                                msg_data->msg["audio_fs"],
+                                msg_data->msg["wav_format"],
+                                msg_data->msg["svs_lang"],
+                                msg_data->msg["svs_itn"]);
         asio::post(io_decoder_,
-                    std::bind(&WebSocketServer::do_decoder, this,
-                              std::move(*(sample_data_p.get())),
-                              std::move(hdl), 
-                              std::ref(msg_data->msg),
-                              std::ref(*thread_lock_p),
-                              std::move(hotwords_embedding_),
-                              msg_data->msg["wav_name"],
-                              msg_data->msg["itn"],
-                              msg_data->msg["audio_fs"],
-                              msg_data->msg["wav_format"],
-                              std::ref(msg_data->decoder_handle),
-                              msg_data->msg["svs_lang"],
-                              msg_data->msg["svs_itn"]));
+                   [this, post_time, decode = std::move(decode)]() mutable {
+                     start_decoder(post_time);
+                     decode();
+                   });
         msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
       }
       break;
@@ -415,18 +443,14 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
 
 // init asr model
 void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
-                              int thread_num, bool use_gpu, int batch_size) {
+                              int thread_num, bool use_gpu, int batch_size,
+                              int offline_batch_size, int offline_batch_wait_us) {
   try {
     // init model with api
 
-    asr_handle = FunOfflineInit(model_path, thread_num, use_gpu, batch_size);
+    asr_handle = FunOfflineInit(model_path, thread_num, use_gpu, batch_size,
+                                offline_batch_size, offline_batch_wait_us);
     LOG(INFO) << "model successfully inited";
-    
-    LOG(INFO) << "initAsr run check_and_clean_connection";
-    std::thread clean_thread(&WebSocketServer::check_and_clean_connection,this);  
-    clean_thread.detach();
-    LOG(INFO) << "initAsr run check_and_clean_connection finished";
-
   } catch (const std::exception& e) {
     LOG(INFO) << e.what();
   }
@@ -13,6 +13,8 @@
 #ifndef WEBSOCKET_SERVER_H_
 #define WEBSOCKET_SERVER_H_
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -58,7 +60,7 @@ typedef struct {
 typedef struct {
   nlohmann::json msg;
   std::shared_ptr<std::vector<char>> samples;
-  std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding=nullptr;
+  FUNASR_HW_EMB hotwords_embedding=nullptr;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock; // lock for each connection
   FUNASR_DEC_HANDLE decoder_handle=nullptr;
 } FUNASR_MESSAGE;
@@ -84,6 +86,9 @@ class WebSocketServer {
           [this](websocketpp::connection_hdl hdl, message_ptr msg) {
             on_message(hdl, msg);
           });
+      // reject connections while the decoder is saturated
+      wss_server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) { return on_validate(hdl); });
       // set open handle
       wss_server_->set_open_handler(
           [this](websocketpp::connection_hdl hdl) { on_open(hdl); });
@@ -101,6 +106,9 @@ class WebSocketServer {
           [this](websocketpp::connection_hdl hdl, message_ptr msg) {
             on_message(hdl, msg);
           });
+      // reject connections while the decoder is saturated
+      server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) { return on_validate(hdl); });
       // set open handle
       server_->set_open_handler(
           [this](websocketpp::connection_hdl hdl) { on_open(hdl); });
@@ -113,28 +121,47 @@ class WebSocketServer {
       server_->clear_access_channels(websocketpp::log::alevel::all);
     }
   }
-  void do_decoder(const std::vector<char>& buffer,
+  void do_decoder(std::shared_ptr<FUNASR_MESSAGE> msg_data,
+                  const std::vector<char>& buffer,
                   websocketpp::connection_hdl& hdl, 
-                  nlohmann::json& msg,
-                  websocketpp::lib::mutex& thread_lock,
-                  std::vector<std::vector<float>> &hotwords_embedding,
+                  const FUNASR_HW_EMB &hotwords_embedding,
                   std::string wav_name, 
                   bool itn,
                   int audio_fs,
                   std::string wav_format,
-                  FUNASR_DEC_HANDLE& decoder_handle,
                   std::string svs_lang,
                   bool sys_itn);
 
-  void initAsr(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
+  void initAsr(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1,
+               int offline_batch_size=1, int offline_batch_wait_us=OFFLINE_BATCH_WAIT_US);
   void on_message(websocketpp::connection_hdl hdl, message_ptr msg);
+  bool on_validate(websocketpp::connection_hdl hdl);
   void on_open(websocketpp::connection_hdl hdl);
   void on_close(websocketpp::connection_hdl hdl);
   context_ptr on_tls_init(tls_mode mode, websocketpp::connection_hdl hdl,
                           std::string& s_certfile, std::string& s_keyfile);
+  // open connections, and closed ones whose decode task is still queued
+  size_t active_sessions();
+  int closing_sessions() const { return closing_sessions_; }
+  // admission limits, 0 is unlimited. New connections are refused with 503
+  // and a Retry-After while max_connections are open or max_decode_queue
+  // requests wait for a decoder thread; a request that comes in while the
+  // queue is full closes its connection with 1013 try again later.
+  void set_admission(int max_connections, int max_decode_queue);
+  // requests waiting for a decoder thread, and the smoothed time they wait
+  // for it
+  int queued_decodes() const { return queued_decodes_; }
+  int64_t decode_wait_us() const { return decode_wait_us_; }
 
  private:
-  void check_and_clean_connection();
+  // frees the decoder handle and buffers of a closed connection, called
+  // with its lock held
+  static void release_session(FUNASR_MESSAGE& session);
+  // books a request that got a decoder thread
+  void start_decoder(std::chrono::steady_clock::time_point post_time);
+  // seconds a refused client should wait, the current decode wait
+  int retry_after_s() const;
+  void close_busy(websocketpp::connection_hdl hdl);
   asio::io_context& io_decoder_;  // threads for asr decoder
   // std::ofstream fout;
   FUNASR_HANDLE asr_handle;  // asr engine handle
@@ -150,6 +177,11 @@ class WebSocketServer {
            std::owner_less<websocketpp::connection_hdl>>
       data_map;
   websocketpp::lib::mutex m_lock;  // mutex for sample_map
+  std::atomic<int> closing_sessions_{0};
+  int max_connections_ = 0;
+  int max_decode_queue_ = 0;
+  std::atomic<int> queued_decodes_{0};
+  std::atomic<int64_t> decode_wait_us_{0};
 };
 
 // std::unordered_map<std::string, int>& hws_map, int fst_inc_wts, std::string& nn_hotwords